@@ -4,7 +4,7 @@
 #include <iostream>
 #include <ft2build.h>
 #include FT_FREETYPE_H
-#include <OpenGL/gl3.h>
+#include "OpenGLHeaders.h"
 
 #define MAXWIDTH 1024 		// Maximum texture width for text atlas.
 #define ATLAS_SIZE 128		// Number of characters held in atals texture.
@@ -0,0 +1,392 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include "OpenGLHeaders.h"
+#include "Benchmark.h"
+
+const char* const Benchmark::TOGGLE_NAMES[TOGGLE_COUNT] = { "camera", "lights", "ssao", "rsm", "interleave", "vsm", "gtao" };
+
+/**
+ * Constructor: default number of frames, warm-up, seed, and timeline.
+ */
+Benchmark::Benchmark()
+{
+	frames = DEFAULT_FRAMES;
+	warmupFrames = DEFAULT_WARMUP_FRAMES;
+	seed = DEFAULT_SEED;
+	nextEvent = 0;
+	currentFrame = 0;
+	state = { false, false, true, false, false, false, false };		// Same initial state as the interactive application.
+	useDefaultTimeline();
+}
+
+/**
+ * Build the default timeline, which splits the run in ten equal parts: still scene, orbiting camera, rotating light,
+ * indirect lighting on, SSAO off, and still scene again with RSM only, followed by still A/B segments against it: with
+ * interleaved sampling, and with variance shadows.  The last two parts turn SSAO back on, first with the normal-oriented
+ * hemisphere sampling and then with GTAO, as one more A/B pair.
+ */
+void Benchmark::useDefaultTimeline()
+{
+	const int part = max( frames / 10, 1 );
+	timeline = {
+		{ 0, CAMERA, false }, { 0, LIGHTS, false }, { 0, SSAO, true }, { 0, RSM, false }, { 0, INTERLEAVE, false },
+		{ 0, VSM, false }, { 0, GTAO, false },
+		{ part, CAMERA, true },
+		{ 2 * part, LIGHTS, true },
+		{ 3 * part, RSM, true },
+		{ 4 * part, SSAO, false },
+		{ 5 * part, CAMERA, false }, { 5 * part, LIGHTS, false },
+		{ 6 * part, INTERLEAVE, true },
+		{ 7 * part, INTERLEAVE, false }, { 7 * part, VSM, true },
+		{ 8 * part, VSM, false }, { 8 * part, SSAO, true },
+		{ 9 * part, GTAO, true } };
+	usingDefaultTimeline = true;
+}
+
+/**
+ * Load a timeline from a text file.  Each line holds either a setting (`frames <n>`, `warmup <n>`, or `seed <n>`) or an
+ * event (`<frame> <camera|lights|ssao|rsm|interleave|vsm|gtao> <on|off>`); empty lines and lines starting with # are ignored.
+ * @param filename Timeline file name.
+ * @return True if the whole file was parsed successfully, false otherwise.
+ */
+bool Benchmark::loadTimeline( const string& filename )
+{
+	ifstream file( filename );
+	if( !file.is_open() )
+	{
+		cerr << "[Benchmark] Unable to open timeline file " << filename << endl;
+		return false;
+	}
+
+	vector<Event> events;
+	string line;
+	int lineNumber = 0;
+	while( getline( file, line ) )
+	{
+		lineNumber++;
+		istringstream is( line );
+		string first;
+		if( !( is >> first ) || first[0] == '#' )
+			continue;
+
+		bool ok;
+		if( first == "frames" )
+			ok = static_cast<bool>( is >> frames ) && frames > 0;
+		else if( first == "warmup" )
+			ok = static_cast<bool>( is >> warmupFrames ) && warmupFrames >= 0;
+		else if( first == "seed" )
+			ok = static_cast<bool>( is >> seed ) && seed >= 0;
+		else
+		{
+			Event event;
+			string toggle, value;
+			istringstream frameText( first );
+			ok = static_cast<bool>( frameText >> event.frame ) && event.frame >= 0 && static_cast<bool>( is >> toggle >> value );
+			if( ok )
+			{
+				auto found = find( TOGGLE_NAMES, TOGGLE_NAMES + TOGGLE_COUNT, toggle );
+				event.toggle = static_cast<Toggle>( found - TOGGLE_NAMES );
+				event.on = ( value == "on" );
+				ok = ( found != TOGGLE_NAMES + TOGGLE_COUNT ) && ( value == "on" || value == "off" );
+			}
+			if( ok )
+				events.push_back( event );
+		}
+
+		if( !ok )
+		{
+			cerr << "[Benchmark] Syntax error in " << filename << ":" << lineNumber << ": " << line << endl;
+			return false;
+		}
+	}
+
+	stable_sort( events.begin(), events.end(), []( const Event& a, const Event& b ) { return a.frame < b.frame; } );
+	timeline = events;
+	usingDefaultTimeline = false;
+	return true;
+}
+
+/**
+ * Apply the timeline events due at the current frame.
+ * @return Scene state to render the current frame with.
+ */
+const Benchmark::State& Benchmark::beginFrame()
+{
+	bool changed = false;
+	for( ; nextEvent < timeline.size() && timeline[nextEvent].frame <= currentFrame; nextEvent++ )
+	{
+		const Event& event = timeline[nextEvent];
+		bool* flags[TOGGLE_COUNT] = { &state.rotatingCamera, &state.rotatingLights, &state.enableSSAO, &state.enableRSM, &state.interleavedRSM,
+									  &state.vsmShadows, &state.gtao };
+		changed = changed || ( *flags[event.toggle] != event.on );
+		*flags[event.toggle] = event.on;
+	}
+
+	if( isRecording() && ( changed || segments.empty() ) )
+		segments.push_back( { currentFrame, state, {}, {} } );
+
+	return state;
+}
+
+/**
+ * Record the times of the frame that was just rendered and advance to the next one.
+ * @param stats Frame statistics, whose endFrame() must have been called for this frame already.
+ * @param renderer Renderer, queried for new per-pass GPU times.
+ * @param hasGPUTime Whether a new whole-frame GPU time was collected in this frame.
+ * @param gpuMs Whole-frame GPU time in milliseconds (ignored if hasGPUTime is false).
+ * @param gpuFrame Frame that the whole-frame GPU time was measured in (see GPUTimer::getResultFrame()).
+ */
+void Benchmark::endFrame( const FrameStats& stats, const Renderer& renderer, bool hasGPUTime, double gpuMs, int gpuFrame )
+{
+	if( isRecording() )
+	{
+		Segment& segment = segments.back();
+
+		if( stats.getTotalFrames() > 1 )				// The very first frame has no interval.
+		{
+			frameTimes.push_back( stats.getLast( FrameStats::FRAME ) );
+			segment.frameTimes.push_back( frameTimes.back() );
+		}
+		cpuTimes.push_back( stats.getLast( FrameStats::CPU ) );
+
+		// GPU times arrive a few frames late: file them under the frame that issued them, and drop the warm-up ones.
+		Segment* gpuSegment = findSegment( gpuFrame );
+		if( hasGPUTime && gpuSegment )
+		{
+			gpuTimes.push_back( gpuMs );
+			gpuSegment->gpuTimes.push_back( gpuMs );
+		}
+
+		for( int p = 0; p < Renderer::PASS_COUNT; p++ )
+		{
+			auto pass = static_cast<Renderer::Pass>( p );
+			if( renderer.hasNewPassTime( pass ) && currentFrame - renderer.getPassFrameLag( pass ) >= warmupFrames )
+				passTimes[p].push_back( renderer.getPassMilliseconds( pass ) );
+		}
+
+		rsmRendered += renderer.getRSMRenderedFrames() - lastRSMRendered;
+		rsmReused += renderer.getRSMReusedFrames() - lastRSMReused;
+		if( renderer.enableRSM && renderer.rsmGather == Renderer::GATHER_VPL )
+			vplMilliseconds = renderer.getVPLMilliseconds();
+	}
+	lastRSMRendered = renderer.getRSMRenderedFrames();
+	lastRSMReused = renderer.getRSMReusedFrames();
+
+	currentFrame++;
+}
+
+/**
+ * Find the recorded segment that contains a frame.
+ * @param frame Frame index.
+ * @return Segment, or nullptr if the frame is a warm-up one.
+ */
+Benchmark::Segment* Benchmark::findSegment( int frame )
+{
+	for( auto segment = segments.rbegin(); segment != segments.rend(); segment++ )
+		if( segment->firstFrame <= frame )
+			return &*segment;
+	return nullptr;
+}
+
+/**
+ * Whether every frame has been rendered.
+ * @return True when the benchmark is over.
+ */
+bool Benchmark::isFinished() const
+{
+	return currentFrame >= frames;
+}
+
+/**
+ * Whether the warm-up frames are over and times are being recorded.
+ * @return True if the current frame is recorded.
+ */
+bool Benchmark::isRecording() const
+{
+	return currentFrame >= warmupFrames;
+}
+
+/**
+ * Current frame index.
+ * @return Index of the frame being rendered, starting at 0.
+ */
+int Benchmark::getFrame() const
+{
+	return currentFrame;
+}
+
+/**
+ * Number of frames to render.
+ * @return Total frame count, including warm-up frames.
+ */
+int Benchmark::getFrames() const
+{
+	return frames;
+}
+
+/**
+ * Seed for every random number generator used while rendering.
+ * @return Non-negative seed.
+ */
+int Benchmark::getSeed() const
+{
+	return seed;
+}
+
+/**
+ * Set the number of frames to render.  The default timeline is stretched accordingly.
+ * @param n Total frame count, including warm-up frames.
+ */
+void Benchmark::setFrames( int n )
+{
+	frames = max( n, 1 );
+	if( usingDefaultTimeline )
+		useDefaultTimeline();
+}
+
+/**
+ * Set the random seed.
+ * @param s Non-negative seed.
+ */
+void Benchmark::setSeed( int s )
+{
+	seed = max( s, 0 );
+}
+
+/**
+ * Write a JSON object with the summary statistics of a set of durations.
+ * @param os Output stream.
+ * @param values Durations in milliseconds.
+ */
+void Benchmark::writeSummary( ostream& os, const vector<double>& values )
+{
+	FrameStats::Summary summary = FrameStats::summarize( values );
+	os << "{ \"count\": " << summary.count << ", \"mean\": " << summary.mean << ", \"variance\": " << summary.variance
+	   << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << " }";
+}
+
+/**
+ * Write a JSON array of durations.
+ * @param os Output stream.
+ * @param values Durations in milliseconds.
+ */
+void Benchmark::writeSamples( ostream& os, const vector<double>& values )
+{
+	os << "[";
+	for( size_t i = 0; i < values.size(); i++ )
+		os << ( ( i > 0 )? ", " : "" ) << values[i];
+	os << "]";
+}
+
+/**
+ * Write the recorded times and their summaries.  All times are in milliseconds.
+ * Must be called while the OpenGL context is current, since the renderer name is queried.
+ * @param filename Output JSON file name.
+ * @param label Free-form description of the run (e.g. a commit hash).
+ * @param width Render width.
+ * @param height Render height.
+ * @return True if the file was written, false otherwise.
+ */
+bool Benchmark::writeJSON( const string& filename, const string& label, int width, int height ) const
+{
+	ofstream os( filename );
+	if( !os.is_open() )
+	{
+		cerr << "[Benchmark] Unable to open file " << filename << endl;
+		return false;
+	}
+
+	auto quoted = []( const string& text ) {
+		string out = "\"";
+		for( char c : text )
+		{
+			if( c == '"' || c == '\\' )
+				out += '\\';
+			if( static_cast<unsigned char>( c ) >= 0x20 )
+				out += c;
+		}
+		return out + "\"";
+	};
+	auto glString = []( GLenum name ) {
+		const GLubyte* text = glGetString( name );
+		return string( text? reinterpret_cast<const char*>( text ) : "" );
+	};
+	auto flags = []( const State& s ) {
+		return string( "\"camera\": " ) + ( s.rotatingCamera? "true" : "false" ) + ", \"lights\": " + ( s.rotatingLights? "true" : "false" )
+			   + ", \"ssao\": " + ( s.enableSSAO? "true" : "false" ) + ", \"rsm\": " + ( s.enableRSM? "true" : "false" )
+			   + ", \"interleave\": " + ( s.interleavedRSM? "true" : "false" ) + ", \"vsm\": " + ( s.vsmShadows? "true" : "false" )
+			   + ", \"gtao\": " + ( s.gtao? "true" : "false" );
+	};
+
+	os << fixed << setprecision( 4 );
+	os << "{" << endl
+	   << "  \"label\": " << quoted( label ) << "," << endl
+	   << "  \"renderer\": " << quoted( glString( GL_RENDERER ) ) << "," << endl
+	   << "  \"version\": " << quoted( glString( GL_VERSION ) ) << "," << endl
+	   << "  \"width\": " << width << ", \"height\": " << height << "," << endl
+	   << "  \"frames\": " << frames << ", \"warmupFrames\": " << warmupFrames << ", \"seed\": " << seed << "," << endl;
+
+	os << "  \"timeline\": [";
+	for( size_t i = 0; i < timeline.size(); i++ )
+		os << ( ( i > 0 )? ", " : "" ) << "{ \"frame\": " << timeline[i].frame << ", \"toggle\": \"" << TOGGLE_NAMES[timeline[i].toggle]
+		   << "\", \"on\": " << ( timeline[i].on? "true" : "false" ) << " }";
+	os << "]," << endl;
+
+	os << "  \"summary\": {" << endl;
+	os << "    \"frame\": "; writeSummary( os, frameTimes ); os << "," << endl;
+	os << "    \"cpu\": "; writeSummary( os, cpuTimes ); os << "," << endl;
+	os << "    \"gpu\": "; writeSummary( os, gpuTimes ); os << "," << endl;
+	os << "    \"passes\": {" << endl;
+	for( int p = 0; p < Renderer::PASS_COUNT; p++ )
+	{
+		os << "      \"" << Renderer::PASS_NAMES[p] << "\": ";
+		writeSummary( os, passTimes[p] );
+		os << ( ( p < Renderer::PASS_COUNT - 1 )? "," : "" ) << endl;
+	}
+	os << "    }," << endl;
+
+	// RSM cache: every reused frame skips the RSM passes (at their mean time) and the VPL rebuild.
+	double savedTotal = 0;
+	os << "    \"rsmRendered\": " << rsmRendered << ", \"rsmReused\": " << rsmReused << "," << endl;
+	os << "    \"rsmSaved\": {";
+	for( int p = 0; p < Renderer::PASS_COUNT; p++ )
+	{
+		if( !Renderer::isRSMPass( static_cast<Renderer::Pass>( p ) ) )
+			continue;
+		double mean = 0;
+		for( double t : passTimes[p] )
+			mean += t / passTimes[p].size();
+		os << " \"" << Renderer::PASS_NAMES[p] << "\": " << mean * rsmReused << ",";
+		savedTotal += mean * rsmReused;
+	}
+	os << " \"vplCpu\": " << vplMilliseconds * rsmReused << ", \"gpuTotal\": " << savedTotal << " }" << endl;
+	os << "  }," << endl;
+
+	os << "  \"segments\": [" << endl;
+	for( size_t i = 0; i < segments.size(); i++ )
+	{
+		int lastFrame = ( i + 1 < segments.size() )? segments[i + 1].firstFrame - 1 : currentFrame - 1;
+		os << "    { \"firstFrame\": " << segments[i].firstFrame << ", \"lastFrame\": " << lastFrame << ", " << flags( segments[i].state ) << "," << endl
+		   << "      \"frame\": "; writeSummary( os, segments[i].frameTimes ); os << "," << endl
+		   << "      \"gpu\": "; writeSummary( os, segments[i].gpuTimes ); os << " }" << ( ( i + 1 < segments.size() )? "," : "" ) << endl;
+	}
+	os << "  ]," << endl;
+
+	os << "  \"samples\": {" << endl;
+	os << "    \"frame\": "; writeSamples( os, frameTimes ); os << "," << endl;
+	os << "    \"cpu\": "; writeSamples( os, cpuTimes ); os << "," << endl;
+	os << "    \"gpu\": "; writeSamples( os, gpuTimes ); os << "," << endl;
+	os << "    \"passes\": {" << endl;
+	for( int p = 0; p < Renderer::PASS_COUNT; p++ )
+	{
+		os << "      \"" << Renderer::PASS_NAMES[p] << "\": ";
+		writeSamples( os, passTimes[p] );
+		os << ( ( p < Renderer::PASS_COUNT - 1 )? "," : "" ) << endl;
+	}
+	os << "    }" << endl << "  }" << endl << "}" << endl;
+
+	return true;
+}
@@ -0,0 +1,93 @@
+#ifndef Benchmark_h
+#define Benchmark_h
+
+#include <string>
+#include <vector>
+#include "FrameStats.h"
+#include "Renderer.h"
+
+using namespace std;
+
+/**
+ * Deterministic benchmark: a fixed number of frames driven by a scripted timeline of camera orbit, light rotation, and
+ * SSAO/RSM/interleaved sampling/variance shadows/GTAO toggles, with a fixed random seed.  It records frame, CPU, GPU,
+ * and per-pass GPU times, and writes them with their summaries to a JSON file so that runs can be compared across
+ * commits and machines.
+ */
+class Benchmark
+{
+public:
+	enum Toggle { CAMERA, LIGHTS, SSAO, RSM, INTERLEAVE, VSM, GTAO, TOGGLE_COUNT };
+
+	struct Event
+	{
+		int frame;								// Frame at which the event takes effect.
+		Toggle toggle;
+		bool on;
+	};
+
+	struct State
+	{
+		bool rotatingCamera;
+		bool rotatingLights;
+		bool enableSSAO;
+		bool enableRSM;
+		bool interleavedRSM;					// Interleaved sampling for RSM indirect lighting.
+		bool vsmShadows;						// Variance shadow maps instead of percentage closer soft shadows.
+		bool gtao;								// Horizon-based ambient occlusion instead of the SSAO kernel.
+	};
+
+	static const int DEFAULT_FRAMES = 600;
+	static const int DEFAULT_WARMUP_FRAMES = 30;
+	static const int DEFAULT_SEED = 2019;
+
+private:
+	static const char* const TOGGLE_NAMES[TOGGLE_COUNT];
+
+	struct Segment								// Run of frames between consecutive timeline events.
+	{
+		int firstFrame;
+		State state;
+		vector<double> frameTimes;
+		vector<double> gpuTimes;
+	};
+
+	int frames;									// Frames to render, including the warm-up ones.
+	int warmupFrames;							// Frames rendered before recording starts.
+	int seed;									// Seed for every random number generator.
+	vector<Event> timeline;						// Sorted by frame.
+	bool usingDefaultTimeline;					// The default timeline scales with the number of frames.
+	size_t nextEvent;
+	int currentFrame;
+	State state;
+
+	vector<double> frameTimes, cpuTimes, gpuTimes;
+	vector<double> passTimes[Renderer::PASS_COUNT];
+	unsigned long rsmRendered = 0;				// Recorded frames that rendered or reused the RSM.
+	unsigned long rsmReused = 0;
+	unsigned long lastRSMRendered = 0;			// Renderer's counts after the previous frame.
+	unsigned long lastRSMReused = 0;
+	double vplMilliseconds = 0;					// CPU time of the last VPL rebuild, if VPLs were gathered.
+	vector<Segment> segments;
+
+	static void writeSummary( ostream& os, const vector<double>& values );
+	static void writeSamples( ostream& os, const vector<double>& values );
+	Segment* findSegment( int frame );
+
+public:
+	Benchmark();
+	void useDefaultTimeline();
+	bool loadTimeline( const string& filename );
+	const State& beginFrame();
+	void endFrame( const FrameStats& stats, const Renderer& renderer, bool hasGPUTime, double gpuMs, int gpuFrame );
+	bool isFinished() const;
+	bool isRecording() const;
+	int getFrame() const;
+	int getFrames() const;
+	int getSeed() const;
+	void setFrames( int n );
+	void setSeed( int s );
+	bool writeJSON( const string& filename, const string& label, int width, int height ) const;
+};
+
+#endif /* Benchmark_h */
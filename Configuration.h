@@ -2,18 +2,22 @@
 #define OPENGL_CONFIGURATION_H
 
 #include <string>
+#include <cstdlib>
 
 using namespace std;
 
 /**
  * Defining configuration parameters used accross the application.
+ * The resources folder may be overriden with the RSM_RESOURCES_FOLDER environment variable (e.g. on render farm nodes).
  */
 namespace conf
 {
-	const string RESOURCES_FOLDER	= "/Users/youngmin/Documents/CS/Real-Time High Quality Rendering/Projects/RSM/RSM/Resources/";
+	const string RESOURCES_FOLDER	= ( getenv( "RSM_RESOURCES_FOLDER" ) )? string( getenv( "RSM_RESOURCES_FOLDER" ) ) + "/" :
+									  "/Users/youngmin/Documents/CS/Real-Time High Quality Rendering/Projects/RSM/RSM/Resources/";
 	const string SHADERS_FOLDER 	= RESOURCES_FOLDER + "shaders/";
 	const string FONTS_FOLDER 		= RESOURCES_FOLDER + "fonts/";
 	const string OBJECTS_FOLDER 	= RESOURCES_FOLDER + "objects/";
+	const string SAMPLES_FOLDER 	= RESOURCES_FOLDER + "samples/";
 }
 
 #endif //OPENGL_CONFIGURATION_H
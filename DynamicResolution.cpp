@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cmath>
+#include "DynamicResolution.h"
+
+using namespace std;
+
+/**
+ * Constructor: off, at full resolution.
+ */
+DynamicResolution::DynamicResolution()
+{
+	budget = 0;
+	minScale = DEFAULT_MIN_SCALE;
+	maxScale = 1.0;
+	scale = 1.0;
+	settleFrames = 0;
+}
+
+/**
+ * Set the frame budget.
+ * @param milliseconds GPU time per frame to hold; 0 switches the controller off (back to full resolution).
+ */
+void DynamicResolution::setBudget( double milliseconds )
+{
+	budget = max( milliseconds, 0.0 );
+	if( budget == 0 )
+		reset();
+}
+
+/**
+ * @return GPU time per frame to hold, in milliseconds (0: off).
+ */
+double DynamicResolution::getBudget() const
+{
+	return budget;
+}
+
+/**
+ * @return Whether the controller adjusts the scale.
+ */
+bool DynamicResolution::isEnabled() const
+{
+	return budget > 0;
+}
+
+/**
+ * Bound the render scale.
+ * @param minimum Smallest fraction of the output resolution along each axis.
+ * @param maximum Largest fraction (at most 1).
+ */
+void DynamicResolution::setBounds( double minimum, double maximum )
+{
+	maxScale = min( max( maximum, 0.05 ), 1.0 );
+	minScale = min( max( minimum, 0.05 ), maxScale );
+	scale = min( max( scale, minScale ), maxScale );
+}
+
+/**
+ * Adjust the scale from the GPU times of the last measured frame.
+ * @param scaledMilliseconds Time of the passes whose cost depends on the render resolution.
+ * @param fixedMilliseconds Time of the rest of the frame.
+ * @return True if the scale changed.
+ */
+bool DynamicResolution::update( double scaledMilliseconds, double fixedMilliseconds )
+{
+	if( !isEnabled() || scaledMilliseconds <= 0 )
+		return false;
+	if( settleFrames > 0 )
+	{
+		settleFrames--;
+		return false;
+	}
+
+	// Pixels (the square of the scale) that fit in what the fixed cost leaves of the budget.
+	const double available = max( HEADROOM * budget - fixedMilliseconds, 0.1 * budget );
+	double target = min( max( scale * sqrt( available / scaledMilliseconds ), minScale ), maxScale );
+	if( fabs( target - scale ) < HYSTERESIS * scale )
+		return false;
+
+	if( target > scale )
+		target = scale + RISE_RATE * ( target - scale );
+	scale = target;
+	settleFrames = SETTLE_FRAMES;
+	return true;
+}
+
+/**
+ * @return Current fraction of the output resolution along each axis.
+ */
+double DynamicResolution::getScale() const
+{
+	return scale;
+}
+
+/**
+ * Go back to the largest scale.
+ */
+void DynamicResolution::reset()
+{
+	scale = maxScale;
+	settleFrames = 0;
+}
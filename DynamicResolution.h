@@ -0,0 +1,38 @@
+#ifndef DynamicResolution_h
+#define DynamicResolution_h
+
+/**
+ * Dynamic resolution controller: picks the render scale (the fraction of the output resolution along each axis) that
+ * keeps the GPU time of a frame within a budget.  The cost of screen-sized passes is taken to grow with their pixel
+ * count, i.e. with the square of the scale, while the rest of the frame (e.g. reflective shadow maps) has a fixed cost.
+ * Resolution drops as soon as a frame runs over budget, but rises in smaller steps, and it isn't changed again until GPU
+ * timings reflect the last change, so that it doesn't oscillate.
+ */
+class DynamicResolution
+{
+private:
+	static const int SETTLE_FRAMES = 6;				// Frames before GPU timings reflect a new scale (see GPUTimer).
+	static constexpr double HEADROOM = 0.9;			// Fraction of the budget to aim for.
+	static constexpr double HYSTERESIS = 0.03;		// Relative scale changes below this are ignored.
+	static constexpr double RISE_RATE = 0.5;		// Fraction of an increase applied at once.
+
+	double budget;								// GPU milliseconds per frame (0: off).
+	double minScale;
+	double maxScale;
+	double scale;
+	int settleFrames;							// Frames left before the next adjustment.
+
+public:
+	static constexpr double DEFAULT_MIN_SCALE = 0.5;
+
+	DynamicResolution();
+	void setBudget( double milliseconds );
+	double getBudget() const;
+	bool isEnabled() const;
+	void setBounds( double minimum, double maximum );
+	bool update( double scaledMilliseconds, double fixedMilliseconds );
+	double getScale() const;
+	void reset();
+};
+
+#endif /* DynamicResolution_h */
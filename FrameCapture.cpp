@@ -0,0 +1,351 @@
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include "FrameCapture.h"
+#include "ImageIO.h"
+
+const char* const FrameCapture::FORMAT_NAMES[FORMAT_COUNT] = { "png", "y4m" };
+
+/**
+ * Allocate the pixel-pack buffers and start the writer thread.
+ * @param width Width of the captured framebuffer.
+ * @param height Height of the captured framebuffer.
+ * @param format PNG sequence or Y4M video.
+ * @param path File name prefix for PNG sequences (frames are numbered), or file name for Y4M videos.
+ * @param fps Frame rate stored in Y4M headers.
+ * @param dropWhenBehind If true, frames are dropped when the GPU or the writer fall behind; otherwise capture() waits.
+ * @return True if capturing started, false otherwise.
+ */
+bool FrameCapture::start( int width, int height, Format format, const string& path, int fps, bool dropWhenBehind )
+{
+	if( active )
+		stop();
+
+	this->width = width;
+	this->height = height;
+	this->format = format;
+	this->path = path;
+	this->fps = fps;
+	this->dropWhenBehind = dropWhenBehind;
+
+	if( format == Y4M )
+	{
+		y4mFile.open( path, ios::binary );
+		if( !y4mFile.is_open() )
+		{
+			cerr << "[Capture] Unable to open file " << path << endl;
+			return false;
+		}
+		y4mFile << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+	}
+
+	const auto frameSize = static_cast<GLsizeiptr>( width ) * height * 4;
+	for( Slot& slot : slots )
+	{
+		glGenBuffers( 1, &slot.pbo );
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbo );
+		glBufferData( GL_PIXEL_PACK_BUFFER, frameSize, nullptr, GL_STREAM_READ );
+		slot.fence = nullptr;
+		slot.frame = 0;
+	}
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	pool.assign( POOL_SIZE, Frame() );
+	for( Frame& frame : pool )
+		frame.pixels.resize( static_cast<size_t>( frameSize ) );
+	queue.clear();
+
+	oldest = inFlight = 0;
+	captured = dropped = written = 0;
+	writeFailed = false;
+	stopping = false;
+	writer = thread( &FrameCapture::writerLoop, this );
+	active = true;
+	return true;
+}
+
+/**
+ * Issue the asynchronous readback of a framebuffer's color, after handing every finished readback to the writer.
+ * Call it once per frame, right after rendering the frame to capture.
+ * @param readFBO Framebuffer object to read from (0 for the default framebuffer's back buffer).
+ */
+void FrameCapture::capture( GLuint readFBO )
+{
+	if( !active )
+		return;
+
+	captured++;
+	collect( false );
+	if( inFlight == RING_SIZE )							// Every pixel-pack buffer is still waiting for the GPU.
+	{
+		if( dropWhenBehind )
+		{
+			dropped++;
+			return;
+		}
+		collect( true );
+	}
+
+	Slot& slot = slots[( oldest + inFlight ) % RING_SIZE];
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, readFBO );
+	if( readFBO == 0 )
+		glReadBuffer( GL_BACK );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbo );
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+	glReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr );		// Into the buffer: returns immediately.
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+
+	slot.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	slot.frame = captured - 1;
+	inFlight++;
+}
+
+/**
+ * Map the pixel-pack buffers whose readbacks are complete, oldest first, and queue their pixels for the writer.
+ * @param wait If true, block until at least the oldest readback completes (and until the writer has room for it).
+ */
+void FrameCapture::collect( bool wait )
+{
+	while( inFlight > 0 )
+	{
+		Slot& slot = slots[oldest];
+		GLenum status = glClientWaitSync( slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait? 1000000000 : 0 );
+		if( status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED )
+		{
+			if( !wait || status == GL_WAIT_FAILED )
+				break;
+			continue;
+		}
+		wait = false;									// Only the first readback is waited for.
+
+		glDeleteSync( slot.fence );
+		slot.fence = nullptr;
+		oldest = ( oldest + 1 ) % RING_SIZE;
+		inFlight--;
+
+		// Get a free frame from the pool.
+		Frame frame;
+		{
+			unique_lock<mutex> guard( lock );
+			if( pool.empty() && !dropWhenBehind )
+				changed.wait( guard, [this]() { return !pool.empty(); } );
+			if( pool.empty() )							// The writer thread fell behind.
+			{
+				dropped++;
+				continue;
+			}
+			frame = move( pool.back() );
+			pool.pop_back();
+		}
+
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbo );
+		auto data = static_cast<const unsigned char*>( glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, frame.pixels.size(), GL_MAP_READ_BIT ) );
+		if( data )
+		{
+			memcpy( frame.pixels.data(), data, frame.pixels.size() );
+			glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+		}
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+		frame.index = slot.frame;
+
+		unique_lock<mutex> guard( lock );
+		if( data )
+			queue.push_back( move( frame ) );
+		else
+		{
+			pool.push_back( move( frame ) );
+			dropped++;
+		}
+		changed.notify_all();
+	}
+}
+
+/**
+ * Writer thread: encode queued frames until stopped and the queue is empty.
+ */
+void FrameCapture::writerLoop()
+{
+	unique_lock<mutex> guard( lock );
+	while( true )
+	{
+		changed.wait( guard, [this]() { return stopping || !queue.empty(); } );
+		if( queue.empty() )								// Stopping with nothing left to write.
+			break;
+
+		Frame frame = move( queue.front() );
+		queue.pop_front();
+
+		guard.unlock();									// Encode without holding the lock.
+		bool ok = writeFrame( frame );
+		guard.lock();
+
+		if( ok )
+			written++;
+		else
+			writeFailed = true;
+		pool.push_back( move( frame ) );
+		changed.notify_all();
+	}
+}
+
+/**
+ * Encode one frame.
+ * @param frame Frame to write.
+ * @return True on success.
+ */
+bool FrameCapture::writeFrame( const Frame& frame )
+{
+	if( format == Y4M )
+		return writeY4MFrame( frame );
+
+	char filename[32];
+	snprintf( filename, sizeof( filename ), "%05lu.png", frame.index );
+	return ImageIO::writePNG( path + filename, width, height, 4, frame.pixels.data() );
+}
+
+/**
+ * Append one frame to the Y4M video, converted to full-range YCbCr (BT.601) with 2x2 chroma subsampling.
+ * @param frame Frame to write.
+ * @return True on success.
+ */
+bool FrameCapture::writeY4MFrame( const Frame& frame )
+{
+	const int cw = ( width + 1 ) / 2, ch = ( height + 1 ) / 2;
+	vector<unsigned char> planes( static_cast<size_t>( width ) * height + 2 * static_cast<size_t>( cw ) * ch );
+	unsigned char* yPlane = planes.data();
+	unsigned char* cbPlane = yPlane + static_cast<size_t>( width ) * height;
+	unsigned char* crPlane = cbPlane + static_cast<size_t>( cw ) * ch;
+
+	auto clamp8 = []( double v ) { return static_cast<unsigned char>( min( max( v + 0.5, 0.0 ), 255.0 ) ); };
+	auto pixel = [this, &frame]( int x, int y ) {		// Frames are stored bottom row first; videos go top row first.
+		return &frame.pixels[( static_cast<size_t>( height - 1 - y ) * width + x ) * 4];
+	};
+
+	for( int y = 0; y < height; y++ )
+	{
+		for( int x = 0; x < width; x++ )
+		{
+			const unsigned char* p = pixel( x, y );
+			yPlane[y * width + x] = clamp8( 0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2] );
+		}
+	}
+
+	for( int y = 0; y < ch; y++ )
+	{
+		for( int x = 0; x < cw; x++ )
+		{
+			double r = 0, g = 0, b = 0;
+			int n = 0;
+			for( int dy = 0; dy < 2 && 2 * y + dy < height; dy++ )
+			{
+				for( int dx = 0; dx < 2 && 2 * x + dx < width; dx++ )
+				{
+					const unsigned char* p = pixel( 2 * x + dx, 2 * y + dy );
+					r += p[0];
+					g += p[1];
+					b += p[2];
+					n++;
+				}
+			}
+			r /= n;
+			g /= n;
+			b /= n;
+			cbPlane[y * cw + x] = clamp8( 128.0 - 0.168736 * r - 0.331264 * g + 0.5 * b );
+			crPlane[y * cw + x] = clamp8( 128.0 + 0.5 * r - 0.418688 * g - 0.081312 * b );
+		}
+	}
+
+	y4mFile << "FRAME\n";
+	y4mFile.write( reinterpret_cast<const char*>( planes.data() ), planes.size() );
+	return y4mFile.good();
+}
+
+/**
+ * Finish every readback in flight, wait for the writer thread to encode all queued frames, and release resources.
+ */
+void FrameCapture::stop()
+{
+	if( !active )
+		return;
+
+	while( inFlight > 0 )
+	{
+		int before = inFlight;
+		collect( true );
+		if( inFlight == before )						// The fence couldn't be waited for: give the frame up.
+		{
+			glDeleteSync( slots[oldest].fence );
+			slots[oldest].fence = nullptr;
+			oldest = ( oldest + 1 ) % RING_SIZE;
+			inFlight--;
+			dropped++;
+		}
+	}
+
+	{
+		unique_lock<mutex> guard( lock );
+		stopping = true;
+		changed.notify_all();
+	}
+	writer.join();
+
+	for( Slot& slot : slots )
+		glDeleteBuffers( 1, &slot.pbo );
+	if( y4mFile.is_open() )
+		y4mFile.close();
+	pool.clear();
+	active = false;
+
+	cout << "[Capture] " << written << " frame(s) written, " << dropped << " dropped" << ( writeFailed? " (write errors)" : "" ) << endl;
+}
+
+/**
+ * Whether frames are being captured.
+ * @return True between start() and stop().
+ */
+bool FrameCapture::isActive() const
+{
+	return active;
+}
+
+/**
+ * Number of capture() calls since start().
+ * @return Frame count, including dropped ones.
+ */
+unsigned long FrameCapture::getCapturedFrames() const
+{
+	return captured;
+}
+
+/**
+ * Number of frames lost because the GPU readbacks or the writer thread fell behind.
+ * @return Dropped frame count.
+ */
+unsigned long FrameCapture::getDroppedFrames() const
+{
+	return dropped;
+}
+
+/**
+ * Number of frames encoded so far.
+ * @return Written frame count.
+ */
+unsigned long FrameCapture::getWrittenFrames()
+{
+	unique_lock<mutex> guard( lock );
+	return written;
+}
+
+/**
+ * Parse a capture format name (see FORMAT_NAMES).
+ * @param name "png" or "y4m".
+ * @return Corresponding format, or FORMAT_COUNT if the name is unknown.
+ */
+FrameCapture::Format FrameCapture::formatFromName( const string& name )
+{
+	for( int i = 0; i < FORMAT_COUNT; i++ )
+		if( name == FORMAT_NAMES[i] )
+			return static_cast<Format>( i );
+	return FORMAT_COUNT;
+}
@@ -0,0 +1,88 @@
+#ifndef FrameCapture_h
+#define FrameCapture_h
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "OpenGLHeaders.h"
+
+using namespace std;
+
+/**
+ * Asynchronous frame capture.
+ * Each captured frame is read into one of a ring of pixel-pack buffers, and a fence is placed right after it.  Buffers
+ * are mapped only once their fences have signaled (usually a couple of frames later), so the render loop never waits for
+ * the GPU.  Mapped pixels are copied into a bounded pool of frames consumed by a writer thread, which encodes them as a
+ * PNG sequence or a raw Y4M video.  When the ring or the pool are full, frames are dropped and counted, unless the
+ * capture was set up to wait instead (e.g. for offline rendering).
+ */
+class FrameCapture
+{
+public:
+	enum Format { PNG_SEQUENCE, Y4M, FORMAT_COUNT };
+	static const char* const FORMAT_NAMES[FORMAT_COUNT];
+
+private:
+	static const int RING_SIZE = 4;				// Pixel-pack buffers in flight.
+	static const int POOL_SIZE = 8;				// Frames waiting for (or being written by) the writer thread.
+
+	struct Slot
+	{
+		GLuint pbo;
+		GLsync fence;							// Non-null while the readback is in flight.
+		unsigned long frame;					// Capture index.
+	};
+
+	struct Frame
+	{
+		unsigned long index;
+		vector<unsigned char> pixels;			// RGBA, bottom row first.
+	};
+
+	int width = 0;
+	int height = 0;
+	Format format = PNG_SEQUENCE;
+	string path;								// File name prefix (PNG) or file name (Y4M).
+	int fps = 60;								// Frame rate stored in Y4M headers.
+	bool dropWhenBehind = true;
+	bool active = false;
+
+	Slot slots[RING_SIZE];
+	int oldest = 0;								// Oldest slot in flight.
+	int inFlight = 0;
+
+	unsigned long captured = 0;					// Frames handed to capture().
+	unsigned long dropped = 0;					// Frames lost because the ring or the writer fell behind.
+	unsigned long written = 0;					// Frames encoded by the writer thread.
+	bool writeFailed = false;
+
+	// Writer thread state (guarded by mutex).
+	thread writer;
+	mutex lock;
+	condition_variable changed;
+	deque<Frame> queue;							// Frames ready to be written, in order.
+	vector<Frame> pool;							// Free frames.
+	bool stopping = false;
+	ofstream y4mFile;
+
+	void collect( bool wait );
+	void writerLoop();
+	bool writeFrame( const Frame& frame );
+	bool writeY4MFrame( const Frame& frame );
+
+public:
+	bool start( int width, int height, Format format, const string& path, int fps = 60, bool dropWhenBehind = true );
+	void capture( GLuint readFBO );
+	void stop();
+	bool isActive() const;
+	unsigned long getCapturedFrames() const;
+	unsigned long getDroppedFrames() const;
+	unsigned long getWrittenFrames();
+	static Format formatFromName( const string& name );
+};
+
+#endif /* FrameCapture_h */
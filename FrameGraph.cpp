@@ -0,0 +1,276 @@
+#include <iostream>
+#include <set>
+#include "FrameGraph.h"
+
+/**
+ * Input constructor.
+ * @param resource Resource read by the pass (NONE binds texture 0).
+ * @param unit Texture unit to bind it to, or -1 if the pass binds it itself.
+ */
+FrameGraph::Input::Input( Resource resource, int unit ):
+	resource( resource ), unit( unit )
+{}
+
+/**
+ * Start declaring a new frame: forget the passes and resources of the last one.
+ */
+void FrameGraph::reset()
+{
+	resources.clear();
+	passes.clear();
+	order.clear();
+}
+
+/**
+ * Declare a resource that outlives the frame.
+ * @param name Name, for reports.
+ * @param texture Texture name (0 for resources that only carry dependencies).
+ * @return Resource handle.
+ */
+FrameGraph::Resource FrameGraph::import( const string& name, GLuint texture )
+{
+	resources.push_back( { name, texture, false, RenderTargetPool::Descriptor(), nullptr, false, -1, -1 } );
+	return static_cast<Resource>( resources.size() - 1 );
+}
+
+/**
+ * Declare a transient target, which only lives from the first to the last pass using it.  Its contents are undefined
+ * when the first pass starts, so that pass must write every texel that is read later.
+ * @param name Name, for reports.
+ * @param descriptor Format and size.
+ * @param configure Sets the sampling parameters of the texture, bound to GL_TEXTURE_2D when called (nearest filtering
+ * and repeat wrapping, otherwise).
+ * @return Resource handle.
+ */
+FrameGraph::Resource FrameGraph::create( const string& name, const RenderTargetPool::Descriptor& descriptor, function<void()> configure )
+{
+	resources.push_back( { name, 0, true, descriptor, configure, false, -1, -1 } );
+	return static_cast<Resource>( resources.size() - 1 );
+}
+
+/**
+ * Keep the passes that write a resource (and those they depend on), even if no other pass reads it.
+ * @param resource Resource handle.
+ */
+void FrameGraph::retain( Resource resource )
+{
+	if( resource != NONE )
+		resources[resource].retained = true;
+}
+
+/**
+ * Declare a pass.  Passes that touch the same resources run in the order they're declared.
+ * @param id Pass identifier: index of its GPU timer, or UNTIMED.
+ * @param name Name, for reports.
+ * @param inputs Resources the pass reads, and the texture units to bind them to.
+ * @param outputs Resources the pass writes.
+ * @param execute Commands of the pass.
+ */
+void FrameGraph::addPass( int id, const string& name, const vector<Input>& inputs, const vector<Resource>& outputs, function<void()> execute )
+{
+	passes.push_back( { id, name, inputs, outputs, execute, false } );
+}
+
+/**
+ * Cull the passes that don't contribute to a retained resource, order the rest, and find the lifetime of every resource.
+ */
+void FrameGraph::compile()
+{
+	// Walk back from the retained resources: a pass is needed if a resource it writes is, and then so are its inputs.
+	vector<bool> needed( resources.size(), false );
+	for( size_t r = 0; r < resources.size(); r++ )
+		needed[r] = resources[r].retained;
+	for( int p = static_cast<int>( passes.size() ) - 1; p >= 0; p-- )
+	{
+		PassNode& pass = passes[p];
+		pass.culled = true;
+		for( Resource output : pass.outputs )
+			if( needed[output] )
+				pass.culled = false;
+		if( pass.culled )
+			continue;
+		for( const Input& input : pass.inputs )
+			if( input.resource != NONE )
+				needed[input.resource] = true;
+	}
+
+	// Dependencies: reading a resource waits for the passes declared before that write it, and writing one waits for
+	// the passes declared before that read or write it.
+	const int count = static_cast<int>( passes.size() );
+	vector<vector<int>> successors( count );
+	vector<int> predecessors( count, 0 );
+	auto reads = []( const PassNode& pass, Resource resource ) {
+		for( const Input& input : pass.inputs )
+			if( input.resource == resource )
+				return true;
+		return false;
+	};
+	auto writes = []( const PassNode& pass, Resource resource ) {
+		for( Resource output : pass.outputs )
+			if( output == resource )
+				return true;
+		return false;
+	};
+	for( int j = 0; j < count; j++ )
+	{
+		if( passes[j].culled )
+			continue;
+		for( int i = 0; i < j; i++ )
+		{
+			if( passes[i].culled )
+				continue;
+			bool dependent = false;
+			for( const Input& input : passes[j].inputs )
+				dependent = dependent || ( input.resource != NONE && writes( passes[i], input.resource ) );
+			for( Resource output : passes[j].outputs )
+				dependent = dependent || writes( passes[i], output ) || reads( passes[i], output );
+			if( dependent )
+			{
+				successors[i].push_back( j );
+				predecessors[j]++;
+			}
+		}
+	}
+
+	// Topological order; among the passes that are ready, the one declared first goes first.
+	set<int> ready;
+	for( int p = 0; p < count; p++ )
+		if( !passes[p].culled && predecessors[p] == 0 )
+			ready.insert( p );
+	while( !ready.empty() )
+	{
+		const int p = *ready.begin();
+		ready.erase( ready.begin() );
+		order.push_back( p );
+		for( int s : successors[p] )
+			if( --predecessors[s] == 0 )
+				ready.insert( s );
+	}
+
+	// Lifetimes, in positions of the execution order.
+	for( int k = 0; k < static_cast<int>( order.size() ); k++ )
+	{
+		const PassNode& pass = passes[order[k]];
+		for( const Input& input : pass.inputs )
+		{
+			if( input.resource == NONE )
+				continue;
+			ResourceNode& resource = resources[input.resource];
+			if( resource.transient && resource.firstUse < 0 )
+				cerr << "[FrameGraph] " << pass.name << " reads " << resource.name << " before any pass writes it" << endl;
+			resource.firstUse = ( resource.firstUse < 0 )? k : resource.firstUse;
+			resource.lastUse = k;
+		}
+		for( Resource output : pass.outputs )
+		{
+			ResourceNode& resource = resources[output];
+			resource.firstUse = ( resource.firstUse < 0 )? k : resource.firstUse;
+			resource.lastUse = k;
+		}
+	}
+}
+
+/**
+ * Compile the graph and run its passes.
+ * @param targetPool Pool that transient targets are acquired from.
+ * @param timers GPU timers, by pass identifier.
+ * @param frame Frame number the timers' measurements are tagged with.
+ */
+void FrameGraph::execute( RenderTargetPool& targetPool, GPUTimer* timers, unsigned long frame )
+{
+	compile();
+	pool = &targetPool;
+
+	set<GLuint> textures;
+	for( int k = 0; k < static_cast<int>( order.size() ); k++ )
+	{
+		PassNode& pass = passes[order[k]];
+		for( ResourceNode& resource : resources )
+		{
+			if( resource.transient && resource.firstUse == k )
+			{
+				resource.texture = pool->acquire( resource.descriptor );
+				if( resource.configure )
+					resource.configure();
+				textures.insert( resource.texture );
+			}
+		}
+
+		if( pass.id != UNTIMED )
+			timers[pass.id].begin( frame );
+		for( const Input& input : pass.inputs )
+		{
+			if( input.unit < 0 )
+				continue;
+			glActiveTexture( GL_TEXTURE0 + input.unit );
+			glBindTexture( GL_TEXTURE_2D, getTexture( input.resource ) );
+		}
+		pass.execute();
+		if( pass.id != UNTIMED )
+			timers[pass.id].end();
+
+		for( ResourceNode& resource : resources )
+			if( resource.transient && resource.lastUse == k )
+				pool->release( resource.texture );
+	}
+
+	aliasedTextures = static_cast<int>( textures.size() );
+	pool = nullptr;
+}
+
+/**
+ * Texture of a resource.  Transients only have one while the passes that use them run.
+ * @param resource Resource handle.
+ * @return Texture name (0 for NONE).
+ */
+GLuint FrameGraph::getTexture( Resource resource ) const
+{
+	return ( resource == NONE )? 0 : resources[resource].texture;
+}
+
+/**
+ * Framebuffer that renders into a transient target, or into an imported texture with a single attachment from the pool.
+ * @param resource Resource handle.
+ * @return Framebuffer name.
+ */
+GLuint FrameGraph::getFramebuffer( Resource resource ) const
+{
+	return pool->getFramebuffer( getTexture( resource ) );
+}
+
+/**
+ * Whether a pass ran in the last executed frame.
+ * @param id Pass identifier.
+ * @return True if a pass with this identifier was declared and not culled.
+ */
+bool FrameGraph::isExecuted( int id ) const
+{
+	for( int p : order )
+		if( passes[p].id == id )
+			return true;
+	return false;
+}
+
+/**
+ * Print the passes of the last executed frame in order, the culled passes, and how many pool textures the transient
+ * targets took.
+ * @param os Output stream.
+ */
+void FrameGraph::report( ostream& os ) const
+{
+	os << "[FrameGraph]";
+	for( size_t k = 0; k < order.size(); k++ )
+		os << ( ( k > 0 )? " -> " : " " ) << passes[order[k]].name;
+
+	string culled;
+	for( const PassNode& pass : passes )
+		if( pass.culled )
+			culled += ( culled.empty()? "" : ", " ) + pass.name;
+	if( !culled.empty() )
+		os << "; culled: " << culled;
+
+	int transients = 0;
+	for( const ResourceNode& resource : resources )
+		transients += ( resource.transient && resource.firstUse >= 0 );
+	os << "; " << transients << " transient targets in " << aliasedTextures << " textures" << endl;
+}
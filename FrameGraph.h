@@ -0,0 +1,84 @@
+#ifndef FrameGraph_h
+#define FrameGraph_h
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "OpenGLHeaders.h"
+#include "GPUTimer.h"
+#include "RenderTargetPool.h"
+
+using namespace std;
+
+/**
+ * Frame graph: the passes of a frame are declared up front with the resources they read and write, and then run in one
+ * go.  Compiling the graph orders the passes by their dependencies, culls the passes whose outputs nobody reads (down
+ * from the retained resources, such as the output framebuffer), and works out the lifetime of every transient target,
+ * which is acquired from the render target pool right before the first pass that uses it and released right after the
+ * last one, so that transients that are never alive at the same time share a texture.  Running a pass binds the inputs
+ * it declared with a texture unit, and times it with the GPU timer of its pass identifier.
+ * Resources are either imported (textures, possibly 0, that outlive the frame) or transient (created from a descriptor).
+ * Resources with no texture, such as the output framebuffer or data kept in buffers, only carry dependencies.  The graph
+ * is declared again every frame.
+ */
+class FrameGraph
+{
+public:
+	typedef int Resource;
+	static const Resource NONE = -1;			// No resource: an input bound to its unit as texture 0.
+	static const int UNTIMED = -1;				// Pass identifier of passes without a GPU timer.
+
+	struct Input
+	{
+		Resource resource;
+		int unit;								// Texture unit the graph binds it to, or -1 if the pass binds it itself.
+
+		Input( Resource resource = NONE, int unit = -1 );
+	};
+
+private:
+	struct ResourceNode
+	{
+		string name;
+		GLuint texture;
+		bool transient;
+		RenderTargetPool::Descriptor descriptor;
+		function<void()> configure;				// Sampling parameters of a transient, set while it's bound after acquisition.
+		bool retained;							// Whether the frame's results depend on it (roots of the culling).
+		int firstUse;							// Positions in the execution order of the first and last pass using it.
+		int lastUse;
+	};
+
+	struct PassNode
+	{
+		int id;
+		string name;
+		vector<Input> inputs;
+		vector<Resource> outputs;
+		function<void()> execute;
+		bool culled;
+	};
+
+	vector<ResourceNode> resources;
+	vector<PassNode> passes;
+	vector<int> order;							// Passes to run, by declaration index.
+	int aliasedTextures = 0;					// Textures the transients of the last frame took from the pool.
+	RenderTargetPool* pool = nullptr;			// Pool that transients come from while executing.
+
+	void compile();
+
+public:
+	void reset();
+	Resource import( const string& name, GLuint texture );
+	Resource create( const string& name, const RenderTargetPool::Descriptor& descriptor, function<void()> configure = nullptr );
+	void retain( Resource resource );
+	void addPass( int id, const string& name, const vector<Input>& inputs, const vector<Resource>& outputs, function<void()> execute );
+	void execute( RenderTargetPool& targetPool, GPUTimer* timers, unsigned long frame );
+	GLuint getTexture( Resource resource ) const;
+	GLuint getFramebuffer( Resource resource ) const;
+	bool isExecuted( int id ) const;
+	void report( ostream& os ) const;
+};
+
+#endif /* FrameGraph_h */
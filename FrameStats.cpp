@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include "FrameStats.h"
+
+const size_t FrameStats::FPS_WINDOW;
+const size_t FrameStats::HISTOGRAM_BUCKETS;
+constexpr double FrameStats::HISTOGRAM_BUCKET_MS;
+
+/**
+ * Constructor.
+ * @param capacity Number of frames kept in each ring buffer.
+ * @param hitchFactor A frame interval larger than hitchFactor times the running median is flagged as a hitch.
+ * @param hitchMinimumMs Minimum excess (in milliseconds) over the median for a frame to count as a hitch.
+ */
+FrameStats::FrameStats( size_t capacity, double hitchFactor, double hitchMinimumMs )
+{
+	this->capacity = max( capacity, FPS_WINDOW );
+	this->hitchFactor = hitchFactor;
+	this->hitchMinimumMs = hitchMinimumMs;
+
+	for( int s = FRAME; s <= GPU; s++ )
+	{
+		samples[s].assign( this->capacity, 0.0 );
+		histograms[s].assign( HISTOGRAM_BUCKETS, 0 );
+		counts[s] = heads[s] = 0;
+	}
+
+	hitchFlags.assign( this->capacity, false );
+	totalFrames = totalHitches = 0;
+	started = false;
+}
+
+/**
+ * Append a sample to a series and its histogram.
+ * @param s Series.
+ * @param ms Duration in milliseconds.
+ */
+void FrameStats::push( Series s, double ms )
+{
+	samples[s][heads[s]] = ms;
+	heads[s] = ( heads[s] + 1 ) % capacity;
+	counts[s] = min( counts[s] + 1, capacity );
+
+	auto bucket = static_cast<size_t>( ms / HISTOGRAM_BUCKET_MS );
+	histograms[s][min( bucket, HISTOGRAM_BUCKETS - 1 )]++;
+}
+
+/**
+ * Collect the most recent samples of a series, oldest first.
+ * @param s Series.
+ * @param n Maximum number of samples.
+ * @return Samples in chronological order.
+ */
+vector<double> FrameStats::recent( Series s, size_t n ) const
+{
+	n = min( n, counts[s] );
+	vector<double> out( n );
+	for( size_t i = 0; i < n; i++ )
+		out[i] = samples[s][( heads[s] + capacity - n + i ) % capacity];
+	return out;
+}
+
+/**
+ * Mark the beginning of the CPU work for a new frame.
+ */
+void FrameStats::beginFrame()
+{
+	frameStart = Clock::now();
+	if( !started )								// The very first frame has no previous one to measure an interval against.
+	{
+		lastFrameEnd = frameStart;
+		started = true;
+	}
+}
+
+/**
+ * Mark the end of the CPU work for the current frame (right after submitting it, before swapping buffers).
+ * The frame interval is measured between consecutive calls, so it includes any waiting for vertical sync.
+ */
+void FrameStats::endFrame()
+{
+	Clock::time_point now = Clock::now();
+	double cpuMs = chrono::duration<double, milli>( now - frameStart ).count();
+	double frameMs = chrono::duration<double, milli>( now - lastFrameEnd ).count();
+	lastFrameEnd = now;
+	totalFrames++;
+
+	push( CPU, cpuMs );
+	if( totalFrames == 1 )						// First interval only covers the first frame's submission.
+		return;
+
+	// Hitch detection against the median of the frames recorded so far.
+	bool hitch = false;
+	if( counts[FRAME] >= FPS_WINDOW / 4 )
+	{
+		double median = summarize( FRAME ).p50;
+		hitch = frameMs > max( hitchFactor * median, median + hitchMinimumMs );
+	}
+
+	hitchFlags[heads[FRAME]] = hitch;
+	push( FRAME, frameMs );
+	if( hitch )
+		totalHitches++;
+}
+
+/**
+ * Record the GPU time of a frame.  GPU times arrive a few frames late, so they form their own series.
+ * @param ms GPU time in milliseconds.
+ */
+void FrameStats::addGPUTime( double ms )
+{
+	push( GPU, ms );
+}
+
+/**
+ * Frames per second over the last FPS_WINDOW frames.
+ * @return Frame rate, or 0 if no frames have been recorded yet.
+ */
+double FrameStats::getFPS() const
+{
+	vector<double> window = recent( FRAME, FPS_WINDOW );
+	double total = 0;
+	for( double ms : window )
+		total += ms;
+	return ( total > 0 )? 1000.0 * window.size() / total : 0.0;
+}
+
+/**
+ * Retrieve the latest sample of a series.
+ * @param s Series.
+ * @return Last recorded duration in milliseconds, or 0 if there is none.
+ */
+double FrameStats::getLast( Series s ) const
+{
+	if( counts[s] == 0 )
+		return 0;
+	return samples[s][( heads[s] + capacity - 1 ) % capacity];
+}
+
+/**
+ * Compute statistics over the frames currently held in a series' ring buffer.
+ * @param s Series.
+ * @return Summary with mean, variance, p50, p95, p99, and max (all zero if the series is empty).
+ */
+FrameStats::Summary FrameStats::summarize( Series s ) const
+{
+	return summarize( recent( s, counts[s] ) );
+}
+
+/**
+ * Compute statistics over an arbitrary set of durations.
+ * Percentiles use the nearest-rank method.
+ * @param values Durations in milliseconds (in any order).
+ * @return Summary with mean, variance, p50, p95, p99, and max (all zero if there are no values).
+ */
+FrameStats::Summary FrameStats::summarize( vector<double> values )
+{
+	Summary summary = { 0, 0, 0, 0, 0, 0, 0 };
+	if( values.empty() )
+		return summary;
+
+	sort( values.begin(), values.end() );
+	size_t n = values.size();
+
+	double sum = 0, sum2 = 0;
+	for( double ms : values )
+	{
+		sum += ms;
+		sum2 += ms * ms;
+	}
+
+	auto rank = [&values, n]( double p ) {
+		auto i = static_cast<size_t>( ceil( p * n ) );
+		return values[min( max( i, static_cast<size_t>( 1 ) ), n ) - 1];
+	};
+
+	summary.count = n;
+	summary.mean = sum / n;
+	summary.variance = max( 0.0, sum2 / n - summary.mean * summary.mean );
+	summary.p50 = rank( 0.50 );
+	summary.p95 = rank( 0.95 );
+	summary.p99 = rank( 0.99 );
+	summary.max = values.back();
+	return summary;
+}
+
+/**
+ * Number of frames recorded since the start.
+ * @return Frame count.
+ */
+unsigned long FrameStats::getTotalFrames() const
+{
+	return totalFrames;
+}
+
+/**
+ * Number of hitches detected since the start.
+ * @return Hitch count.
+ */
+unsigned long FrameStats::getTotalHitches() const
+{
+	return totalHitches;
+}
+
+/**
+ * Whether the most recent frame was flagged as a hitch.
+ * @return True for a hitch.
+ */
+bool FrameStats::lastFrameWasHitch() const
+{
+	return counts[FRAME] > 0 && hitchFlags[( heads[FRAME] + capacity - 1 ) % capacity];
+}
+
+/**
+ * Fill out the data for the on-screen frame-time graph.
+ * @param n Number of most recent frames to plot.
+ * @param values Frame intervals in milliseconds, oldest first.
+ * @param hitches Same length as values: the frame interval if the frame was a hitch, 0 otherwise.
+ */
+void FrameStats::getGraph( size_t n, vector<float>& values, vector<float>& hitches ) const
+{
+	n = min( n, counts[FRAME] );
+	values.resize( n );
+	hitches.resize( n );
+	for( size_t i = 0; i < n; i++ )
+	{
+		size_t index = ( heads[FRAME] + capacity - n + i ) % capacity;
+		values[i] = static_cast<float>( samples[FRAME][index] );
+		hitches[i] = hitchFlags[index]? values[i] : 0.0f;
+	}
+}
+
+/**
+ * Write the whole-run histograms and the summary of the most recent frames.
+ * @param os Output stream.
+ */
+void FrameStats::dumpHistogram( ostream& os ) const
+{
+	const char* names[] = { "frame", "cpu", "gpu" };
+
+	os << "# Frames: " << totalFrames << ", hitches: " << totalHitches << endl;
+	for( int s = FRAME; s <= GPU; s++ )
+	{
+		Summary summary = summarize( static_cast<Series>( s ) );
+		os << fixed << setprecision( 3 )
+		   << "# " << names[s] << " (last " << summary.count << "): mean " << summary.mean << " var " << summary.variance
+		   << " p50 " << summary.p50 << " p95 " << summary.p95 << " p99 " << summary.p99 << " max " << summary.max << " ms" << endl;
+	}
+
+	os << "# bucket_ms\tframe\tcpu\tgpu" << endl;
+	size_t last = 0;							// Skip trailing empty buckets.
+	for( size_t b = 0; b < HISTOGRAM_BUCKETS; b++ )
+		if( histograms[FRAME][b] || histograms[CPU][b] || histograms[GPU][b] )
+			last = b;
+
+	for( size_t b = 0; b <= last; b++ )
+	{
+		os << setprecision( 1 ) << b * HISTOGRAM_BUCKET_MS << ( ( b == HISTOGRAM_BUCKETS - 1 )? "+" : "" ) << "\t"
+		   << histograms[FRAME][b] << "\t" << histograms[CPU][b] << "\t" << histograms[GPU][b] << endl;
+	}
+}
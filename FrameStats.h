@@ -0,0 +1,75 @@
+#ifndef FrameStats_h
+#define FrameStats_h
+
+#include <chrono>
+#include <vector>
+#include <ostream>
+
+using namespace std;
+
+/**
+ * Frame-time recorder.
+ * Keeps a ring buffer of per-frame intervals, CPU times, and GPU times (all in milliseconds) measured with a monotonic
+ * high-resolution clock, and derives percentiles, variance, and hitches from them.  A cumulative histogram of the whole
+ * run is also kept so that it can be dumped on exit.
+ */
+class FrameStats
+{
+public:
+	enum Series { FRAME, CPU, GPU };			// Frame interval (wall time between frames), CPU submission time, GPU time.
+
+	struct Summary
+	{
+		size_t count;							// Number of samples summarized.
+		double mean;
+		double variance;
+		double p50;
+		double p95;
+		double p99;
+		double max;
+	};
+
+private:
+	typedef chrono::steady_clock Clock;
+
+	static const size_t FPS_WINDOW = 64;				// Number of most recent frames used to report the frame rate.
+	static const size_t HISTOGRAM_BUCKETS = 200;		// Histogram buckets; the last one collects everything larger.
+	static constexpr double HISTOGRAM_BUCKET_MS = 0.5;		// Histogram bucket width.
+
+	size_t capacity;							// Ring buffer size.
+	double hitchFactor;							// A frame is a hitch if it lasts this much longer than the median.
+	double hitchMinimumMs;						// ... and at least this many extra milliseconds.
+
+	vector<double> samples[3];					// Ring buffers, one per series.
+	size_t counts[3];							// Valid entries in each ring buffer.
+	size_t heads[3];							// Next write position in each ring buffer.
+	vector<unsigned long> histograms[3];		// Whole-run histograms, one per series.
+
+	vector<bool> hitchFlags;					// Parallel to the FRAME ring buffer.
+	unsigned long totalFrames;
+	unsigned long totalHitches;
+
+	Clock::time_point frameStart;				// When the current frame started being recorded on the CPU.
+	Clock::time_point lastFrameEnd;				// When the previous frame finished.
+	bool started;
+
+	void push( Series s, double ms );
+	vector<double> recent( Series s, size_t n ) const;
+
+public:
+	FrameStats( size_t capacity = 512, double hitchFactor = 2.0, double hitchMinimumMs = 4.0 );
+	void beginFrame();
+	void endFrame();
+	void addGPUTime( double ms );
+	double getFPS() const;
+	double getLast( Series s ) const;
+	Summary summarize( Series s ) const;
+	static Summary summarize( vector<double> values );
+	unsigned long getTotalFrames() const;
+	unsigned long getTotalHitches() const;
+	bool lastFrameWasHitch() const;
+	void getGraph( size_t n, vector<float>& values, vector<float>& hitches ) const;
+	void dumpHistogram( ostream& os ) const;
+};
+
+#endif /* FrameStats_h */
@@ -0,0 +1,128 @@
+#include "GPUTimer.h"
+
+/**
+ * Constructor.
+ */
+GPUTimer::GPUTimer()
+{
+	for( int i = 0; i < QUERY_LATENCY; i++ )
+	{
+		queries[i][0] = queries[i][1] = 0;
+		pending[i] = false;
+		issued[i] = 0;
+	}
+	current = 0;
+	milliseconds = 0;
+	available = false;
+	fresh = false;
+	resultFrame = 0;
+}
+
+/**
+ * Allocate the OpenGL query objects.  Must be called once a context is current.
+ */
+void GPUTimer::init()
+{
+	for( auto& q : queries )
+		glGenQueries( 2, q );
+}
+
+/**
+ * Collect the result of a query pair if the GPU has finished with it.
+ * @param slot Ring slot to check.
+ * @return True if a new elapsed time was read back.
+ */
+bool GPUTimer::collect( int slot )
+{
+	if( !pending[slot] )
+		return false;
+
+	GLint ready = 0;
+	glGetQueryObjectiv( queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &ready );
+	if( !ready )								// Still in flight: try again once the ring comes back to this slot.
+		return false;
+
+	GLuint64 t0, t1;
+	glGetQueryObjectui64v( queries[slot][0], GL_QUERY_RESULT, &t0 );
+	glGetQueryObjectui64v( queries[slot][1], GL_QUERY_RESULT, &t1 );
+	milliseconds = ( t1 - t0 ) / 1.0e6;			// Nanoseconds to milliseconds.
+	resultFrame = issued[slot];
+	pending[slot] = false;
+	available = true;
+	return true;
+}
+
+/**
+ * Issue the starting timestamp of a new measurement.
+ * The slot is recycled only if its previous result could be collected; otherwise this measurement is skipped.
+ * @param frame Frame number to tag the measurement with (see getResultFrame()).
+ */
+void GPUTimer::begin( unsigned long frame )
+{
+	fresh = collect( current );
+	if( pending[current] )						// The GPU is more than QUERY_LATENCY frames behind: don't block, skip it.
+		return;
+	glQueryCounter( queries[current][0], GL_TIMESTAMP );
+	issued[current] = frame;
+}
+
+/**
+ * Issue the ending timestamp of the current measurement and advance the ring.
+ */
+void GPUTimer::end()
+{
+	if( pending[current] )						// Matching begin() was skipped.
+		return;
+	glQueryCounter( queries[current][1], GL_TIMESTAMP );
+	pending[current] = true;
+	current = ( current + 1 ) % QUERY_LATENCY;
+}
+
+/**
+ * Whether at least one measurement has been collected.
+ * @return True if getMilliseconds() is meaningful.
+ */
+bool GPUTimer::hasResult() const
+{
+	return available;
+}
+
+/**
+ * Whether the most recent begin() collected a new measurement.
+ * @return True if getMilliseconds() changed since the previous frame.
+ */
+bool GPUTimer::hasNewResult() const
+{
+	return fresh;
+}
+
+/**
+ * Retrieve the last collected GPU time.
+ * @return Elapsed time in milliseconds (lagging QUERY_LATENCY frames behind).
+ */
+double GPUTimer::getMilliseconds() const
+{
+	return milliseconds;
+}
+
+/**
+ * Frame that issued the last collected GPU time.
+ * @return Frame number given to the begin() call of that measurement.
+ */
+unsigned long GPUTimer::getResultFrame() const
+{
+	return resultFrame;
+}
+
+/**
+ * Release the OpenGL query objects.
+ */
+void GPUTimer::destroy()
+{
+	for( auto& q : queries )
+	{
+		if( q[0] != 0 )
+			glDeleteQueries( 2, q );
+		q[0] = q[1] = 0;
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef GPUTimer_h
+#define GPUTimer_h
+
+#include "OpenGLHeaders.h"
+
+/**
+ * Measure the GPU time spent between a begin() and an end() call using timestamp queries.
+ * Queries are kept in a small ring, and each result is collected a few frames after it was issued, so that reading
+ * it back never stalls the pipeline.  Since timestamps (rather than elapsed-time queries) are used, timers may nest.
+ * Every measurement is tagged with the frame that issued it, so that late results can be told apart from current ones.
+ */
+class GPUTimer
+{
+private:
+	static const int QUERY_LATENCY = 4;			// Frames between issuing a query pair and collecting its result.
+
+	GLuint queries[QUERY_LATENCY][2];			// Begin and end timestamp query objects.
+	bool pending[QUERY_LATENCY];				// Whether a query pair has been issued but not yet collected.
+	unsigned long issued[QUERY_LATENCY];		// Frame that issued each query pair.
+	int current;								// Ring slot used by the next begin()/end() pair.
+	double milliseconds;						// Most recently collected elapsed time.
+	bool available;								// Whether milliseconds holds a valid result.
+	bool fresh;									// Whether the last begin() collected a new result.
+	unsigned long resultFrame;					// Frame that issued the measurement in milliseconds.
+
+	bool collect( int slot );
+
+public:
+	GPUTimer();
+	void init();
+	void begin( unsigned long frame = 0 );
+	void end();
+	bool hasResult() const;
+	bool hasNewResult() const;
+	double getMilliseconds() const;
+	unsigned long getResultFrame() const;
+	void destroy();
+};
+
+#endif /* GPUTimer_h */
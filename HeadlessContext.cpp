@@ -0,0 +1,166 @@
+#include <iostream>
+#include <cstring>
+#include "HeadlessContext.h"
+
+/**
+ * Create the off-screen context and make it current.
+ * @param width Width of the target framebuffer created later with createTarget().
+ * @param height Height of the target framebuffer.
+ * @return True if an OpenGL 4.1 core context is current on success, false otherwise.
+ */
+bool HeadlessContext::create( int width, int height )
+{
+	this->width = width;
+	this->height = height;
+
+#ifdef RSM_OSMESA
+	const int attributes[] = {
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_DEPTH_BITS, 24,
+		OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 4,
+		OSMESA_CONTEXT_MINOR_VERSION, 1,
+		0 };
+	context = OSMesaCreateContextAttribs( attributes, nullptr );
+	if( !context )
+	{
+		cerr << "[Headless] Unable to create an OpenGL 4.1 core OSMesa context!" << endl;
+		return false;
+	}
+
+	buffer.resize( static_cast<size_t>( width ) * height * 4 );
+	if( !OSMesaMakeCurrent( context, buffer.data(), GL_UNSIGNED_BYTE, width, height ) )
+	{
+		cerr << "[Headless] Unable to make the OSMesa context current!" << endl;
+		return false;
+	}
+#else
+	// Prefer a surfaceless display, which needs neither X11 nor Wayland; otherwise, fall back to the default display.
+	auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>( eglGetProcAddress( "eglGetPlatformDisplayEXT" ) );
+	const char* extensions = eglQueryString( EGL_NO_DISPLAY, EGL_EXTENSIONS );
+	if( getPlatformDisplay && extensions && strstr( extensions, "EGL_MESA_platform_surfaceless" ) )
+		display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr );
+	if( display == EGL_NO_DISPLAY )
+		display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+	EGLint major, minor;
+	if( display == EGL_NO_DISPLAY || !eglInitialize( display, &major, &minor ) )
+	{
+		cerr << "[Headless] Unable to initialize an EGL display!" << endl;
+		return false;
+	}
+	cout << "EGL " << major << "." << minor << " " << eglQueryString( display, EGL_VENDOR ) << endl;
+
+	if( !eglBindAPI( EGL_OPENGL_API ) )
+	{
+		cerr << "[Headless] EGL display doesn't support desktop OpenGL!" << endl;
+		return false;
+	}
+
+	// No config is needed because we never create a surface (EGL_KHR_no_config_context).
+	const EGLint attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 1,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE };
+	context = eglCreateContext( display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes );
+	if( context == EGL_NO_CONTEXT )
+	{
+		cerr << "[Headless] Unable to create an OpenGL 4.1 core EGL context (error 0x" << hex << eglGetError() << dec << ")!" << endl;
+		return false;
+	}
+
+	if( !eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, context ) )
+	{
+		cerr << "[Headless] Unable to make the EGL context current!" << endl;
+		return false;
+	}
+#endif
+
+	cout << glGetString( GL_RENDERER ) << " | " << glGetString( GL_VERSION ) << endl;
+	return true;
+}
+
+/**
+ * Create the framebuffer object that stands in for the (missing) default framebuffer.
+ * @return True if the framebuffer is complete, false otherwise.
+ */
+bool HeadlessContext::createTarget()
+{
+	glGenFramebuffers( 1, &targetFBO );
+	glBindFramebuffer( GL_FRAMEBUFFER, targetFBO );
+
+	glGenTextures( 1, &targetColor );
+	glBindTexture( GL_TEXTURE_2D, targetColor );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targetColor, 0 );
+
+	glGenRenderbuffers( 1, &targetDepth );
+	glBindRenderbuffer( GL_RENDERBUFFER, targetDepth );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, targetDepth );
+
+	bool complete = ( glCheckFramebufferStatus( GL_FRAMEBUFFER ) == GL_FRAMEBUFFER_COMPLETE );
+	if( !complete )
+		cerr << "[Headless] Target framebuffer not complete!" << endl;
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	return complete;
+}
+
+/**
+ * Target framebuffer object, to be rendered into instead of the default framebuffer.
+ * @return Framebuffer object name.
+ */
+GLuint HeadlessContext::getTargetFBO() const
+{
+	return targetFBO;
+}
+
+/**
+ * Read back the target framebuffer's color (blocking until rendering is done).
+ * @param pixels Receives width x height RGBA pixels, bottom row first.
+ */
+void HeadlessContext::readTarget( vector<unsigned char>& pixels ) const
+{
+	pixels.resize( static_cast<size_t>( width ) * height * 4 );
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, targetFBO );
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+	glReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data() );
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+}
+
+/**
+ * Release the target framebuffer.
+ */
+void HeadlessContext::destroyTarget()
+{
+	glDeleteTextures( 1, &targetColor );
+	glDeleteRenderbuffers( 1, &targetDepth );
+	glDeleteFramebuffers( 1, &targetFBO );
+	targetFBO = targetColor = targetDepth = 0;
+}
+
+/**
+ * Release the context.  Every OpenGL object must have been deleted before.
+ */
+void HeadlessContext::destroy()
+{
+#ifdef RSM_OSMESA
+	if( context )
+		OSMesaDestroyContext( context );
+	context = nullptr;
+	buffer.clear();
+#else
+	if( display != EGL_NO_DISPLAY )
+	{
+		eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+		if( context != EGL_NO_CONTEXT )
+			eglDestroyContext( display, context );
+		eglTerminate( display );
+	}
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+#endif
+}
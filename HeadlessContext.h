@@ -0,0 +1,48 @@
+#ifndef HeadlessContext_h
+#define HeadlessContext_h
+
+#include <vector>
+#ifdef RSM_OSMESA
+	#include <GL/osmesa.h>
+#else
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+#endif
+#include "OpenGLHeaders.h"
+
+using namespace std;
+
+/**
+ * OpenGL 4.1 core context without a window, for render farm nodes and continuous integration machines.
+ * By default it uses a surfaceless EGL display (e.g. Mesa's llvmpipe, or a GPU driver without a display server); when
+ * compiled with RSM_OSMESA it uses an off-screen Mesa context instead.  Either way there's no usable default framebuffer,
+ * so callers render into the target framebuffer object instead (see createTarget()).
+ */
+class HeadlessContext
+{
+private:
+#ifdef RSM_OSMESA
+	OSMesaContext context = nullptr;
+	vector<unsigned char> buffer;				// OSMesa requires a color buffer to make its context current.
+#else
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+#endif
+
+	// Framebuffer object replacing the default framebuffer.
+	int width = 0;
+	int height = 0;
+	GLuint targetFBO = 0;
+	GLuint targetColor = 0;						// RGBA8 color texture.
+	GLuint targetDepth = 0;						// Depth renderbuffer.
+
+public:
+	bool create( int width, int height );
+	bool createTarget();
+	GLuint getTargetFBO() const;
+	void readTarget( vector<unsigned char>& pixels ) const;
+	void destroyTarget();
+	void destroy();
+};
+
+#endif /* HeadlessContext_h */
@@ -0,0 +1,122 @@
+#include <cmath>
+#include <algorithm>
+#include "ImageCompare.h"
+
+constexpr double ImageCompare::MAX_PSNR;
+
+/**
+ * Convert an image to luma (Rec. 601 weights for color images, the first channel otherwise).
+ * @param pixels Interleaved 8-bit pixels.
+ * @param width Image width.
+ * @param height Image height.
+ * @param channels Channels per pixel.
+ * @return Luma values in [0, 255].
+ */
+vector<double> ImageCompare::luma( const vector<unsigned char>& pixels, int width, int height, int channels )
+{
+	vector<double> y( static_cast<size_t>( width ) * height );
+	for( size_t i = 0; i < y.size(); i++ )
+	{
+		const unsigned char* p = &pixels[i * channels];
+		y[i] = ( channels >= 3 )? 0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2] : p[0];
+	}
+	return y;
+}
+
+/**
+ * Peak signal-to-noise ratio over every channel.
+ * @param a First image.
+ * @param b Second image, with the same size and layout as a.
+ * @return PSNR in decibels, or MAX_PSNR if the images are identical.
+ */
+double ImageCompare::psnr( const vector<unsigned char>& a, const vector<unsigned char>& b )
+{
+	double sum = 0;
+	for( size_t i = 0; i < a.size(); i++ )
+	{
+		double d = static_cast<double>( a[i] ) - b[i];
+		sum += d * d;
+	}
+
+	double mse = sum / max( a.size(), static_cast<size_t>( 1 ) );
+	if( mse == 0 )
+		return MAX_PSNR;
+	return min( MAX_PSNR, 10.0 * log10( 255.0 * 255.0 / mse ) );
+}
+
+/**
+ * Mean structural similarity of the luma of two images, over 8x8 windows placed every 4 pixels.
+ * @param a First image.
+ * @param b Second image, with the same size and layout as a.
+ * @param width Image width.
+ * @param height Image height.
+ * @param channels Channels per pixel.
+ * @return SSIM in [-1, 1], where 1 means identical.
+ */
+double ImageCompare::ssim( const vector<unsigned char>& a, const vector<unsigned char>& b, int width, int height, int channels )
+{
+	const int WINDOW = 8, STEP = 4;
+	const double C1 = ( 0.01 * 255 ) * ( 0.01 * 255 ), C2 = ( 0.03 * 255 ) * ( 0.03 * 255 );
+
+	vector<double> ya = luma( a, width, height, channels );
+	vector<double> yb = luma( b, width, height, channels );
+
+	double total = 0;
+	int windows = 0;
+	for( int y0 = 0; y0 + WINDOW <= height; y0 += STEP )
+	{
+		for( int x0 = 0; x0 + WINDOW <= width; x0 += STEP )
+		{
+			double sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+			for( int y = y0; y < y0 + WINDOW; y++ )
+			{
+				for( int x = x0; x < x0 + WINDOW; x++ )
+				{
+					double va = ya[y * width + x], vb = yb[y * width + x];
+					sa += va;
+					sb += vb;
+					saa += va * va;
+					sbb += vb * vb;
+					sab += va * vb;
+				}
+			}
+
+			const double n = WINDOW * WINDOW;
+			double ma = sa / n, mb = sb / n;
+			double va = saa / n - ma * ma, vb = sbb / n - mb * mb, cov = sab / n - ma * mb;
+			total += ( ( 2 * ma * mb + C1 ) * ( 2 * cov + C2 ) ) / ( ( ma * ma + mb * mb + C1 ) * ( va + vb + C2 ) );
+			windows++;
+		}
+	}
+
+	return ( windows > 0 )? total / windows : 1.0;
+}
+
+/**
+ * Build a heat map of the per-pixel difference between two images: black where they match, then red, yellow, and white
+ * as the largest channel difference grows.
+ * @param a First image.
+ * @param b Second image, with the same size and layout as a.
+ * @param width Image width.
+ * @param height Image height.
+ * @param channels Channels per pixel.
+ * @param rgb Receives the RGB heat map, with the same row order as the input images.
+ * @param gain Amplification of the differences, so that small errors stand out.
+ */
+void ImageCompare::heatmap( const vector<unsigned char>& a, const vector<unsigned char>& b, int width, int height, int channels,
+							vector<unsigned char>& rgb, double gain )
+{
+	const size_t n = static_cast<size_t>( width ) * height;
+	rgb.resize( n * 3 );
+	for( size_t i = 0; i < n; i++ )
+	{
+		int d = 0;
+		for( int c = 0; c < channels; c++ )
+			d = max( d, abs( static_cast<int>( a[i * channels + c] ) - b[i * channels + c] ) );
+
+		double t = min( 1.0, gain * d / 255.0 ) * 3.0;				// Three ramps: red, green, then blue.
+		rgb[i * 3 + 0] = static_cast<unsigned char>( 255 * min( t, 1.0 ) );
+		rgb[i * 3 + 1] = static_cast<unsigned char>( 255 * min( max( t - 1.0, 0.0 ), 1.0 ) );
+		rgb[i * 3 + 2] = static_cast<unsigned char>( 255 * min( max( t - 2.0, 0.0 ), 1.0 ) );
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef ImageCompare_h
+#define ImageCompare_h
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * Image quality metrics and difference visualization for 8-bit images of equal size with interleaved channels.
+ */
+class ImageCompare
+{
+private:
+	static vector<double> luma( const vector<unsigned char>& pixels, int width, int height, int channels );
+
+public:
+	static constexpr double MAX_PSNR = 100.0;		// Reported for identical images.
+
+	static double psnr( const vector<unsigned char>& a, const vector<unsigned char>& b );
+	static double ssim( const vector<unsigned char>& a, const vector<unsigned char>& b, int width, int height, int channels );
+	static void heatmap( const vector<unsigned char>& a, const vector<unsigned char>& b, int width, int height, int channels,
+						 vector<unsigned char>& rgb, double gain = 4.0 );
+};
+
+#endif /* ImageCompare_h */
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <cstdio>
+#include <png.h>
+#include "ImageIO.h"
+#include "stb_image.h"
+
+/**
+ * Write an 8-bit per channel image into a PNG file.
+ * @param filename Output file name.
+ * @param width Image width in pixels.
+ * @param height Image height in pixels.
+ * @param channels Number of interleaved channels: 1 (gray), 3 (RGB), or 4 (RGBA).
+ * @param pixels Tightly packed rows of pixels.
+ * @param flipVertically Whether the first row is the bottom one, as read back with glReadPixels.
+ * @return True if the file was written successfully, false otherwise.
+ */
+bool ImageIO::writePNG( const string& filename, int width, int height, int channels, const unsigned char* pixels, bool flipVertically )
+{
+	int colorType;
+	switch( channels )
+	{
+		case 1: colorType = PNG_COLOR_TYPE_GRAY; break;
+		case 3: colorType = PNG_COLOR_TYPE_RGB; break;
+		case 4: colorType = PNG_COLOR_TYPE_RGBA; break;
+		default:
+			cerr << "[ImageIO] Unsupported number of channels: " << channels << endl;
+			return false;
+	}
+
+	FILE* file = fopen( filename.c_str(), "wb" );
+	if( !file )
+	{
+		cerr << "[ImageIO] Unable to open file " << filename << endl;
+		return false;
+	}
+
+	png_structp png = png_create_write_struct( PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr );
+	png_infop info = ( png )? png_create_info_struct( png ) : nullptr;
+	if( !png || !info || setjmp( png_jmpbuf( png ) ) )		// libpng reports errors by jumping back here.
+	{
+		cerr << "[ImageIO] Failed to write " << filename << endl;
+		png_destroy_write_struct( &png, &info );
+		fclose( file );
+		return false;
+	}
+
+	// Frames are written many times per second, so favor speed over file size.
+	png_init_io( png, file );
+	png_set_compression_level( png, 1 );
+	png_set_filter( png, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB );
+	png_set_IHDR( png, info, static_cast<png_uint_32>( width ), static_cast<png_uint_32>( height ), 8, colorType, PNG_INTERLACE_NONE,
+				  PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT );
+	png_write_info( png, info );
+
+	const size_t stride = static_cast<size_t>( width ) * channels;
+	vector<png_bytep> rows( static_cast<size_t>( height ) );
+	for( int i = 0; i < height; i++ )
+		rows[i] = const_cast<png_bytep>( pixels + stride * ( flipVertically? height - 1 - i : i ) );
+	png_write_image( png, rows.data() );
+	png_write_end( png, nullptr );
+
+	png_destroy_write_struct( &png, &info );
+	fclose( file );
+	return true;
+}
+
+/**
+ * Read an image file (PNG or any other format supported by stb_image) as 8 bits per channel.
+ * @param filename Input file name.
+ * @param width Receives the image width in pixels.
+ * @param height Receives the image height in pixels.
+ * @param channels Number of channels to convert the image to: 1 (gray), 3 (RGB), or 4 (RGBA).
+ * @param pixels Receives tightly packed rows of pixels, top row first.
+ * @return True if the file was read successfully, false otherwise.
+ */
+bool ImageIO::readPNG( const string& filename, int& width, int& height, int channels, vector<unsigned char>& pixels )
+{
+	int fileChannels;
+	stbi_set_flip_vertically_on_load( false );			// The flag is global, and textures for 3D objects set it.
+	unsigned char* data = stbi_load( filename.c_str(), &width, &height, &fileChannels, channels );
+	if( !data )
+		return false;
+
+	pixels.assign( data, data + static_cast<size_t>( width ) * height * channels );
+	stbi_image_free( data );
+	return true;
+}
@@ -0,0 +1,19 @@
+#ifndef ImageIO_h
+#define ImageIO_h
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Saving rendered frames as image files, and loading them back.
+ */
+class ImageIO
+{
+public:
+	static bool writePNG( const string& filename, int width, int height, int channels, const unsigned char* pixels, bool flipVertically = true );
+	static bool readPNG( const string& filename, int& width, int& height, int channels, vector<unsigned char>& pixels );
+};
+
+#endif /* ImageIO_h */
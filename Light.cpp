@@ -38,3 +38,22 @@ void Light::rotateBy( float angle )
 	lAngle += angle;
 	position = { lXZRadius * sin( lAngle ), lY, lXZRadius * cos( lAngle ) };						// New position.
 }
+
+/**
+ * Rotate light around y-axis to an absolute angle.
+ * @param angle Angle in radians with respect to +z in the xz-plane.
+ */
+void Light::rotateTo( float angle )
+{
+	rotateBy( angle - lAngle );
+}
+
+/**
+ * Point the light towards a target and update its view and light space matrices.
+ * @param target Point of interest in world space.
+ */
+void Light::lookAt( const vec3& target )
+{
+	View = Tx::lookAt( position, target, Tx::Y_AXIS );
+	SpaceMatrix = Projection * View;
+}
@@ -10,7 +10,8 @@
 #define Light_h
 
 #include <armadillo>
-#include <OpenGL/gl3.h>
+#include "OpenGLHeaders.h"
+#include "Transformations.h"
 
 using namespace arma;
 
@@ -28,17 +29,14 @@ public:
 	vec3 position;				// 3D world light location.
 	vec3 color;					// Color in RGB.
 	mat44 Projection;			// Projection matrix.
+	mat44 View;					// View matrix (from the light towards its target).
 	mat44 SpaceMatrix;			// Product of Light Projection * Light View.
-	
-	GLuint rsmFBO;				// OpenGL frame buffer object for the reflective shadow map.
-	GLuint rsmPosition;			// Texture ID for world space positions.
-	GLuint rsmNormal;			// Texture ID for world space normals.
-	GLuint rsmFlux;				// Texture ID for the flux (= material's albedo times light color).
-	GLuint rsmDepth;			// Texture ID for depth (= same used in shadow mapping).
 
 	Light();
 	Light( const vec3& p, const vec3& c, const mat44& P );
 	void rotateBy( float angle );
+	void rotateTo( float angle );
+	void lookAt( const vec3& target );
 };
 
 #endif /* Light_h */
@@ -3,7 +3,7 @@
 
 #include <string>
 #include <iostream>
-#include <OpenGL/gl3.h>
+#include "OpenGLHeaders.h"
 #include <armadillo>
 #include "stb_image.h"
 
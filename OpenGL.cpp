@@ -575,6 +575,69 @@ void OpenGL::renderText( const char* text, const Atlas* a, float x, float y, flo
 	glDisableVertexAttribArray( a->attribute_coord_loc );
 }
 
+/**
+ * Render a bar graph (e.g. frame times) with the glyphs program.
+ * Bars reuse the atlas texture: every quad samples the center of the '|' glyph, which is fully opaque, so no extra
+ * shaders or textures are needed for on-screen graphs.
+ * @param values Bar heights, drawn left to right.
+ * @param maxValue Value mapped to the full graph height (larger values are clamped).
+ * @param a Glyphs atlas object.
+ * @param x Left x-coordinate of the graph.
+ * @param y Bottom y-coordinate of the graph.
+ * @param w Graph width.
+ * @param h Graph height.
+ * @param color Bars color as 4-tuple [r,g,b,a].
+ */
+void OpenGL::renderBars( const vector<float>& values, float maxValue, const Atlas* a, float x, float y, float w, float h, const float* color )
+{
+	if( values.empty() || maxValue <= 0 )
+		return;
+
+	// Use the texture containing the atlas.
+	glActiveTexture( GL_TEXTURE0 );
+	glBindTexture( GL_TEXTURE_2D, a->tex );
+	glUniform1i( a->uniform_tex_loc, 0 );
+
+	// Set up the VBO for our vertex data.
+	glEnableVertexAttribArray( a->attribute_coord_loc );
+	glBindBuffer( GL_ARRAY_BUFFER, glyphsBufferID );
+	glVertexAttribPointer( a->attribute_coord_loc, 4, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0) );
+
+	glUniform4fv( a->uniform_color_loc, 1, color );
+
+	// Solid texel in the middle of the vertical bar glyph.
+	const auto bar = static_cast<uint8_t>( '|' );
+	const float s = a->c[bar].tx + 0.5f * a->c[bar].bw / a->w;
+	const float t = a->c[bar].ty + 0.5f * a->c[bar].bh / a->h;
+
+	vector<GlyphPoint> coords;
+	coords.reserve( 6 * values.size() );
+	const float barWidth = w / values.size();
+	for( size_t i = 0; i < values.size(); i++ )
+	{
+		float barHeight = h * fmin( values[i], maxValue ) / maxValue;
+		if( barHeight <= 0 )
+			continue;
+
+		float x0 = x + i * barWidth, x1 = x0 + barWidth * 0.8f;		// Leave a small gap between bars.
+		float y0 = y, y1 = y + barHeight;
+		coords.push_back( { x0, y1, s, t } );
+		coords.push_back( { x1, y1, s, t } );
+		coords.push_back( { x0, y0, s, t } );
+		coords.push_back( { x1, y1, s, t } );
+		coords.push_back( { x0, y0, s, t } );
+		coords.push_back( { x1, y0, s, t } );
+	}
+
+	if( !coords.empty() )
+	{
+		glBufferData( GL_ARRAY_BUFFER, sizeof( GlyphPoint ) * coords.size(), coords.data(), GL_DYNAMIC_DRAW );
+		glDrawArrays( GL_TRIANGLES, 0, static_cast<GLsizei>( coords.size() ) );
+	}
+
+	glDisableVertexAttribArray( a->attribute_coord_loc );
+}
+
 /**
  * Get the glyphs program ID.
  * @return OpenGL program ID.
@@ -701,20 +764,24 @@ void OpenGL::renderNDCQuad()
 
 	// Set up our vertex attributes.
 	int position_location = glGetAttribLocation( renderingProgram, "aPosition" );
-	int texCoords_location = glGetAttribLocation( renderingProgram, "aTexCoords" );
-	if( position_location != -1 && texCoords_location != -1 )
+	int texCoords_location = glGetAttribLocation( renderingProgram, "aTexCoords" );	// May be optimized out if fragments only use gl_FragCoord.
+	if( position_location != -1 )
 	{
 		glEnableVertexAttribArray( static_cast<GLuint>( position_location ) );			// In this case we have a stride value.
 		glVertexAttribPointer( static_cast<GLuint>( position_location ), ELEMENTS_PER_VERTEX, GL_FLOAT, GL_FALSE, 5 * sizeof(float), BUFFER_OFFSET( 0 ) );
-		glEnableVertexAttribArray( static_cast<GLuint>( texCoords_location ) );
-		glVertexAttribPointer( static_cast<GLuint>( texCoords_location ), TEX_ELEMENTS_PER_VERTEX, GL_FLOAT, GL_FALSE, 5 * sizeof(float), BUFFER_OFFSET( 3 * sizeof(float) ) );
+		if( texCoords_location != -1 )
+		{
+			glEnableVertexAttribArray( static_cast<GLuint>( texCoords_location ) );
+			glVertexAttribPointer( static_cast<GLuint>( texCoords_location ), TEX_ELEMENTS_PER_VERTEX, GL_FLOAT, GL_FALSE, 5 * sizeof(float), BUFFER_OFFSET( 3 * sizeof(float) ) );
+		}
 
 		// Draw a triangle strip.
 		glDrawArrays( GL_TRIANGLE_STRIP, 0, ndcQuad->verticesCount );
 
 		// Disable attributes.
 		glDisableVertexAttribArray( static_cast<GLuint>( position_location ) );
-		glDisableVertexAttribArray( static_cast<GLuint>( texCoords_location ) );
+		if( texCoords_location != -1 )
+			glDisableVertexAttribArray( static_cast<GLuint>( texCoords_location ) );
 	}
 
 	// Draw a triangle strip.
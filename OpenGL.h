@@ -10,7 +10,7 @@
 
 #include <iostream>
 #include <armadillo>
-#include <OpenGL/gl3.h>
+#include "OpenGLHeaders.h"
 #include <vector>
 #include <map>
 #include "Shaders.h"
@@ -109,6 +109,7 @@ public:
 	void render3DObject( const mat44& Projection, const mat44& Camera, const mat44& Model, const char* objectType, bool useTexture = false, int textureUnit = 1 );
 	void renderNDCQuad();
 	void renderText( const char* text, const Atlas* a, float x, float y, float sx, float sy, const float* color );
+	void renderBars( const vector<float>& values, float maxValue, const Atlas* a, float x, float y, float w, float h, const float* color );
 	GLuint getGlyphsProgram();
 	void setUsingUniformScaling( bool u );
 	void create3DObject( const char* name, const char* filename, const char* textureFilename = nullptr );
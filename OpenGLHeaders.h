@@ -0,0 +1,15 @@
+#ifndef OpenGLHeaders_h
+#define OpenGLHeaders_h
+
+/**
+ * OpenGL 4.1 core profile declarations: the system framework on macOS, and the Khronos core profile header elsewhere
+ * (e.g. Mesa with EGL or OSMesa for headless rendering).
+ */
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+#endif
+
+#endif /* OpenGLHeaders_h */
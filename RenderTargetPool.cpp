@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <tuple>
+#include "RenderTargetPool.h"
+
+/**
+ * Descriptor constructor.
+ * @param internalFormat Sized (or unsized) internal format.
+ * @param width Base level width in texels.
+ * @param height Base level height in texels.
+ * @param levels Number of mip levels.
+ */
+RenderTargetPool::Descriptor::Descriptor( GLint internalFormat, GLsizei width, GLsizei height, GLint levels ):
+	internalFormat( internalFormat ), width( width ), height( height ), levels( levels )
+{}
+
+/**
+ * Order descriptors, so that they can key a map.
+ * @param other Descriptor to compare against.
+ * @return True if this descriptor goes first.
+ */
+bool RenderTargetPool::Descriptor::operator<( const Descriptor& other ) const
+{
+	return tie( internalFormat, width, height, levels ) < tie( other.internalFormat, other.width, other.height, other.levels );
+}
+
+/**
+ * @param other Descriptor to compare against.
+ * @return True if both descriptors allocate the same texture.
+ */
+bool RenderTargetPool::Descriptor::operator==( const Descriptor& other ) const
+{
+	return !( *this < other ) && !( other < *this );
+}
+
+/**
+ * Constructor: an empty pool.
+ */
+RenderTargetPool::RenderTargetPool()
+{
+	frame = 0;
+	peakBytes = 0;
+}
+
+/**
+ * @param internalFormat Internal format.
+ * @return True for depth (and depth-stencil) formats, which attach to the depth attachment point.
+ */
+bool RenderTargetPool::isDepthFormat( GLint internalFormat )
+{
+	switch( internalFormat )
+	{
+		case GL_DEPTH_COMPONENT: case GL_DEPTH_COMPONENT16: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F: case GL_DEPTH_STENCIL: case GL_DEPTH24_STENCIL8: case GL_DEPTH32F_STENCIL8:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * Take a target out of the pool, allocating it if no free target matches.  Its contents are undefined.
+ * @param descriptor Format, size, and levels.
+ * @return Texture name, bound to GL_TEXTURE_2D on the active texture unit.
+ */
+GLuint RenderTargetPool::acquire( const Descriptor& descriptor )
+{
+	GLuint texture = 0;
+	for( auto& entry : targets )
+	{
+		if( !entry.second.inUse && entry.second.descriptor == descriptor )
+		{
+			texture = entry.first;
+			break;
+		}
+	}
+
+	if( texture == 0 )
+	{
+		const bool depth = isDepthFormat( descriptor.internalFormat );
+		glGenTextures( 1, &texture );
+		glBindTexture( GL_TEXTURE_2D, texture );
+		for( GLint level = 0; level < descriptor.levels; level++ )
+			glTexImage2D( GL_TEXTURE_2D, level, descriptor.internalFormat, max( descriptor.width >> level, 1 ),
+						  max( descriptor.height >> level, 1 ), 0, depth? GL_DEPTH_COMPONENT : GL_RGBA, GL_FLOAT, nullptr );
+
+		// Size of what the driver actually allocated (unsized formats are up to it).
+		GLint bits = 0;
+		for( GLenum component : { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE } )
+		{
+			GLint size = 0;
+			glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, component, &size );
+			bits += size;
+		}
+		size_t texels = 0;
+		for( GLint level = 0; level < descriptor.levels; level++ )
+			texels += static_cast<size_t>( max( descriptor.width >> level, 1 ) ) * max( descriptor.height >> level, 1 );
+
+		targets[texture] = { descriptor, 0, texels * ( ( bits + 7 ) / 8 ), false, frame };
+		peakBytes = max( peakBytes, getAllocatedBytes() );
+	}
+	else
+		glBindTexture( GL_TEXTURE_2D, texture );
+
+	const float transparent[] = { 0, 0, 0, 0 };
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, transparent );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0 );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, descriptor.levels - 1 );
+
+	Target& target = targets[texture];
+	target.inUse = true;
+	target.lastUsedFrame = frame;
+	return texture;
+}
+
+/**
+ * Give a target back to the pool.  Its contents may be overwritten by the next pass that acquires it.
+ * @param texture Texture name returned by acquire() (0 is ignored).
+ */
+void RenderTargetPool::release( GLuint texture )
+{
+	auto entry = targets.find( texture );
+	if( entry == targets.end() )
+		return;
+
+	entry->second.inUse = false;
+	entry->second.lastUsedFrame = frame;
+}
+
+/**
+ * Give a target back to the pool, and reset the handle that kept it.
+ * @param texture Handle holding a texture name returned by acquire() (or 0).
+ */
+void RenderTargetPool::release( GLuint* texture )
+{
+	release( *texture );
+	*texture = 0;
+}
+
+/**
+ * Framebuffer that renders into the base level of a target (as its color attachment 0, or as its depth attachment).
+ * @param texture Texture name returned by acquire().
+ * @return Framebuffer name, or 0 if the texture doesn't belong to the pool.
+ */
+GLuint RenderTargetPool::getFramebuffer( GLuint texture )
+{
+	auto entry = targets.find( texture );
+	if( entry == targets.end() )
+		return 0;
+
+	Target& target = entry->second;
+	if( target.framebuffer == 0 )
+	{
+		glGenFramebuffers( 1, &target.framebuffer );
+		glBindFramebuffer( GL_FRAMEBUFFER, target.framebuffer );
+		const bool depth = isDepthFormat( target.descriptor.internalFormat );
+		glFramebufferTexture2D( GL_FRAMEBUFFER, depth? GL_DEPTH_ATTACHMENT : GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0 );
+		if( depth )
+			glDrawBuffer( GL_NONE );
+		if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+			cerr << "[RenderTargetPool] Framebuffer not complete!" << endl;
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	}
+	return target.framebuffer;
+}
+
+/**
+ * Advance the frame count, and delete the targets that weren't acquired for a few frames (e.g. sizes from before a
+ * resize, or the targets of a disabled technique).
+ */
+void RenderTargetPool::endFrame()
+{
+	frame++;
+	for( auto entry = targets.begin(); entry != targets.end(); )
+	{
+		if( !entry->second.inUse && frame - entry->second.lastUsedFrame > RETAIN_FRAMES )
+		{
+			glDeleteTextures( 1, &entry->first );
+			glDeleteFramebuffers( 1, &entry->second.framebuffer );
+			entry = targets.erase( entry );
+		}
+		else
+			entry++;
+	}
+}
+
+/**
+ * @return Bytes held by the pool's textures, in use or not.
+ */
+size_t RenderTargetPool::getAllocatedBytes() const
+{
+	size_t bytes = 0;
+	for( const auto& entry : targets )
+		bytes += entry.second.bytes;
+	return bytes;
+}
+
+/**
+ * @return Largest number of bytes the pool has held at once.
+ */
+size_t RenderTargetPool::getPeakBytes() const
+{
+	return peakBytes;
+}
+
+/**
+ * @return Number of textures held by the pool, in use or not.
+ */
+int RenderTargetPool::getTargetCount() const
+{
+	return static_cast<int>( targets.size() );
+}
+
+/**
+ * Print the memory held by the pool.
+ * @param os Output stream.
+ */
+void RenderTargetPool::report( ostream& os ) const
+{
+	int inUse = 0;
+	for( const auto& entry : targets )
+		inUse += entry.second.inUse;
+	os << "[RenderTargetPool] " << targets.size() << " targets (" << inUse << " in use): " << fixed << setprecision( 1 )
+	   << getAllocatedBytes() / ( 1024.0 * 1024.0 ) << " MiB, peak " << peakBytes / ( 1024.0 * 1024.0 ) << " MiB"
+	   << defaultfloat << endl;
+}
+
+/**
+ * Delete every target, in use or not.
+ */
+void RenderTargetPool::destroy()
+{
+	for( auto& entry : targets )
+	{
+		glDeleteTextures( 1, &entry.first );
+		glDeleteFramebuffers( 1, &entry.second.framebuffer );
+	}
+	targets.clear();
+}
@@ -0,0 +1,65 @@
+#ifndef RenderTargetPool_h
+#define RenderTargetPool_h
+
+#include <map>
+#include <ostream>
+#include "OpenGLHeaders.h"
+
+using namespace std;
+
+/**
+ * Pool of 2D render target textures, allocated by descriptor (internal format, size, and mip levels).  acquire() hands
+ * out a free texture with a matching descriptor, or allocates one, and release() gives it back, so that passes whose
+ * targets are alive at different times share the same memory, and targets follow a resize (or a change of downsampling
+ * factor) lazily: descriptors that nobody acquires anymore are deleted by endFrame() a few frames later.
+ * Sampling parameters are reset on every acquisition (nearest filtering, repeat wrapping, no border), so callers set
+ * what they need afterwards, as they would with a new texture.
+ */
+class RenderTargetPool
+{
+public:
+	struct Descriptor
+	{
+		GLint internalFormat;
+		GLsizei width;
+		GLsizei height;
+		GLint levels;							// Mip levels, from the base level down (each halving the size).
+
+		Descriptor( GLint internalFormat = GL_RGBA8, GLsizei width = 0, GLsizei height = 0, GLint levels = 1 );
+		bool operator<( const Descriptor& other ) const;
+		bool operator==( const Descriptor& other ) const;
+	};
+
+private:
+	static const unsigned long RETAIN_FRAMES = 2;	// Frames a released target stays allocated without being acquired.
+
+	struct Target
+	{
+		Descriptor descriptor;
+		GLuint framebuffer;						// Created on request, with the base level as its only attachment.
+		size_t bytes;
+		bool inUse;
+		unsigned long lastUsedFrame;
+	};
+
+	map<GLuint, Target> targets;				// By texture name.
+	unsigned long frame;
+	size_t peakBytes;
+
+	static bool isDepthFormat( GLint internalFormat );
+
+public:
+	RenderTargetPool();
+	GLuint acquire( const Descriptor& descriptor );
+	void release( GLuint texture );
+	void release( GLuint* texture );
+	GLuint getFramebuffer( GLuint texture );
+	void endFrame();
+	size_t getAllocatedBytes() const;
+	size_t getPeakBytes() const;
+	int getTargetCount() const;
+	void report( ostream& os ) const;
+	void destroy();
+};
+
+#endif /* RenderTargetPool_h */
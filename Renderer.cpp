@@ -0,0 +1,1954 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include "Renderer.h"
+#include "SampleSet.h"
+#include "Sampling.h"
+#include "Transformations.h"
+
+const vec3 Renderer::POINT_OF_INTEREST = { 0, 3, 0 };
+const vec3 Renderer::DEFAULT_EYE = { 5, 5, 5 };
+const char* const Renderer::PASS_NAMES[PASS_COUNT] = { "rsm", "rsmDepthPyramid", "shadowMoments", "rsmMips",
+														"gbuffer", "linearDepth", "ssao", "ssaoBlur", "ssaoUpsample",
+														"indirect", "indirectBlur", "upsample", "temporal",
+														"lighting", "upscale" };
+const char* const Renderer::RSM_FORMAT_NAMES[RSM_FORMAT_COUNT] = { "float32", "rgb10a2", "r11g11b10f" };
+const char* const Renderer::RSM_GATHER_NAMES[GATHER_COUNT] = { "disk", "hierarchical", "vpl" };
+const char* const Renderer::SHADOW_MODE_NAMES[SHADOW_MODE_COUNT] = { "pcss", "vsm" };
+const char* const Renderer::AO_METHOD_NAMES[AO_METHOD_COUNT] = { "ssao", "gtao" };
+const char* const Renderer::SSAO_BLUR_NAMES[SSAO_BLUR_COUNT] = { "box", "bilateral" };
+
+/**
+ * Compile shaders, create the scene lights, and allocate every render target.
+ * @param openGL OpenGL helper object (already initialized).
+ * @param w Output width in pixels (i.e. framebuffer width).
+ * @param h Output height in pixels.
+ * @param lights Receives lightCount lights: the key light first; their reflective shadow map atlas is created here.
+ * @param seed Seed for the SSAO kernel and noise; a negative value uses Sampling::SEED, like the RSM samples.
+ */
+void Renderer::init( OpenGL* openGL, int w, int h, vector<Light>& lights, int seed )
+{
+	ogl = openGL;
+	width = renderWidth = w;
+	height = renderHeight = h;
+	lightCount = min( max( lightCount, 1 ), MAX_LIGHTS );
+	fitSampleCounts();
+
+	// Shaders are specialized for the sample set sizes and the number of lights, so that their loops have constant bounds.
+	const string lightDefines = "#define LIGHT_COUNT " + to_string( lightCount ) + "\n";
+	const string rsmDefines = "#define N_SAMPLES " + to_string( rsmSampleCount ) + "\n" + lightDefines;
+
+	// Compile shaders for geom/sequence drawing program.
+	cout << "Compiling rendering shaders... ";
+	Shaders shaders;
+	renderingProgram = shaders.compile( conf::SHADERS_FOLDER + "render.vert", conf::SHADERS_FOLDER + "render.frag",
+										rsmDefines + "#define PCSS_SAMPLES " + to_string( pcssSampleCount ) + "\n" );
+	cout << "Done!" << endl;
+
+	// Compile shaders program for reflective shadow maps: a geometry shader draws every triangle once per light.
+	cout << "Compiling reflective shadow maps generator shaders... ";
+	generateRSMProgram = shaders.compile( conf::SHADERS_FOLDER + "generateRSM.vert", conf::SHADERS_FOLDER + "generateRSM.geom",
+										  conf::SHADERS_FOLDER + "generateRSM.frag", lightDefines );
+	cout << "Done!" << endl;
+
+	// Compile shaders program for G-buffer.
+	cout << "Compiling G-Buffer generator shaders... ";
+	generateGBufferProgram = shaders.compile( conf::SHADERS_FOLDER + "generateGBuffer.vert", conf::SHADERS_FOLDER + "generateGBuffer.frag" );
+	cout << "Done!" << endl;
+
+	// Compile shaders program to generate the SSAO texture, and the linear depth it reads.
+	cout << "Compiling SSAO generator shaders... ";
+	generateLinearDepthProgram = shaders.compile( conf::SHADERS_FOLDER + "generateSSAO.vert", conf::SHADERS_FOLDER + "generateLinearDepth.frag" );
+	generateSSAOProgram = shaders.compile( conf::SHADERS_FOLDER + "generateSSAO.vert", conf::SHADERS_FOLDER + "generateSSAO.frag",
+										   "#define KERNEL_SIZE " + to_string( ssaoKernelSize ) + "\n" );
+	generateGTAOProgram = shaders.compile( conf::SHADERS_FOLDER + "generateSSAO.vert", conf::SHADERS_FOLDER + "generateGTAO.frag" );
+	cout << "Done!" << endl;
+
+	// Compile shaders program to blur the SSAO texture. Notice we use the same vertex shader than in the generator case.
+	cout << "Compiling SSAO blur shaders... ";
+	blurSSAOProgram = shaders.compile( conf::SHADERS_FOLDER + "generateSSAO.vert", conf::SHADERS_FOLDER + "blurSSAO.frag" );
+	compileSSAOBilateralBlur( ( ssaoBlurRadius + 1 ) / 2 );
+	cout << "Done!" << endl;
+
+	// Compile shaders programs to generate SSAO at a lower resolution and reconstruct it.
+	cout << "Compiling low resolution SSAO shaders... ";
+	downsampleSSAOProgram = shaders.compile( conf::SHADERS_FOLDER + "generateSSAO.vert", conf::SHADERS_FOLDER + "downsampleSSAO.frag" );
+	upsampleSSAOProgram = shaders.compile( conf::SHADERS_FOLDER + "generateSSAO.vert", conf::SHADERS_FOLDER + "upsampleSSAO.frag" );
+	cout << "Done!" << endl;
+
+	// Compile shaders programs to compute indirect lighting at a low resolution or interleaved, and reconstruct it.
+	cout << "Compiling low resolution indirect lighting shaders... ";
+	indirectLightingProgram = shaders.compile( conf::SHADERS_FOLDER + "render.vert", conf::SHADERS_FOLDER + "indirectLighting.frag", rsmDefines );
+	blurIndirectProgram = shaders.compile( conf::SHADERS_FOLDER + "render.vert", conf::SHADERS_FOLDER + "blurIndirect.frag" );
+	upsampleIndirectProgram = shaders.compile( conf::SHADERS_FOLDER + "render.vert", conf::SHADERS_FOLDER + "upsampleIndirect.frag", rsmDefines );
+	cout << "Done!" << endl;
+
+	// Compile shaders program to accumulate SSAO and indirect lighting over frames.
+	cout << "Compiling temporal accumulation shaders... ";
+	temporalProgram = shaders.compile( conf::SHADERS_FOLDER + "render.vert", conf::SHADERS_FOLDER + "temporalAccumulation.frag" );
+	cout << "Done!" << endl;
+
+	// Compile shaders program to build the hierarchical reflective shadow map.
+	cout << "Compiling hierarchical reflective shadow map shaders... ";
+	generateRSMMipsProgram = shaders.compile( conf::SHADERS_FOLDER + "render.vert", conf::SHADERS_FOLDER + "generateRSMMips.frag",
+										   rsmDefines );
+	cout << "Done!" << endl;
+
+	// Compile shaders program to build the min/max depth pyramid for the soft shadows blocker search.
+	cout << "Compiling RSM depth pyramid shaders... ";
+	generateDepthPyramidProgram = shaders.compile( conf::SHADERS_FOLDER + "render.vert", conf::SHADERS_FOLDER + "generateDepthPyramid.frag" );
+	cout << "Done!" << endl;
+
+	// Compile shaders program to blur the variance shadow map moments.
+	cout << "Compiling variance shadow map blur shaders... ";
+	blurShadowMomentsProgram = shaders.compile( conf::SHADERS_FOLDER + "render.vert", conf::SHADERS_FOLDER + "blurShadowMoments.frag",
+											  lightDefines );
+	cout << "Done!" << endl;
+
+	// Compile shaders program to upscale the lit scene under dynamic resolution.
+	cout << "Compiling upscaling shaders... ";
+	upscaleProgram = shaders.compile( conf::SHADERS_FOLDER + "render.vert", conf::SHADERS_FOLDER + "upscale.frag" );
+	cout << "Done!" << endl;
+
+	//////////////////////////////////////////////// Create lights /////////////////////////////////////////////////////
+
+	float lNearPlane = 0.01f, lFarPlane = 50.0f;								// Setting up the light projection matrix.
+	float lSide = 20.0f;
+	mat44 LightProjection = Tx::ortographic( -lSide, lSide, -lSide, lSide, lNearPlane, lFarPlane );
+
+	// The key light, and dimmer, tinted lights spread evenly over the quarter turn towards the open side of the room.
+	const double lRadius = 4.0;
+	const float lHeight = 5.0;
+	const float lRGB[MAX_LIGHTS][3] = { { 0.85, 0.85, 0.85 }, { 0.6, 0.45, 0.3 }, { 0.3, 0.45, 0.6 }, { 0.45, 0.6, 0.3 } };
+	lights.clear();
+	lightImportances.clear();
+	for( int l = 0; l < lightCount; l++ )
+	{
+		const double phi = ( lightCount > 1 )? 0.5 * M_PI * l / ( lightCount - 1 ) : 0.0;
+		lights.push_back( Light( { lRadius * sin( phi ), lHeight, lRadius * cos( phi ) }, { lRGB[l][0], lRGB[l][1], lRGB[l][2] }, LightProjection ) );
+		lightImportances.push_back( 0.2126 * lRGB[l][0] + 0.7152 * lRGB[l][1] + 0.0722 * lRGB[l][2] );	// Luminance.
+	}
+
+	/////////////////////////////////////// Setting up reflective shadow map ///////////////////////////////////////////
+
+	allocateRSM();
+
+	//////////////////////////////////// Loading Poisson disk samples in a unit disk ///////////////////////////////////
+
+	const vector<float> rsmSamples = SampleSet::get( SampleSet::DISK, rsmSampleCount, Sampling::SEED );
+
+	// Send samples to the rendering and indirect lighting shaders, which read the RSM from the same texture units.
+	for( GLuint program : { renderingProgram, indirectLightingProgram, upsampleIndirectProgram, generateRSMMipsProgram } )
+	{
+		glUseProgram( program );
+		glUniform2fv( glGetUniformLocation( program, "RSMSamplePositions" ), rsmSampleCount, rsmSamples.data() );
+		glUniform1i( glGetUniformLocation( program, "sRSMPosition" ), 0 );			// Reflective shadow map samplers begin at texture unit 0.
+		glUniform1i( glGetUniformLocation( program, "sRSMNormal" ), 1 );
+		glUniform1i( glGetUniformLocation( program, "sRSMFlux" ), 2 );
+		glUniform1i( glGetUniformLocation( program, "sRSMDepth" ), 3 );
+		glUniform1i( glGetUniformLocation( program, "sRSMMipFlux" ), 7 );			// Hierarchical RSM, around the G-buffer units.
+		glUniform1i( glGetUniformLocation( program, "sRSMMipPosition" ), 8 );
+		glUniform1i( glGetUniformLocation( program, "sRSMMipNormal" ), 11 );
+		GLuint vplBlock = glGetUniformBlockIndex( program, "VPLClusters" );
+		if( vplBlock != GL_INVALID_INDEX )
+			glUniformBlockBinding( program, vplBlock, VPLExtractor::BINDING );
+	}
+	vplExtractor.init();
+
+	////////////////////////////////////// Setting up the screen-sized render targets ///////////////////////////////////
+
+	// Screen-sized targets come from the render target pool, at the output resolution (see allocateScreenTargets()); only
+	// framebuffers with several attachments, or whose attachment changes from pass to pass, are kept here.
+	glGenFramebuffers( 1, &gBuffer );
+	glGenFramebuffers( 1, &linearDepthFBO );
+	glGenFramebuffers( 2, temporalFBOs );
+	allocateScreenTargets();
+
+	// Set uniform samplers in deferred rendering program.
+	glUseProgram( renderingProgram );
+	glUniform1i( glGetUniformLocation( renderingProgram, "sGNormal" ), 4 );							// G-Buffer samplers begin at texture unit 4.
+	glUniform1i( glGetUniformLocation( renderingProgram, "sGAlbedoSpecular" ), 5 );
+	glUniform1i( glGetUniformLocation( renderingProgram, "sGDepth" ), 6 );
+	glUniform1i( glGetUniformLocation( renderingProgram, "sSSAOFactor"), 9 );							// SSAO factor.
+	glUniform1i( glGetUniformLocation( renderingProgram, "sIndirect"), 10 );							// Upsampled indirect lighting.
+	glUniform1i( glGetUniformLocation( renderingProgram, "sRSMDepthPyramid"), 12 );					// Min/max RSM depth pyramid.
+	glUniform1i( glGetUniformLocation( renderingProgram, "sShadowMoments"), 13 );						// Variance shadow map moments.
+
+	// Poisson disk for the PCSS blocker search and filtering.
+	const vector<float> pcssSamples = SampleSet::get( SampleSet::DISK, pcssSampleCount, Sampling::SEED );
+	glUniform2fv( glGetUniformLocation( renderingProgram, "PCSSSamplePositions" ), pcssSampleCount, pcssSamples.data() );
+
+	/////////////////////////////////////// Setting up the linear depth program ///////////////////////////////////////
+
+	glUseProgram( generateLinearDepthProgram );
+	glUniform1i( glGetUniformLocation( generateLinearDepthProgram, "sSource" ), 0 );
+
+	///////////////////////////// Setting up the SSAO generator buffer object textures /////////////////////////////////
+
+	// Kernel of cosine-weighted directions in the normal hemisphere of a fragment, scaled so that samples concentrate
+	// towards its center.  Lengths follow the golden ratio sequence, so that every range of samples covers the radius.
+	const unsigned samplingSeed = ( seed < 0 )? Sampling::SEED : static_cast<unsigned>( seed );
+	vector<float> ssaoKernel = SampleSet::get( SampleSet::HEMISPHERE, ssaoKernelSize, samplingSeed );
+	for( int i = 0; i < ssaoKernelSize; i++ )
+	{
+		const double golden = 0.5 + i * 0.6180339887498949;
+		const double length = 1.0 - ( golden - floor( golden ) );						// In (0, 1].
+		double scale = i / static_cast<double>( ssaoKernelSize );
+		scale = 0.1 + scale * scale * ( 1.0 - 0.1 );
+		for( int j = 0; j < 3; j++ )
+			ssaoKernel[3 * i + j] = static_cast<float>( ssaoKernel[3 * i + j] * length * scale );
+	}
+
+	// Generate the MxM noise texture from where we'll draw rotation vectors in generateSSAO.frag shader: evenly spaced
+	// angles, ranked by a blue-noise texture, so that neighboring pixels get very different rotations.
+	const int SSAO_NOISE_SIZE = 4;
+	const vector<float> noiseRanks = Sampling::blueNoise( SSAO_NOISE_SIZE, samplingSeed );
+	vector<float> ssaoNoise;
+	for( float rank : noiseRanks )
+	{
+		const double angle = 2.0 * M_PI * rank;					// Unit vector on the x-y plane.
+		ssaoNoise.push_back( static_cast<float>( cos( angle ) ) );
+		ssaoNoise.push_back( static_cast<float>( sin( angle ) ) );
+		ssaoNoise.push_back( 0 );
+	}
+
+	glGenTextures( 1, &ssaoNoiseTexture );
+	glBindTexture( GL_TEXTURE_2D, ssaoNoiseTexture );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F, SSAO_NOISE_SIZE, SSAO_NOISE_SIZE, 0, GL_RGB, GL_FLOAT, ssaoNoise.data() );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );					// Set it to repeat pattern in rendered quad.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+
+	// Set uniforms in SSAO generation program.
+	glUseProgram( generateSSAOProgram );
+	glUniform1i( glGetUniformLocation( generateSSAOProgram, "sLinearDepth" ), 0 );	// Texture units begin at 0 in this case.
+	glUniform1i( glGetUniformLocation( generateSSAOProgram, "sGNormal" ), 1 );
+	glUniform1i( glGetUniformLocation( generateSSAOProgram, "sSSAONoiseTexture" ), 2 );
+	glUniform3fv( glGetUniformLocation( generateSSAOProgram, "ssaoSamples" ), ssaoKernelSize, ssaoKernel.data() );	// Kernel precomputed samples.
+	glUniform1i( glGetUniformLocation( generateSSAOProgram, "firstSample" ), 0 );		// All samples, unless accumulating over frames.
+	glUniform1i( glGetUniformLocation( generateSSAOProgram, "sampleStride" ), 1 );
+	glUseProgram( generateGTAOProgram );											// Same inputs, but no kernel.
+	glUniform1i( glGetUniformLocation( generateGTAOProgram, "sLinearDepth" ), 0 );
+	glUniform1i( glGetUniformLocation( generateGTAOProgram, "sGNormal" ), 1 );
+	glUniform1i( glGetUniformLocation( generateGTAOProgram, "sSSAONoiseTexture" ), 2 );
+	// Remains to send view and projection matrices, and the SSAO resolution, in render().
+
+	////////////////////////////////////////// Setting up the SSAO blur programs ///////////////////////////////////////
+
+	// Set uniforms in SSAO blur program.
+	glUseProgram( blurSSAOProgram );
+	glUniform1i( glGetUniformLocation( blurSSAOProgram, "sSSAOFactor" ), 0 );		// Sampler for SSAO factor texture.
+
+	// Render targets are point-sampled everywhere else, so the bilateral blur overrides their filtering with a sampler.
+	glGenSamplers( 1, &linearSampler );
+	glSamplerParameteri( linearSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glSamplerParameteri( linearSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glSamplerParameteri( linearSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glSamplerParameteri( linearSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+	// Set uniforms in low resolution SSAO programs.
+	glUseProgram( downsampleSSAOProgram );
+	glUniform1i( glGetUniformLocation( downsampleSSAOProgram, "sLinearDepth" ), 0 );	// Same units as SSAO generation.
+	glUniform1i( glGetUniformLocation( downsampleSSAOProgram, "sGNormal" ), 1 );
+	glUseProgram( upsampleSSAOProgram );
+	glUniform1i( glGetUniformLocation( upsampleSSAOProgram, "sSSAOLowRes" ), 0 );	// Blurred low resolution SSAO.
+	glUniform1i( glGetUniformLocation( upsampleSSAOProgram, "sSSAODepthLowRes" ), 1 );	// Where it was sampled.
+	glUniform1i( glGetUniformLocation( upsampleSSAOProgram, "sSSAONormalLowRes" ), 2 );
+	glUniform1i( glGetUniformLocation( upsampleSSAOProgram, "sLinearDepth" ), 3 );	// Full resolution geometry.
+	glUniform1i( glGetUniformLocation( upsampleSSAOProgram, "sGNormal" ), 4 );
+
+	/////////////////////////////// Setting up the low resolution indirect lighting programs ///////////////////////////
+
+	// These programs read the RSM and the G-buffer from the same texture units as the deferred rendering program.
+	for( GLuint program : { indirectLightingProgram, blurIndirectProgram, upsampleIndirectProgram } )
+	{
+		glUseProgram( program );
+		glUniform1i( glGetUniformLocation( program, "sGNormal" ), 4 );
+		glUniform1i( glGetUniformLocation( program, "sGAlbedoSpecular" ), 5 );
+		glUniform1i( glGetUniformLocation( program, "sGDepth" ), 6 );
+		glUniform1i( glGetUniformLocation( program, "sLinearDepth" ), 14 );
+	}
+	glUniform1i( glGetUniformLocation( upsampleIndirectProgram, "sIndirectLowRes" ), 10 );
+	glUseProgram( blurIndirectProgram );
+	glUniform1i( glGetUniformLocation( blurIndirectProgram, "sIndirectLowRes" ), 10 );
+
+	//////////////////////////////// Setting up the temporal accumulation and upscaling programs ////////////////////////
+
+	glUseProgram( temporalProgram );
+	glUniform1i( glGetUniformLocation( temporalProgram, "sSSAOFactor" ), 0 );			// Current frame.
+	glUniform1i( glGetUniformLocation( temporalProgram, "sIndirect" ), 1 );
+	glUniform1i( glGetUniformLocation( temporalProgram, "sSSAOHistory" ), 2 );			// Previous frame.
+	glUniform1i( glGetUniformLocation( temporalProgram, "sIndirectHistory" ), 3 );
+	glUniform1i( glGetUniformLocation( temporalProgram, "sGeometryHistory" ), 4 );
+	glUniform1i( glGetUniformLocation( temporalProgram, "sGNormal" ), 5 );			// G-buffer.
+	glUniform1i( glGetUniformLocation( temporalProgram, "sGDepth" ), 6 );
+
+	glUseProgram( upscaleProgram );
+	glUniform1i( glGetUniformLocation( upscaleProgram, "sScene" ), 0 );
+
+	////////////////////////////////////////////////// Scene objects ///////////////////////////////////////////////////
+
+	ogl->setUsingUniformScaling( false );
+	// The decimated statue isn't in the repository: fresh checkouts (and the regression test) load the full one.
+	const bool decimated = ifstream( conf::OBJECTS_FOLDER + "mercury10.obj" ).good();
+	ogl->create3DObject( "mercury", decimated? "mercury10.obj" : "mercury.obj" );
+
+	for( GPUTimer& timer : passTimers )
+		timer.init();
+}
+
+/**
+ * Render the scene.
+ * @param Projection The 4x4 projection matrix to use.
+ * @param View The 4x4 view matrix.
+ * @param Model Any previously built 4x4 model matrix (usually containing current zoom and scene rotation as provided by arcball).
+ */
+void Renderer::renderScene( const mat44& Projection, const mat44& View, const mat44& Model )
+{
+	// Statue.
+	ogl->setColor( 0.65, 0.65, 0.65, 1.0, -1.0f );
+	ogl->render3DObject( Projection, View, Model * Tx::translate( -0.5, 0.0, -2.0 ) * Tx::rotate( 5.0 * M_PI / 4.0, Tx::Y_AXIS ) * Tx::scale( 1.35 ), "mercury" );
+
+	// Left wall.
+	ogl->setColor( 0.8941, 0.0, 0.4862, 1.0, -1.0f );
+	ogl->drawCube( Projection, View, Model * Tx::rotate( -M_PI / 4.0, Tx::Y_AXIS ) * Tx::translate( -3.0, 3.0, 0.0 ) * Tx::scale( 0.05, 12.0, 12.0 ) );
+
+	// Right wall.
+	ogl->setColor( 0.06274, 0.5843, 0.8941, 1.0, -1.0f );
+	ogl->drawCube( Projection, View, Model * Tx::rotate( M_PI / 4.0, Tx::Y_AXIS ) * Tx::translate( 3.0, 3.0, 0.0 ) * Tx::scale( 0.05, 12.0, 12.0 ) );
+
+	// Bottom wall.
+	ogl->setColor( 1.0, 1.0, 0.0, 1.0, -1.0f );
+	ogl->drawCube( Projection, View, Model * Tx::translate( 0.0, -0.025, 0.0 ) * Tx::rotate( M_PI / 4.0, Tx::Y_AXIS ) * Tx::scale( 12.0, 0.05, 12.0 ) );
+}
+
+/**
+ * Render a frame through all the pipeline passes.  The passes are declared in a frame graph with the targets they read
+ * and write, and then run: passes that don't contribute to the output are culled (e.g. SSAO when it's disabled), and
+ * intermediate results only hold a pooled texture while they're alive.
+ * @param Projection The 4x4 camera projection matrix.
+ * @param View The 4x4 camera view matrix.
+ * @param eye Camera position in world space.
+ * @param Model Model matrix applied to the whole scene (zoom and arcball rotation).
+ * @param lights Lights created by init(); their view and light space matrices are updated here.
+ * @param targetFBO Framebuffer receiving the lit scene (0 for the default framebuffer).
+ */
+void Renderer::render( const mat44& Projection, const mat44& View, const vec3& eye, const mat44& Model, vector<Light>& lights, GLuint targetFBO )
+{
+	typedef FrameGraph::Input Input;
+	typedef FrameGraph::Resource Resource;
+	typedef RenderTargetPool::Descriptor Descriptor;
+
+	glEnable( GL_DEPTH_TEST );
+	glDepthFunc( GL_LEQUAL );
+	glFrontFace( GL_CCW );
+	glEnable( GL_CULL_FACE );
+
+	for( Light& light : lights )
+		light.lookAt( POINT_OF_INTEREST );
+	updateRenderScale();										// Reads the pass times collected by the last frame.
+	if( renderTargetsStale )
+		clearRenderTargets();
+
+	////////////////////////////////////////////////// Frame resources /////////////////////////////////////////////////
+
+	frameGraph.reset();
+	const Resource output = frameGraph.import( "output", 0 );	// The target framebuffer: everything else is kept for it.
+	frameGraph.retain( output );
+	const Resource rsm[] = { frameGraph.import( "rsmPosition", rsmPosition ), frameGraph.import( "rsmNormal", rsmNormal ),
+							 frameGraph.import( "rsmFlux", rsmFlux ), frameGraph.import( "rsmDepth", rsmDepth ) };
+	const Resource gBufferTargets[] = { frameGraph.import( "gNormal", gNormal ), frameGraph.import( "gAlbedoSpecular", gAlbedoSpecular ),
+										frameGraph.import( "gDepth", gDepth ) };
+	const Resource linearDepth = frameGraph.import( "linearDepth", linearDepthBuffer );
+	const Resource ssaoBlurred = frameGraph.import( "ssaoBlurFactor", ssaoBlurFactor );
+	const bool useIndirectTexture = enableRSM && ( indirectDownsampling > 1 || indirectInterleave > 1 || enableTemporal );
+	const bool useRSMMips = enableRSM && rsmGather != GATHER_DISK;
+	const bool useVPLs = enableRSM && rsmGather == GATHER_VPL;
+	const unsigned int frame = frameIndex;						// Rotates sample subsets.
+
+	////////////////////////////////// First pass: render scene to RSM textures ////////////////////////////////////
+
+	// Only the camera moved?  Then the RSM from the last frame still holds (scene edits must call invalidateRSM()).
+	bool rsmCurrent = enableRSMCache && rsmValid && rsmLights.size() == lights.size()
+					  && approx_equal( Model, rsmModel, "absdiff", 0.0 )
+					  && ( ( shadowMode == SHADOW_VSM )? shadowMomentsValid : rsmDepthPyramidValid );
+	for( size_t l = 0; rsmCurrent && l < lights.size(); l++ )
+		rsmCurrent = approx_equal( lights[l].SpaceMatrix, rsmLights[l].SpaceMatrix, "absdiff", 0.0 )
+					 && approx_equal( lights[l].position, rsmLights[l].position, "absdiff", 0.0 )
+					 && approx_equal( lights[l].color, rsmLights[l].color, "absdiff", 0.0 );
+	const bool writeMoments = ( shadowMode == SHADOW_VSM );		// Variance shadow map moments come from the same pass.
+	if( writeMoments && shadowMoments == 0 )
+		allocateShadowMoments();
+	const Resource depthPyramid = frameGraph.import( "rsmDepthPyramid", rsmDepthPyramid );
+	const Resource moments = frameGraph.import( "shadowMoments", shadowMoments );
+	if( rsmCurrent )
+		rsmReusedFrames++;
+	else
+	{
+		vector<Resource> rsmOutputs( rsm, rsm + 4 );
+		if( writeMoments )
+			rsmOutputs.push_back( moments );
+		frameGraph.addPass( RSM_PASS, PASS_NAMES[RSM_PASS], {}, rsmOutputs, [&]() {
+			ogl->useProgram( generateRSMProgram );				// Now, create the reflective shadow map textures.
+			glUniform1i( glGetUniformLocation( generateRSMProgram, "compactRSM" ), rsmFormat != RSM_FLOAT32 );
+			setLightUniforms( generateRSMProgram, lights );
+			for( int l = 0; l < lightCount; l++ )				// The geometry shader sends light l's triangles to viewport l.
+				glViewportIndexedf( l, rsmTiles[l].x, rsmTiles[l].y, rsmTiles[l].side, rsmTiles[l].side );
+			glBindFramebuffer( GL_FRAMEBUFFER, rsmFBO );
+			GLenum attachments[] = { ( rsmFormat != RSM_FLOAT32 )? GL_NONE : GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2,
+									 writeMoments? GL_COLOR_ATTACHMENT3 : GL_NONE };
+			glDrawBuffers( 4, attachments );
+			glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+			if( writeMoments )
+			{
+				const float farthest[] = { 1, 1, 1, 1 };		// Depth = 1 (and squared depth) where nothing was rendered.
+				glClearBufferfv( GL_COLOR, 3, farthest );
+			}
+
+			renderScene( lights[0].Projection, lights[0].View, Model );	// Every light at once.
+			glBindFramebuffer( GL_FRAMEBUFFER, 0 );				// Unbind: return control to normal draw framebuffer.
+		} );
+
+		// PCSS min/max depth pyramid: level 0 reads the RSM depth, and every other level the one before (as its only level).
+		if( !writeMoments )
+		{
+			frameGraph.addPass( RSM_DEPTH_PASS, PASS_NAMES[RSM_DEPTH_PASS], { Input( rsm[3] ) }, { depthPyramid }, [&]() {
+				ogl->useProgram( generateDepthPyramidProgram );
+				glBindFramebuffer( GL_FRAMEBUFFER, rsmDepthPyramidFBO );
+				glActiveTexture( GL_TEXTURE0 );
+				for( int level = 0; level < rsmDepthPyramidLevels; level++ )
+				{
+					const GLsizei side = max( rsmSideLength >> ( level + 1 ), 1 );
+					glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rsmDepthPyramid, level );
+					glViewport( 0, 0, side, side );
+					glUniform1i( glGetUniformLocation( generateDepthPyramidProgram, "fromDepth" ), level == 0 );
+					if( level == 0 )
+						glBindTexture( GL_TEXTURE_2D, rsmDepth );
+					else
+					{
+						glBindTexture( GL_TEXTURE_2D, rsmDepthPyramid );
+						glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1 );
+						glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1 );
+					}
+					ogl->renderNDCQuad();
+				}
+				glBindTexture( GL_TEXTURE_2D, rsmDepthPyramid );
+				glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0 );
+				glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, rsmDepthPyramidLevels - 1 );
+				glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+			} );
+		}
+		else
+		{
+			// Variance shadow map: blur the moments horizontally, then vertically back into the moments texture, and mipmap.
+			const Resource momentsBlur = frameGraph.create( "shadowMomentsBlur", Descriptor( GL_RG32F, rsmSideLength, rsmSideLength ), []() {
+				const float farthest[] = { 1, 1, 1, 1 };		// Beyond light space, everything is lit.
+				glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+				glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+				glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+				glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+				glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, farthest );
+			} );
+			frameGraph.addPass( SHADOW_MOMENTS_PASS, PASS_NAMES[SHADOW_MOMENTS_PASS], { Input( moments ) }, { moments, momentsBlur }, [&, momentsBlur]() {
+				ogl->useProgram( blurShadowMomentsProgram );
+				setLightUniforms( blurShadowMomentsProgram, lights );		// Taps stay within every light's tile.
+				glViewport( 0, 0, rsmSideLength, rsmSideLength );
+				glActiveTexture( GL_TEXTURE0 );
+
+				glBindFramebuffer( GL_FRAMEBUFFER, frameGraph.getFramebuffer( momentsBlur ) );
+				glBindTexture( GL_TEXTURE_2D, shadowMoments );
+				glUniform2f( glGetUniformLocation( blurShadowMomentsProgram, "direction" ), 1.0f / rsmSideLength, 0 );
+				ogl->renderNDCQuad();
+
+				glBindFramebuffer( GL_FRAMEBUFFER, shadowMomentsFBO );
+				glBindTexture( GL_TEXTURE_2D, frameGraph.getTexture( momentsBlur ) );
+				glUniform2f( glGetUniformLocation( blurShadowMomentsProgram, "direction" ), 0, 1.0f / rsmSideLength );
+				ogl->renderNDCQuad();
+				glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+				glBindTexture( GL_TEXTURE_2D, shadowMoments );
+				glGenerateMipmap( GL_TEXTURE_2D );
+			} );
+		}
+
+		rsmValid = true;
+		rsmMipsValid = false;
+		rsmDepthPyramidValid = !writeMoments;
+		shadowMomentsValid = writeMoments;
+		rsmLights = lights;
+		rsmModel = Model;
+		rsmRenderedFrames++;
+	}
+
+	// Hierarchical RSM: write the flux-weighted base level, one atlas tile at a time, and box-filter it down the mip chain.
+	if( useRSMMips && rsmMipFlux == 0 )
+		allocateRSMMips();
+	const Resource rsmMips[] = { frameGraph.import( "rsmMipFlux", rsmMipFlux ), frameGraph.import( "rsmMipPosition", rsmMipPosition ),
+								 frameGraph.import( "rsmMipNormal", rsmMipNormal ) };
+	const bool rebuildMips = useRSMMips && !rsmMipsValid;
+	if( rebuildMips )
+	{
+		frameGraph.addPass( RSM_MIPS_PASS, PASS_NAMES[RSM_MIPS_PASS], { Input( rsm[0], 0 ), Input( rsm[1], 1 ), Input( rsm[2], 2 ), Input( rsm[3], 3 ) },
+							{ rsmMips[0], rsmMips[1], rsmMips[2] }, [&]() {
+			const float zero[] = { 0, 0, 0, 0 };				// No flux where no tile is.
+			glBindFramebuffer( GL_FRAMEBUFFER, rsmMipFBO );
+			for( int i = 0; i < 3; i++ )
+				glClearBufferfv( GL_COLOR, i, zero );
+			ogl->useProgram( generateRSMMipsProgram );
+			setGBufferUniforms( generateRSMMipsProgram, Projection, View, lights );
+			for( int l = 0; l < lightCount; l++ )
+			{
+				glViewport( rsmTiles[l].x, rsmTiles[l].y, rsmTiles[l].side, rsmTiles[l].side );
+				glUniform1i( glGetUniformLocation( generateRSMMipsProgram, "light" ), l );
+				ogl->renderNDCQuad();
+			}
+			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+			for( GLuint texture : { rsmMipFlux, rsmMipPosition, rsmMipNormal } )
+			{
+				glBindTexture( GL_TEXTURE_2D, texture );
+				glGenerateMipmap( GL_TEXTURE_2D );
+			}
+		} );
+		rsmMipsValid = true;
+	}
+
+	// Virtual point lights: read a coarse level back, and cluster the VPLs sampled from an earlier readback.  A cached RSM
+	// issues no new readbacks, but those still in flight are collected.  The clusters live in a uniform buffer.
+	const Resource vplClusters = frameGraph.import( "vplClusters", 0 );
+	if( useVPLs )
+	{
+		frameGraph.addPass( FrameGraph::UNTIMED, "vpl", { Input( rsmMips[0] ), Input( rsmMips[1] ), Input( rsmMips[2] ) }, { vplClusters }, [&]() {
+			vector<VPLExtractor::Region> regions;
+			for( int l = 0; l < lightCount; l++ )
+			{
+				const mat44 InverseSpaceMatrix = inv( lights[l].SpaceMatrix );
+				const vec3 xAxis = { InverseSpaceMatrix( 0, 0 ), InverseSpaceMatrix( 1, 0 ), InverseSpaceMatrix( 2, 0 ) };
+				const double rsmWorldSize = 2.0 * norm( xAxis );	// World units across the light's RSM.
+				regions.push_back( { rsmTiles[l].x, rsmTiles[l].y, rsmTiles[l].side, static_cast<float>( rsmWorldSize / rsmTiles[l].side ) } );
+			}
+			vplExtractor.update( rsmMipFlux, rsmMipPosition, rsmMipNormal, rsmSideLength, regions, rebuildMips );
+		} );
+	}
+
+	// Passes that shade from the RSM and the G-buffer read them at fixed units: the RSM at units 0 to 3, the G-buffer at
+	// units 4 to 6, and the hierarchical RSM, depth pyramid, and variance shadow map at units 7, 8, and 11 to 13, where
+	// they're used.
+	vector<Input> rsmAndGBuffer = { Input( rsm[0], 0 ), Input( rsm[1], 1 ), Input( rsm[2], 2 ), Input( rsm[3], 3 ),
+									Input( gBufferTargets[0], 4 ), Input( gBufferTargets[1], 5 ), Input( gBufferTargets[2], 6 ),
+									Input( useRSMMips? rsmMips[0] : FrameGraph::NONE, 7 ), Input( useRSMMips? rsmMips[1] : FrameGraph::NONE, 8 ),
+									Input( useRSMMips? rsmMips[2] : FrameGraph::NONE, 11 ),
+									Input( writeMoments? FrameGraph::NONE : depthPyramid, 12 ), Input( writeMoments? moments : FrameGraph::NONE, 13 ) };
+	if( useVPLs )
+		rsmAndGBuffer.push_back( Input( vplClusters ) );
+
+	/////////////////////////////// Second pass: render scene to G-Buffer textures /////////////////////////////////
+
+	frameGraph.addPass( GBUFFER_PASS, PASS_NAMES[GBUFFER_PASS], {}, { gBufferTargets[0], gBufferTargets[1], gBufferTargets[2] }, [&]() {
+		glViewport( 0, 0, renderWidth, renderHeight );
+		glBindFramebuffer( GL_FRAMEBUFFER, gBuffer );
+		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+		ogl->useProgram( generateGBufferProgram );
+		ogl->setLighting( lights[0], View );					// Send light position and color.
+		renderScene( Projection, View, Model );
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );					// Unbind: return control to normal draw framebuffer.
+	} );
+
+	/////////// Linear depth (mip chain): level 0 reads the G-buffer depth, and every other level the one before ///////////
+
+	frameGraph.addPass( LINEAR_DEPTH_PASS, PASS_NAMES[LINEAR_DEPTH_PASS], { Input( gBufferTargets[2] ) }, { linearDepth }, [&]() {
+		ogl->useProgram( generateLinearDepthProgram );
+		glUniform2f( glGetUniformLocation( generateLinearDepthProgram, "depthUnprojection" ),
+					 static_cast<float>( Projection( 2, 2 ) ), static_cast<float>( Projection( 2, 3 ) ) );
+		glBindFramebuffer( GL_FRAMEBUFFER, linearDepthFBO );
+		glActiveTexture( GL_TEXTURE0 );
+		const int levels = enableDepthMips? linearDepthLevels : 1;
+		for( int level = 0; level < levels; level++ )
+		{
+			glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, linearDepthBuffer, level );
+			glViewport( 0, 0, max( renderWidth >> level, 1 ), max( renderHeight >> level, 1 ) );
+			glUniform1i( glGetUniformLocation( generateLinearDepthProgram, "fromDepth" ), level == 0 );
+			if( level == 0 )
+				glBindTexture( GL_TEXTURE_2D, gDepth );
+			else
+			{
+				glBindTexture( GL_TEXTURE_2D, linearDepthBuffer );
+				glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1 );
+				glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1 );
+			}
+			ogl->renderNDCQuad();
+		}
+		glBindTexture( GL_TEXTURE_2D, linearDepthBuffer );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0 );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, linearDepthLevels - 1 );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, enableDepthMips? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST );	// Level 0 only, otherwise.
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	} );
+
+	/////////////////////////////// Third pass: generate the SSAO occlusion factor /////////////////////////////////
+
+	const int ssaoWidth = ( renderWidth + ssaoDownsampling - 1 ) / ssaoDownsampling;
+	const int ssaoHeight = ( renderHeight + ssaoDownsampling - 1 ) / ssaoDownsampling;
+	const int ssaoAllocatedWidth = ( width + ssaoDownsampling - 1 ) / ssaoDownsampling;
+	const int ssaoAllocatedHeight = ( height + ssaoDownsampling - 1 ) / ssaoDownsampling;
+	const bool ssaoLowRes = ( ssaoDownsampling > 1 );			// Kernel samples read a point-sampled copy of the geometry.
+	const Resource ssaoDepth = ssaoLowRes? frameGraph.import( "ssaoDepthLowRes", ssaoDepthLowRes ) : linearDepth;
+	const Resource ssaoNormal = ssaoLowRes? frameGraph.import( "ssaoNormalLowRes", ssaoNormalLowRes ) : gBufferTargets[0];
+	const Resource ssaoRaw = frameGraph.create( "ssaoFactor", Descriptor( GL_RED, ssaoAllocatedWidth, ssaoAllocatedHeight ) );	// Notice: only one channel.
+	vector<Resource> ssaoOutputs = { ssaoRaw };
+	if( ssaoLowRes )
+		ssaoOutputs.insert( ssaoOutputs.end(), { ssaoDepth, ssaoNormal } );
+	frameGraph.addPass( SSAO_PASS, PASS_NAMES[SSAO_PASS], { Input( linearDepth ), Input( gBufferTargets[0] ) }, ssaoOutputs, [&]() {
+		glViewport( 0, 0, ssaoWidth, ssaoHeight );
+		if( ssaoLowRes )
+		{
+			glActiveTexture( GL_TEXTURE0 );
+			glBindTexture( GL_TEXTURE_2D, linearDepthBuffer );
+			glActiveTexture( GL_TEXTURE1 );
+			glBindTexture( GL_TEXTURE_2D, gNormal );
+			glBindFramebuffer( GL_FRAMEBUFFER, ssaoInputFBO );
+			ogl->useProgram( downsampleSSAOProgram );
+			glUniform1i( glGetUniformLocation( downsampleSSAOProgram, "downsampling" ), ssaoDownsampling );
+			ogl->renderNDCQuad();
+		}
+
+		glBindFramebuffer( GL_FRAMEBUFFER, frameGraph.getFramebuffer( ssaoRaw ) );
+		glClear( GL_COLOR_BUFFER_BIT );
+		const GLuint aoProgram = ( aoMethod == AO_GTAO )? generateGTAOProgram : generateSSAOProgram;
+		ogl->useProgram( aoProgram );
+		setGBufferUniforms( aoProgram, Projection, View, lights );
+		setViewportScale( aoProgram, ssaoWidth, ssaoHeight, ssaoAllocatedWidth, ssaoAllocatedHeight );	// Reads SSAO sized inputs.
+		glUniform1f( glGetUniformLocation( aoProgram, "frameBufferWidth" ), ssaoWidth );		// To tile the noise texture.
+		glUniform1f( glGetUniformLocation( aoProgram, "frameBufferHeight" ), ssaoHeight );
+
+		// Enable linear depth (for positions) and G-buffer normal textures, and the noise texture.
+		glActiveTexture( GL_TEXTURE0 );
+		glBindTexture( GL_TEXTURE_2D, frameGraph.getTexture( ssaoDepth ) );		// Linear depths, to reconstruct positions in view space.
+		glActiveTexture( GL_TEXTURE1 );
+		glBindTexture( GL_TEXTURE_2D, frameGraph.getTexture( ssaoNormal ) );	// Normals in world space.
+		glActiveTexture( GL_TEXTURE2 );
+		glBindTexture( GL_TEXTURE_2D, ssaoNoiseTexture );		// Noise texture sampler.
+
+		float view_matrix[ELEMENTS_PER_MATRIX];					// Send View and Projection matrices.
+		float proj_matrix[ELEMENTS_PER_MATRIX];
+		Tx::toOpenGLMatrix( view_matrix, View );
+		Tx::toOpenGLMatrix( proj_matrix, Projection );
+		glUniformMatrix4fv( glGetUniformLocation( aoProgram, "View" ), 1, GL_FALSE, view_matrix );
+		glUniformMatrix4fv( glGetUniformLocation( aoProgram, "Projection" ), 1, GL_FALSE, proj_matrix );
+
+		// With temporal accumulation, rotate kernel subsets (or GTAO slices) and shift the noise tiling from frame to frame.
+		const int subsets = enableTemporal? TEMPORAL_SUBSETS : 1;
+		const int shift = enableTemporal? static_cast<int>( frame ) : 0;
+		glUniform1i( glGetUniformLocation( aoProgram, "firstSample" ), shift % subsets );
+		glUniform1i( glGetUniformLocation( aoProgram, "sampleStride" ), subsets );
+		glUniform2f( glGetUniformLocation( aoProgram, "noiseOffset" ), shift % 4, ( shift / 4 ) % 4 );
+		ogl->renderNDCQuad();
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	} );
+
+	////////////////////////////// Fourth pass: blur the SSAO occlusion factor /////////////////////////////////
+
+	const Resource ssaoBlurTarget = ssaoLowRes? frameGraph.import( "ssaoLowResBlur", ssaoLowResBlur ) : ssaoBlurred;
+	if( ssaoBlur == SSAO_BLUR_BILATERAL )
+	{
+		const Resource ssaoBilateral = frameGraph.create( "ssaoBilateralBlur", Descriptor( GL_R16F, ssaoAllocatedWidth, ssaoAllocatedHeight ) );
+		frameGraph.addPass( SSAO_BLUR_PASS, PASS_NAMES[SSAO_BLUR_PASS], { Input( ssaoRaw, 0 ), Input( ssaoDepth, 1 ), Input( ssaoNormal, 2 ) },
+							{ ssaoBilateral, ssaoBlurTarget }, [&, ssaoBilateral]() {
+			// Gaussian of standard deviation radius / 2, where taps k and k + 1 are merged into a single bilinear fetch at
+			// their weighted mean offset, which halves the texture fetches for the occlusion factor, depth, and normals.
+			const int radius = min( max( ssaoBlurRadius, 0 ), MAX_SSAO_BLUR_RADIUS );
+			const float twoSigmaSq = 0.5f * radius * radius;
+			vector<float> taps;
+			for( int k = 1; k <= radius; k += 2 )
+			{
+				float w0 = exp( -k * k / twoSigmaSq );
+				float w1 = ( k < radius )? exp( -( k + 1 ) * ( k + 1 ) / twoSigmaSq ) : 0.0f;	// k + 1 may be out of the radius.
+				taps.push_back( k + w1 / ( w0 + w1 ) );
+				taps.push_back( w0 + w1 );
+			}
+
+			// Horizontal pass into the intermediate target, then vertical pass into the blurred SSAO target.
+			compileSSAOBilateralBlur( static_cast<int>( taps.size() / 2 ) );
+			ogl->useProgram( blurSSAOBilateralProgram );
+			if( !taps.empty() )
+				glUniform2fv( glGetUniformLocation( blurSSAOBilateralProgram, "taps" ), static_cast<GLsizei>( taps.size() / 2 ), taps.data() );
+			for( int i = 0; i < 3; i++ )
+				glBindSampler( i, linearSampler );
+			glBindFramebuffer( GL_FRAMEBUFFER, frameGraph.getFramebuffer( ssaoBilateral ) );
+			glUniform2f( glGetUniformLocation( blurSSAOBilateralProgram, "direction" ), 1, 0 );
+			ogl->renderNDCQuad();
+
+			glActiveTexture( GL_TEXTURE0 );
+			glBindTexture( GL_TEXTURE_2D, frameGraph.getTexture( ssaoBilateral ) );
+			glBindFramebuffer( GL_FRAMEBUFFER, frameGraph.getFramebuffer( ssaoBlurTarget ) );
+			glUniform2f( glGetUniformLocation( blurSSAOBilateralProgram, "direction" ), 0, 1 );
+			ogl->renderNDCQuad();
+			for( int i = 0; i < 3; i++ )
+				glBindSampler( i, 0 );
+			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+		} );
+	}
+	else
+	{
+		frameGraph.addPass( SSAO_BLUR_PASS, PASS_NAMES[SSAO_BLUR_PASS], { Input( ssaoRaw, 0 ) }, { ssaoBlurTarget }, [&]() {
+			glBindFramebuffer( GL_FRAMEBUFFER, frameGraph.getFramebuffer( ssaoBlurTarget ) );
+			glClear( GL_COLOR_BUFFER_BIT );
+			ogl->useProgram( blurSSAOProgram );
+			setViewportScale( blurSSAOProgram, ssaoWidth, ssaoHeight, ssaoAllocatedWidth, ssaoAllocatedHeight );
+			ogl->renderNDCQuad();
+			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+		} );
+	}
+
+	////////////////////// Optional pass: upsample low resolution SSAO with the G-buffer geometry //////////////////////
+
+	if( ssaoLowRes )
+	{
+		frameGraph.addPass( SSAO_UPSAMPLE_PASS, PASS_NAMES[SSAO_UPSAMPLE_PASS], { Input( ssaoBlurTarget, 0 ), Input( ssaoDepth, 1 ),
+							Input( ssaoNormal, 2 ), Input( linearDepth, 3 ), Input( gBufferTargets[0], 4 ) }, { ssaoBlurred }, [&]() {
+			glViewport( 0, 0, renderWidth, renderHeight );
+			glBindFramebuffer( GL_FRAMEBUFFER, frameGraph.getFramebuffer( ssaoBlurred ) );
+			ogl->useProgram( upsampleSSAOProgram );
+			glUniform1i( glGetUniformLocation( upsampleSSAOProgram, "downsampling" ), ssaoDownsampling );
+			ogl->renderNDCQuad();
+			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+		} );
+	}
+
+	//////////// Optional passes: indirect lighting at a low resolution or interleaved, and reconstruction ////////////
+
+	vector<Input> indirectInputs = rsmAndGBuffer;
+	indirectInputs.push_back( Input( linearDepth, 14 ) );		// Linear depth, for the geometry-aware weights.
+	const Resource indirectLowRes = frameGraph.create( "indirectLowRes", indirectLowResDescriptor() );
+	const Resource indirectFull = frameGraph.create( "indirectFull", Descriptor( GL_RGB16F, width, height ) );
+	frameGraph.addPass( INDIRECT_PASS, PASS_NAMES[INDIRECT_PASS], indirectInputs, { indirectLowRes }, [&]() {
+		glViewport( 0, 0, ( renderWidth + indirectDownsampling - 1 ) / indirectDownsampling, ( renderHeight + indirectDownsampling - 1 ) / indirectDownsampling );
+		glBindFramebuffer( GL_FRAMEBUFFER, frameGraph.getFramebuffer( indirectLowRes ) );
+		glClear( GL_COLOR_BUFFER_BIT );
+		ogl->useProgram( indirectLightingProgram );
+		setGBufferUniforms( indirectLightingProgram, Projection, View, lights );
+		glUniform1i( glGetUniformLocation( indirectLightingProgram, "downsampling" ), indirectDownsampling );
+		glUniform1i( glGetUniformLocation( indirectLightingProgram, "interleave" ), indirectInterleave );
+		glUniform1i( glGetUniformLocation( indirectLightingProgram, "temporalSubsets" ), enableTemporal? TEMPORAL_SUBSETS : 1 );
+		glUniform1i( glGetUniformLocation( indirectLightingProgram, "frame" ), static_cast<int>( frame % TEMPORAL_SUBSETS ) );
+		ogl->renderNDCQuad();
+	} );
+
+	if( indirectInterleave > 1 )								// Combine the sample subsets: horizontal, then vertical blur.
+	{
+		const Resource indirectBlur = frameGraph.create( "indirectBlur", indirectLowResDescriptor() );
+		vector<Input> blurInputs = indirectInputs;
+		blurInputs.push_back( Input( indirectLowRes ) );
+		frameGraph.addPass( INDIRECT_BLUR_PASS, PASS_NAMES[INDIRECT_BLUR_PASS], blurInputs, { indirectLowRes, indirectBlur }, [&, indirectBlur]() {
+			ogl->useProgram( blurIndirectProgram );
+			setGBufferUniforms( blurIndirectProgram, Projection, View, lights );
+			glUniform1i( glGetUniformLocation( blurIndirectProgram, "downsampling" ), indirectDownsampling );
+			glUniform1i( glGetUniformLocation( blurIndirectProgram, "interleave" ), indirectInterleave );
+			glActiveTexture( GL_TEXTURE10 );
+
+			glBindFramebuffer( GL_FRAMEBUFFER, frameGraph.getFramebuffer( indirectBlur ) );
+			glBindTexture( GL_TEXTURE_2D, frameGraph.getTexture( indirectLowRes ) );
+			glUniform2i( glGetUniformLocation( blurIndirectProgram, "direction" ), 1, 0 );
+			ogl->renderNDCQuad();
+
+			glBindFramebuffer( GL_FRAMEBUFFER, frameGraph.getFramebuffer( indirectLowRes ) );
+			glBindTexture( GL_TEXTURE_2D, frameGraph.getTexture( indirectBlur ) );
+			glUniform2i( glGetUniformLocation( blurIndirectProgram, "direction" ), 0, 1 );
+			ogl->renderNDCQuad();
+		} );
+	}
+
+	vector<Input> upsampleInputs = indirectInputs;
+	upsampleInputs.push_back( Input( indirectLowRes, 10 ) );
+	frameGraph.addPass( UPSAMPLE_PASS, PASS_NAMES[UPSAMPLE_PASS], upsampleInputs, { indirectFull }, [&]() {
+		glViewport( 0, 0, renderWidth, renderHeight );
+		glBindFramebuffer( GL_FRAMEBUFFER, frameGraph.getFramebuffer( indirectFull ) );
+		glClear( GL_COLOR_BUFFER_BIT );
+		ogl->useProgram( upsampleIndirectProgram );
+		setGBufferUniforms( upsampleIndirectProgram, Projection, View, lights );
+		glUniform1i( glGetUniformLocation( upsampleIndirectProgram, "downsampling" ), indirectDownsampling );
+		ogl->renderNDCQuad();
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	} );
+
+	////////////////// Optional pass: accumulate SSAO and indirect lighting with reprojected history //////////////////
+
+	Resource ssaoTexture = ssaoBlurred, indirectTexture = indirectFull;
+	if( enableTemporal && ( enableSSAO || enableRSM ) )
+	{
+		const int previous = historyIndex;
+		historyIndex = 1 - historyIndex;
+		const Resource previousHistory[] = { frameGraph.import( "previousSSAOHistory", ssaoHistory[previous] ),
+											 frameGraph.import( "previousIndirectHistory", indirectHistory[previous] ),
+											 frameGraph.import( "previousGeometryHistory", geometryHistory[previous] ) };
+		const Resource history[] = { frameGraph.import( "ssaoHistory", ssaoHistory[historyIndex] ),
+									 frameGraph.import( "indirectHistory", indirectHistory[historyIndex] ),
+									 frameGraph.import( "geometryHistory", geometryHistory[historyIndex] ) };
+
+		// Discard history that doesn't match the current frame: a light moved, or a technique was just switched on.
+		bool lightMoved = !historyValid || previousLightPositions.size() != lights.size();
+		for( size_t l = 0; !lightMoved && l < lights.size(); l++ )
+			lightMoved = norm( lights[l].position - previousLightPositions[l] ) > 0;
+		const bool resetSSAO = !historyValid || !historySSAO;
+		const bool resetIndirect = !historyValid || !historyRSM || lightMoved;
+		const mat44 PreviousModelView = previousModelView;
+		const mat44 PreviousProjection = previousProjection;
+		const float previousScale[] = { previousViewportScale[0], previousViewportScale[1] };
+
+		frameGraph.addPass( TEMPORAL_PASS, PASS_NAMES[TEMPORAL_PASS], { Input( enableSSAO? ssaoBlurred : FrameGraph::NONE, 0 ),
+							Input( enableRSM? indirectFull : FrameGraph::NONE, 1 ), Input( previousHistory[0], 2 ), Input( previousHistory[1], 3 ),
+							Input( previousHistory[2], 4 ), Input( gBufferTargets[0], 5 ), Input( gBufferTargets[2], 6 ) }, { history[0], history[1], history[2] },
+							[&, resetSSAO, resetIndirect, PreviousModelView, PreviousProjection, previousScale]() {
+			glViewport( 0, 0, renderWidth, renderHeight );
+			glBindFramebuffer( GL_FRAMEBUFFER, temporalFBOs[historyIndex] );
+			ogl->useProgram( temporalProgram );
+			setGBufferUniforms( temporalProgram, Projection, View, lights );
+
+			float matrix[ELEMENTS_PER_MATRIX];
+			Tx::toOpenGLMatrix( matrix, inv( Model ) );
+			glUniformMatrix4fv( glGetUniformLocation( temporalProgram, "InverseModel" ), 1, GL_FALSE, matrix );
+			Tx::toOpenGLMatrix( matrix, View );
+			glUniformMatrix4fv( glGetUniformLocation( temporalProgram, "View" ), 1, GL_FALSE, matrix );
+			Tx::toOpenGLMatrix( matrix, PreviousModelView );
+			glUniformMatrix4fv( glGetUniformLocation( temporalProgram, "PreviousModelView" ), 1, GL_FALSE, matrix );
+			Tx::toOpenGLMatrix( matrix, PreviousProjection );
+			glUniformMatrix4fv( glGetUniformLocation( temporalProgram, "PreviousProjection" ), 1, GL_FALSE, matrix );
+			glUniform2fv( glGetUniformLocation( temporalProgram, "previousViewportScale" ), 1, previousScale );
+			glUniform1i( glGetUniformLocation( temporalProgram, "resetSSAO" ), resetSSAO );
+			glUniform1i( glGetUniformLocation( temporalProgram, "resetIndirect" ), resetIndirect );
+			ogl->renderNDCQuad();
+			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+		} );
+
+		ssaoTexture = history[0];
+		indirectTexture = history[1];
+		historyValid = true;
+		historySSAO = enableSSAO;
+		historyRSM = enableRSM;
+	}
+	else
+		historyValid = false;
+
+	previousModelView = View * Model;
+	previousProjection = Projection;
+	previousViewportScale[0] = static_cast<float>( renderWidth ) / width;
+	previousViewportScale[1] = static_cast<float>( renderHeight ) / height;
+	previousLightPositions.clear();
+	for( const Light& light : lights )
+		previousLightPositions.push_back( light.position );
+	frameIndex++;
+
+	///////////////////////// Fourth pass: lighting pass using G-buffer and RSM textures ///////////////////////////
+
+	// Below the output resolution, the lit scene goes into an intermediate target to be upscaled.
+	const bool upscale = ( renderWidth < width || renderHeight < height );
+	const Resource sceneColor = frameGraph.create( "sceneColor", Descriptor( GL_RGBA8, width, height ), []() {
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );		// The upscaling filter merges taps bilinearly.
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	} );
+
+	vector<Input> lightingInputs = rsmAndGBuffer;
+	lightingInputs.push_back( Input( enableSSAO? ssaoTexture : FrameGraph::NONE, 9 ) );			// SSAO blurred (and maybe accumulated) factor.
+	lightingInputs.push_back( Input( useIndirectTexture? indirectTexture : FrameGraph::NONE, 10 ) );	// Upsampled (and maybe accumulated) indirect lighting.
+	frameGraph.addPass( LIGHTING_PASS, PASS_NAMES[LIGHTING_PASS], lightingInputs, { upscale? sceneColor : output }, [&]() {
+		glBindFramebuffer( GL_FRAMEBUFFER, upscale? frameGraph.getFramebuffer( sceneColor ) : targetFBO );
+		glViewport( 0, 0, renderWidth, renderHeight );
+		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+		ogl->useProgram( renderingProgram );					// Using deferred rendering: shade scene.
+		setGBufferUniforms( renderingProgram, Projection, View, lights );
+
+		float eyePosition_vector[ELEMENTS_PER_VERTEX];			// Container for eye position sent to shaders.
+		Tx::toOpenGLMatrix( eyePosition_vector, eye );
+		glUniform3fv( glGetUniformLocation( renderingProgram, "eyePosition" ), 1, eyePosition_vector );
+		glUniform1i( glGetUniformLocation( renderingProgram, "enableSSAO" ), enableSSAO );						// SSAO enabled?
+		glUniform1i( glGetUniformLocation( renderingProgram, "enableRSM" ), enableRSM );						// RSM enabled?
+		glUniform1i( glGetUniformLocation( renderingProgram, "useIndirectTexture" ), useIndirectTexture );		// At low resolution?
+		glUniform1i( glGetUniformLocation( renderingProgram, "shadowMode" ), shadowMode );						// PCSS or VSM?
+		ogl->renderNDCQuad();									// Render lit scene into a unit NDC quad.
+	} );
+
+	///////////////////////// Optional pass: upscale the lit scene to the output resolution //////////////////////////
+
+	if( upscale )
+	{
+		frameGraph.addPass( UPSCALE_PASS, PASS_NAMES[UPSCALE_PASS], { Input( sceneColor, 0 ) }, { output }, [&]() {
+			glBindFramebuffer( GL_FRAMEBUFFER, targetFBO );
+			glViewport( 0, 0, width, height );
+			glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+			ogl->useProgram( upscaleProgram );
+			setViewportScale( upscaleProgram, renderWidth, renderHeight, width, height );
+			ogl->renderNDCQuad();
+		} );
+	}
+
+	frameGraph.execute( targetPool, passTimers, frameIndex );
+	for( int pass = 0; pass < PASS_COUNT; pass++ )
+		passTimed[pass] = frameGraph.isExecuted( pass );
+	targetPool.endFrame();										// Targets left behind by a resize go away.
+}
+
+/**
+ * Send the matrices needed to decode the packed G-buffer (see gbuffer.glsl) and the reflective shadow map (see rsm.glsl)
+ * to a program that's in use.
+ * @param program Shader program.
+ * @param Projection Camera projection matrix.
+ * @param View Camera view matrix.
+ * @param lights Lights whose projective spaces are used for shadows and reflective shadow maps.
+ */
+void Renderer::setGBufferUniforms( GLuint program, const mat44& Projection, const mat44& View, const vector<Light>& lights )
+{
+	float matrix[ELEMENTS_PER_MATRIX];
+	Tx::toOpenGLMatrix( matrix, inv( Projection * View ) );
+	glUniformMatrix4fv( glGetUniformLocation( program, "InverseViewProjection" ), 1, GL_FALSE, matrix );
+	setLightUniforms( program, lights );
+	glUniform1i( glGetUniformLocation( program, "compactRSM" ), rsmFormat != RSM_FLOAT32 );
+	glUniform1i( glGetUniformLocation( program, "rsmGather" ), rsmGather );
+	glUniform1i( glGetUniformLocation( program, "vplCount" ), vplExtractor.getClusterCount() );
+	setViewportScale( program, renderWidth, renderHeight, width, height );
+}
+
+/**
+ * Sample sets are uniform arrays taking one vector per sample, so sizes beyond the fragment shader's uniform storage would
+ * make the programs fail to link.  Shrink them to fit (the rendering program holds both the RSM and PCSS disks).
+ */
+void Renderer::fitSampleCounts()
+{
+	GLint maxVectors = 0;
+	glGetIntegerv( GL_MAX_FRAGMENT_UNIFORM_VECTORS, &maxVectors );
+	const int available = max( maxVectors - RESERVED_UNIFORM_VECTORS, 2 );
+
+	rsmSampleCount = max( rsmSampleCount, 1 );
+	pcssSampleCount = max( pcssSampleCount, 1 );
+	ssaoKernelSize = max( ssaoKernelSize, 1 );
+	if( rsmSampleCount + pcssSampleCount > available )
+	{
+		pcssSampleCount = min( pcssSampleCount, available / 2 );
+		rsmSampleCount = min( rsmSampleCount, available - pcssSampleCount );
+		cerr << "[Renderer] RSM and PCSS samples exceed the fragment uniform limit; using " << rsmSampleCount << " and "
+			 << pcssSampleCount << endl;
+	}
+	if( ssaoKernelSize > available )
+	{
+		ssaoKernelSize = available;
+		cerr << "[Renderer] SSAO samples exceed the fragment uniform limit; using " << ssaoKernelSize << endl;
+	}
+}
+
+/**
+ * Send the lights to a program that's in use (see lights.glsl): their light space transformations, atlas tiles,
+ * positions, and colors.
+ * @param program Shader program.
+ * @param lights Lights created by init().
+ */
+void Renderer::setLightUniforms( GLuint program, const vector<Light>& lights )
+{
+	vector<float> matrices( ELEMENTS_PER_MATRIX * lightCount ), inverses( ELEMENTS_PER_MATRIX * lightCount );
+	vector<float> tiles( 3 * lightCount ), positions( 3 * lightCount ), colors( 3 * lightCount );
+	for( int l = 0; l < lightCount; l++ )
+	{
+		Tx::toOpenGLMatrix( &matrices[ELEMENTS_PER_MATRIX * l], lights[l].SpaceMatrix );
+		Tx::toOpenGLMatrix( &inverses[ELEMENTS_PER_MATRIX * l], inv( lights[l].SpaceMatrix ) );
+		Tx::toOpenGLMatrix( &positions[3 * l], lights[l].position );
+		Tx::toOpenGLMatrix( &colors[3 * l], lights[l].color );
+		tiles[3 * l] = static_cast<float>( rsmTiles[l].x ) / rsmSideLength;		// In atlas texture coordinates.
+		tiles[3 * l + 1] = static_cast<float>( rsmTiles[l].y ) / rsmSideLength;
+		tiles[3 * l + 2] = static_cast<float>( rsmTiles[l].side ) / rsmSideLength;
+	}
+	glUniformMatrix4fv( glGetUniformLocation( program, "LightSpaceMatrices" ), lightCount, GL_FALSE, matrices.data() );
+	glUniformMatrix4fv( glGetUniformLocation( program, "InverseLightSpaceMatrices" ), lightCount, GL_FALSE, inverses.data() );
+	glUniform3fv( glGetUniformLocation( program, "rsmTiles" ), lightCount, tiles.data() );
+	glUniform3fv( glGetUniformLocation( program, "lightPositions" ), lightCount, positions.data() );
+	glUniform3fv( glGetUniformLocation( program, "lightColors" ), lightCount, colors.data() );
+}
+
+/**
+ * Send the rendered fraction of the screen-sized targets that a program in use reads (see viewport.glsl).
+ * @param program Shader program.
+ * @param w Rendered width in texels.
+ * @param h Rendered height in texels.
+ * @param allocatedWidth Width of the targets.
+ * @param allocatedHeight Height of the targets.
+ */
+void Renderer::setViewportScale( GLuint program, int w, int h, int allocatedWidth, int allocatedHeight )
+{
+	glUniform2f( glGetUniformLocation( program, "viewportScale" ), static_cast<float>( w ) / allocatedWidth,
+				 static_cast<float>( h ) / allocatedHeight );
+}
+
+/**
+ * (Re)acquire the targets that follow the output resolution and outlive a frame from the render target pool: G-buffer,
+ * linear depth, full resolution SSAO, and temporal accumulation history, as well as the SSAO targets at their own
+ * resolution.  Targets of the previous size go back to the pool, which deletes them once unused.  Targets that only live
+ * within a frame are created by the frame graph in render().
+ */
+void Renderer::allocateScreenTargets()
+{
+	typedef RenderTargetPool::Descriptor Descriptor;
+
+	// G-buffer.  Packed layout: 12 bytes per pixel.  World space positions are reconstructed from depth, and positions in
+	// light space are recomputed from them (see gbuffer.glsl).
+	for( GLuint* texture : { &gNormal, &gAlbedoSpecular, &gDepth } )
+		targetPool.release( texture );
+	glBindFramebuffer( GL_FRAMEBUFFER, gBuffer );
+
+	// World space normal color buffer, octahedral-encoded.
+	gNormal = targetPool.acquire( Descriptor( GL_RG16, width, height ) );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );								// Don't want to query fragments beyond border.
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gNormal, 0 );			// Attachment 0.
+
+	// RGB diffuse color, and shininess + using Blinn-Phong flag buffer.
+	gAlbedoSpecular = targetPool.acquire( Descriptor( GL_RGBA8, width, height ) );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gAlbedoSpecular, 0 );	// Attachment 1.
+
+	// Depth buffer, with full precision for position reconstruction.
+	float whiteColor[] = { 1.0, 1.0, 1.0, 1.0 };								// Depth = 1.0 beyond the borders.
+	gDepth = targetPool.acquire( Descriptor( GL_DEPTH_COMPONENT32F, width, height ) );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );	// By doing this, anything farther than view space will be the farthest.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, whiteColor );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0 );			// There's only at most one depth attachment/buffer.
+
+	// Tell OpenGL which color attachments we'll use (of this framebuffer) for rendering.
+	GLenum gAttachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers( 2, gAttachments );
+
+	// Check that the framebuffer is complete.
+	if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+		cerr << "[Deferred Rendering] Framebuffer not complete!" << endl;
+
+	// Linear depth mip chain; the linear depth pass attaches one level at a time.
+	targetPool.release( &linearDepthBuffer );
+	linearDepthLevels = 0;
+	for( GLsizei w = width, h = height; linearDepthLevels < MAX_LINEAR_DEPTH_LEVELS && ( linearDepthLevels == 0 || w > 1 || h > 1 ); linearDepthLevels++ )
+	{
+		w = max( w / 2, 1 );
+		h = max( h / 2, 1 );
+	}
+	const float backgroundDepth[] = { BACKGROUND_DEPTH, BACKGROUND_DEPTH, BACKGROUND_DEPTH, BACKGROUND_DEPTH };
+	linearDepthBuffer = targetPool.acquire( Descriptor( GL_R32F, width, height, linearDepthLevels ) );	// Mipmapped only while enableDepthMips is on.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );	// Samples off screen find nothing, like gDepth.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, backgroundDepth );
+
+	// Blurred (and maybe upsampled) SSAO factor, at full resolution.
+	targetPool.release( &ssaoBlurFactor );
+	ssaoBlurFactor = targetPool.acquire( Descriptor( GL_RED, width, height ) );	// Notice: only one channel.
+
+	// Temporal accumulation history, ping-ponged between frames.
+	for( int i = 0; i < 2; i++ )
+	{
+		glBindFramebuffer( GL_FRAMEBUFFER, temporalFBOs[i] );
+		GLuint* targets[] = { &ssaoHistory[i], &indirectHistory[i], &geometryHistory[i] };
+		for( int t = 0; t < 3; t++ )
+		{
+			targetPool.release( targets[t] );
+			*targets[t] = targetPool.acquire( Descriptor( GL_RGBA16F, width, height ) );
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );			// History is reprojected with bilinear filtering.
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+			glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + t, GL_TEXTURE_2D, *targets[t], 0 );
+		}
+
+		GLenum historyAttachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+		glDrawBuffers( 3, historyAttachments );
+		if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+			cerr << "[Temporal] Framebuffer not complete!" << endl;
+	}
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	historyValid = false;
+
+	allocateSSAOLowRes();
+}
+
+/**
+ * @return Format and size of the low resolution indirect lighting and its blur intermediate (transient targets).
+ */
+RenderTargetPool::Descriptor Renderer::indirectLowResDescriptor() const
+{
+	return RenderTargetPool::Descriptor( GL_RGBA16F, ( width + indirectDownsampling - 1 ) / indirectDownsampling,
+										 ( height + indirectDownsampling - 1 ) / indirectDownsampling );
+}
+
+/**
+ * (Re)acquire, when SSAO is generated at a lower resolution, the point-sampled G-buffer depth and normals it reads and its
+ * blurred result.  The occlusion factor and the intermediate of the bilateral blur are transient targets of the frame.
+ */
+void Renderer::allocateSSAOLowRes()
+{
+	typedef RenderTargetPool::Descriptor Descriptor;
+	const int w = ( width + ssaoDownsampling - 1 ) / ssaoDownsampling;
+	const int h = ( height + ssaoDownsampling - 1 ) / ssaoDownsampling;
+
+	// Low resolution targets are only needed while downsampling.
+	for( GLuint* texture : { &ssaoDepthLowRes, &ssaoNormalLowRes, &ssaoLowResBlur } )
+		targetPool.release( texture );
+	if( ssaoDownsampling > 1 )
+	{
+		if( ssaoInputFBO == 0 )
+			glGenFramebuffers( 1, &ssaoInputFBO );
+		glBindFramebuffer( GL_FRAMEBUFFER, ssaoInputFBO );
+		const float borderColor[] = { BACKGROUND_DEPTH, 1, 1, 1 };			// Background beyond the borders, as in the linear depth.
+		GLuint* inputs[] = { &ssaoDepthLowRes, &ssaoNormalLowRes };
+		const GLint inputFormats[] = { GL_R32F, GL_RG16 };
+		for( int i = 0; i < 2; i++ )
+		{
+			*inputs[i] = targetPool.acquire( Descriptor( inputFormats[i], w, h ) );
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+			glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor );
+			glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, *inputs[i], 0 );
+		}
+		GLenum attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers( 2, attachments );
+		if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+			cerr << "[SSAO low resolution] Framebuffer not complete!" << endl;
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+		ssaoLowResBlur = targetPool.acquire( Descriptor( GL_RED, w, h ) );
+	}
+	renderTargetsStale = true;
+}
+
+/**
+ * Reset the screen-sized targets that passes don't clear themselves to the background, so that texels beyond the
+ * rendered region (left over from a larger render scale) read as nothing there, like texels beyond the borders.
+ */
+void Renderer::clearRenderTargets()
+{
+	const float background[] = { BACKGROUND_DEPTH, BACKGROUND_DEPTH, BACKGROUND_DEPTH, BACKGROUND_DEPTH };
+	const float ones[] = { 1, 1, 1, 1 };						// No occlusion, and the border of the low resolution normals.
+
+	glBindFramebuffer( GL_FRAMEBUFFER, linearDepthFBO );
+	for( int level = 0; level < linearDepthLevels; level++ )
+	{
+		glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, linearDepthBuffer, level );
+		glClearBufferfv( GL_COLOR, 0, background );
+	}
+
+	if( ssaoDepthLowRes != 0 )
+	{
+		glBindFramebuffer( GL_FRAMEBUFFER, ssaoInputFBO );
+		glClearBufferfv( GL_COLOR, 0, background );
+		glClearBufferfv( GL_COLOR, 1, ones );
+	}
+	for( GLuint texture : { ssaoLowResBlur, ssaoBlurFactor } )
+	{
+		if( texture == 0 )
+			continue;
+		glBindFramebuffer( GL_FRAMEBUFFER, targetPool.getFramebuffer( texture ) );
+		glClearBufferfv( GL_COLOR, 0, ones );
+	}
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	renderTargetsStale = false;
+}
+
+/**
+ * Let the dynamic resolution controller adjust the render scale from the GPU times of the last measured frame: the
+ * passes from the G-buffer on scale with the render resolution, and the reflective shadow map passes don't.
+ */
+void Renderer::updateRenderScale()
+{
+	if( !dynamicResolution.isEnabled() || !hasNewPassTime( LIGHTING_PASS ) )
+		return;
+
+	double scaled = 0, fixed = 0;
+	for( int pass = 0; pass < PASS_COUNT; pass++ )
+	{
+		if( !passTimed[pass] )
+			continue;
+		const double ms = passTimers[pass].getMilliseconds();
+		if( pass >= GBUFFER_PASS && pass <= LIGHTING_PASS )
+			scaled += ms;
+		else
+			fixed += ms;
+	}
+	if( dynamicResolution.update( scaled, fixed ) )
+		setRenderScale( dynamicResolution.getScale() );
+}
+
+/**
+ * (Re)compile the bilateral SSAO blur program if it isn't specialized for the requested number of taps.
+ * @param taps Merged taps on each side of a pixel.
+ */
+void Renderer::compileSSAOBilateralBlur( int taps )
+{
+	if( taps == blurSSAOBilateralTaps )
+		return;
+
+	Shaders shaders;
+	glDeleteProgram( blurSSAOBilateralProgram );
+	blurSSAOBilateralProgram = shaders.compile( conf::SHADERS_FOLDER + "generateSSAO.vert", conf::SHADERS_FOLDER + "blurSSAOBilateral.frag",
+												"#define TAP_COUNT " + to_string( taps ) + "\n" );
+	blurSSAOBilateralTaps = taps;
+
+	glUseProgram( blurSSAOBilateralProgram );
+	glUniform1i( glGetUniformLocation( blurSSAOBilateralProgram, "sSSAOFactor" ), 0 );
+	glUniform1i( glGetUniformLocation( blurSSAOBilateralProgram, "sSSAODepth" ), 1 );	// Same depth and normals as SSAO.
+	glUniform1i( glGetUniformLocation( blurSSAOBilateralProgram, "sSSAONormal" ), 2 );
+}
+
+/**
+ * (Re)allocate the reflective shadow map textures for the current format and resolution.
+ * Compact formats have no position texture: positions are reconstructed from depth with the lights' inverse space matrices.
+ */
+void Renderer::allocateRSM()
+{
+	// Release the previous textures, if any.
+	GLuint textures[] = { rsmPosition, rsmNormal, rsmFlux, rsmDepth };
+	glDeleteTextures( 4, textures );
+	rsmPosition = rsmNormal = rsmFlux = rsmDepth = 0;
+	if( rsmFBO == 0 )
+		glGenFramebuffers( 1, &rsmFBO );
+
+	rsmSideLength = ( rsmResolution > 0 )? rsmResolution : max( width, height );	// Texture size.
+	layoutRSMAtlas();
+	const bool compact = ( rsmFormat != RSM_FLOAT32 );
+	float whiteColor[] = { 1.0, 1.0, 1.0, 1.0 };								// Depth = 1.0.  So the rendering of the normal scene will produce something larger than this.
+	float blackColor[] = { 0, 0, 0, 0 };										// Position = normal = color = 0.
+
+	glBindFramebuffer( GL_FRAMEBUFFER, rsmFBO );
+
+	// Positions color buffer.
+	if( !compact )
+	{
+		glGenTextures( 1, &(rsmPosition) );
+		glBindTexture( GL_TEXTURE_2D, rsmPosition );
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F, rsmSideLength, rsmSideLength, 0, GL_RGB, GL_FLOAT, nullptr );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+		glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, blackColor );	// Non comparison sampler beyond borders of light space.
+	}
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rsmPosition, 0 );	// Attached to layout 0 (or detached).
+
+	// Normals color buffer.
+	glGenTextures( 1, &(rsmNormal) );
+	glBindTexture( GL_TEXTURE_2D, rsmNormal );
+	if( compact )
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RG16, rsmSideLength, rsmSideLength, 0, GL_RG, GL_FLOAT, nullptr );
+	else
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F, rsmSideLength, rsmSideLength, 0, GL_RGB, GL_FLOAT, nullptr );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, blackColor );		// Non comparison sampler beyond borders of light space.
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, rsmNormal, 0 );		// Attached to layout 1.
+
+	// Flux color buffer: it's low dynamic range (albedo times light color), so 10 or 11 bits per channel are enough.
+	const GLint fluxFormat[RSM_FORMAT_COUNT] = { GL_RGB32F, GL_RGB10_A2, GL_R11F_G11F_B10F };
+	glGenTextures( 1, &(rsmFlux) );
+	glBindTexture( GL_TEXTURE_2D, rsmFlux );
+	glTexImage2D( GL_TEXTURE_2D, 0, fluxFormat[rsmFormat], rsmSideLength, rsmSideLength, 0, ( rsmFormat == RSM_RGB10A2 )? GL_RGBA : GL_RGB, GL_FLOAT, nullptr );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, blackColor );		// Non comparison sampler beyond borders of light space.
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, rsmFlux, 0 );		// Attached to layout 2.
+
+	// Depth buffer, with full precision when positions are reconstructed from it.
+	glGenTextures( 1, &(rsmDepth) );
+	glBindTexture( GL_TEXTURE_2D, rsmDepth );
+	glTexImage2D( GL_TEXTURE_2D, 0, compact? GL_DEPTH_COMPONENT32F : GL_DEPTH_COMPONENT, rsmSideLength, rsmSideLength, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );	// By doing this, anything farther than the shadow map will appear in light.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, whiteColor );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, rsmDepth, 0 );			// There's only at most one depth attachment/buffer.
+
+	// Tell OpenGL which color attachments will be used.
+	GLenum attachments[] = { compact? GL_NONE : GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+	glDrawBuffers( 3, attachments );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, 0, 0 );	// Variance shadow map moments, when allocated.
+
+	if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+		cerr << "[RSM] Framebuffer not complete!" << endl;
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );										// Unbind.
+
+	// Min/max depth pyramid, from half the RSM resolution down to 1x1.
+	glDeleteTextures( 1, &rsmDepthPyramid );
+	if( rsmDepthPyramidFBO == 0 )
+		glGenFramebuffers( 1, &rsmDepthPyramidFBO );
+	glGenTextures( 1, &rsmDepthPyramid );
+	glBindTexture( GL_TEXTURE_2D, rsmDepthPyramid );
+	rsmDepthPyramidLevels = 0;
+	for( GLsizei side = rsmSideLength; side > 1; rsmDepthPyramidLevels++ )
+	{
+		side = max( side / 2, 1 );
+		glTexImage2D( GL_TEXTURE_2D, rsmDepthPyramidLevels, GL_RG32F, side, side, 0, GL_RG, GL_FLOAT, nullptr );
+	}
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, max( rsmDepthPyramidLevels - 1, 0 ) );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+	// The hierarchical RSM and the variance shadow map are allocated again, at the new size, the next time they're used.
+	GLuint mipTextures[] = { rsmMipFlux, rsmMipPosition, rsmMipNormal, shadowMoments };
+	glDeleteTextures( 4, mipTextures );
+	rsmMipFlux = rsmMipPosition = rsmMipNormal = shadowMoments = 0;
+	invalidateRSM();
+
+	reportRSMMemory( cout );
+}
+
+/**
+ * Split the reflective shadow map atlas into a square tile per light.  A light's tile takes a power of two fraction of
+ * the atlas area (down to 1/4^MAX_TILE_LEVEL) close to its share of the total importance, and the most important lights
+ * grow into the area left over.  Since the areas are powers of two that add up to at most the atlas, packing them from
+ * the largest one into the smallest free square that fits (splitting it into quadrants) never fails.
+ * A single light takes the whole atlas.
+ */
+void Renderer::layoutRSMAtlas()
+{
+	rsmTiles.assign( lightCount, { 0, 0, rsmSideLength } );
+	if( lightCount == 1 )
+		return;
+
+	const int units = 1 << ( 2 * MAX_TILE_LEVEL );							// Atlas area, in smallest tiles.
+	auto area = []( int level ) { return 1 << ( 2 * ( MAX_TILE_LEVEL - level ) ); };
+	rsmSideLength = ( ( rsmSideLength + ( 1 << MAX_TILE_LEVEL ) - 1 ) >> MAX_TILE_LEVEL ) << MAX_TILE_LEVEL;	// Divisible by the smallest side.
+	rsmSideLength = max( rsmSideLength, 1 << MAX_TILE_LEVEL );
+
+	// Lights by decreasing importance.
+	vector<int> order( lightCount );
+	double total = 0;
+	for( int l = 0; l < lightCount; l++ )
+	{
+		order[l] = l;
+		total += lightImportances[l];
+	}
+	stable_sort( order.begin(), order.end(), [this]( int a, int b ) { return lightImportances[a] > lightImportances[b]; } );
+
+	// Largest tiles that don't exceed the importance shares; shrink the largest ones if the smallest tiles overflowed
+	// the atlas, and then grow the most important ones while they fit.
+	vector<int> levels( lightCount, 0 );
+	int used = 0;
+	for( int l = 0; l < lightCount; l++ )
+	{
+		const double share = ( total > 0 )? lightImportances[l] / total : 1.0 / lightCount;
+		while( levels[l] < MAX_TILE_LEVEL && area( levels[l] ) > share * units )
+			levels[l]++;
+		used += area( levels[l] );
+	}
+	for( int k = lightCount - 1; used > units; k = ( k > 0 )? k - 1 : lightCount - 1 )
+	{
+		const int l = order[k];
+		if( levels[l] < MAX_TILE_LEVEL && levels[l] == *min_element( levels.begin(), levels.end() ) )
+		{
+			used -= area( levels[l] ) - area( levels[l] + 1 );
+			levels[l]++;
+		}
+	}
+	for( int l : order )
+	{
+		while( levels[l] > 0 && used + area( levels[l] - 1 ) - area( levels[l] ) <= units )
+		{
+			used += area( levels[l] - 1 ) - area( levels[l] );
+			levels[l]--;
+		}
+	}
+
+	// Buddy packing, largest tiles first.
+	stable_sort( order.begin(), order.end(), [&levels]( int a, int b ) { return levels[a] < levels[b]; } );
+	vector<RSMTile> available = { { 0, 0, rsmSideLength } };
+	for( int l : order )
+	{
+		const GLsizei side = rsmSideLength >> levels[l];
+		size_t best = available.size();
+		for( size_t f = 0; f < available.size(); f++ )
+			if( available[f].side >= side && ( best == available.size() || available[f].side < available[best].side ) )
+				best = f;
+		RSMTile tile = available[best];
+		available.erase( available.begin() + best );
+		while( tile.side > side )												// Keep the lower left quadrant.
+		{
+			tile.side /= 2;
+			available.push_back( { tile.x + tile.side, tile.y, tile.side } );
+			available.push_back( { tile.x, tile.y + tile.side, tile.side } );
+			available.push_back( { tile.x + tile.side, tile.y + tile.side, tile.side } );
+		}
+		rsmTiles[l] = tile;
+	}
+
+	cout << "[RSM] Atlas of " << lightCount << " lights:";
+	for( int l = 0; l < lightCount; l++ )
+		cout << ( ( l > 0 )? ", " : " " ) << rsmTiles[l].side << "x" << rsmTiles[l].side << " at (" << rsmTiles[l].x << ", " << rsmTiles[l].y << ")";
+	cout << endl;
+}
+
+/**
+ * Allocate the hierarchical reflective shadow map mip chains at the reflective shadow map resolution.
+ */
+void Renderer::allocateRSMMips()
+{
+	if( rsmMipFBO == 0 )
+		glGenFramebuffers( 1, &rsmMipFBO );
+	glBindFramebuffer( GL_FRAMEBUFFER, rsmMipFBO );
+
+	float blackColor[] = { 0, 0, 0, 0 };										// Zero flux weight beyond the borders of light space.
+	GLuint* mips[] = { &rsmMipFlux, &rsmMipPosition, &rsmMipNormal };
+	const GLint mipFormats[] = { GL_RGBA16F, GL_RGBA32F, GL_RGBA16F };			// Positions need full precision.
+	for( int i = 0; i < 3; i++ )
+	{
+		glGenTextures( 1, mips[i] );
+		glBindTexture( GL_TEXTURE_2D, *mips[i] );
+		glTexImage2D( GL_TEXTURE_2D, 0, mipFormats[i], rsmSideLength, rsmSideLength, 0, GL_RGBA, GL_FLOAT, nullptr );
+		glGenerateMipmap( GL_TEXTURE_2D );										// Allocate the whole chain.
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+		glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, blackColor );
+		glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, *mips[i], 0 );
+	}
+	GLenum attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+	glDrawBuffers( 3, attachments );
+
+	if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+		cerr << "[Hierarchical RSM] Framebuffer not complete!" << endl;
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	const size_t bytes = ( 8 + 16 + 8 ) * rsmSideLength * rsmSideLength * 4 / 3;	// Mip chains take 4/3 of their base level.
+	cout << "[RSM] Hierarchical mip chains: " << fixed << setprecision( 1 ) << bytes / ( 1024.0 * 1024.0 ) << " MiB" << defaultfloat << endl;
+}
+
+/**
+ * Allocate the variance shadow map moments at the reflective shadow map resolution, and attach them to the reflective
+ * shadow map framebuffer.  The blur intermediate comes from the render target pool.
+ */
+void Renderer::allocateShadowMoments()
+{
+	float farthest[] = { 1, 1, 1, 1 };											// Beyond light space, everything is lit.
+	if( shadowMomentsFBO == 0 )
+		glGenFramebuffers( 1, &shadowMomentsFBO );
+	glBindFramebuffer( GL_FRAMEBUFFER, shadowMomentsFBO );
+
+	glGenTextures( 1, &shadowMoments );
+	glBindTexture( GL_TEXTURE_2D, shadowMoments );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RG32F, rsmSideLength, rsmSideLength, 0, GL_RG, GL_FLOAT, nullptr );	// Half floats lose the variance.
+	glGenerateMipmap( GL_TEXTURE_2D );											// Allocate the whole chain.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, farthest );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, shadowMoments, 0 );
+	if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+		cerr << "[VSM] Framebuffer not complete!" << endl;
+
+	glBindFramebuffer( GL_FRAMEBUFFER, rsmFBO );								// The RSM pass writes the moments.
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, shadowMoments, 0 );
+	if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+		cerr << "[RSM] Framebuffer not complete!" << endl;
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	const size_t bytes = 8 * rsmSideLength * rsmSideLength * 4 / 3;			// Mipmapped moments.
+	cout << "[VSM] Shadow moments: " << fixed << setprecision( 1 ) << bytes / ( 1024.0 * 1024.0 ) << " MiB" << defaultfloat << endl;
+}
+
+/**
+ * Release shader programs and render targets.
+ */
+void Renderer::destroy()
+{
+	// Delete OpenGL programs.
+	glDeleteProgram( renderingProgram );
+	glDeleteProgram( generateGBufferProgram );
+	glDeleteProgram( generateRSMProgram );
+	glDeleteProgram( generateSSAOProgram );
+	glDeleteProgram( generateGTAOProgram );
+	glDeleteProgram( generateLinearDepthProgram );
+	glDeleteProgram( blurSSAOProgram );
+	glDeleteProgram( blurSSAOBilateralProgram );
+	glDeleteProgram( downsampleSSAOProgram );
+	glDeleteProgram( upsampleSSAOProgram );
+	glDeleteProgram( indirectLightingProgram );
+	glDeleteProgram( upsampleIndirectProgram );
+	glDeleteProgram( blurIndirectProgram );
+	glDeleteProgram( temporalProgram );
+	glDeleteProgram( generateRSMMipsProgram );
+	glDeleteProgram( generateDepthPyramidProgram );
+	glDeleteProgram( blurShadowMomentsProgram );
+	glDeleteProgram( upscaleProgram );
+	vplExtractor.destroy();
+
+	// Delete render targets.
+	targetPool.destroy();										// Screen-sized targets and intermediates.
+	GLuint textures[] = { ssaoNoiseTexture, rsmPosition, rsmNormal, rsmFlux, rsmDepth,
+						  rsmMipFlux, rsmMipPosition, rsmMipNormal, rsmDepthPyramid, shadowMoments };
+	glDeleteTextures( sizeof( textures ) / sizeof( GLuint ), textures );
+	GLuint framebuffers[] = { gBuffer, ssaoInputFBO, temporalFBOs[0], temporalFBOs[1], rsmFBO, rsmMipFBO,
+							  rsmDepthPyramidFBO, shadowMomentsFBO, linearDepthFBO };
+	glDeleteFramebuffers( sizeof( framebuffers ) / sizeof( GLuint ), framebuffers );
+	glDeleteSamplers( 1, &linearSampler );
+
+	for( GPUTimer& timer : passTimers )
+		timer.destroy();
+}
+
+/**
+ * Follow a change of the output resolution (e.g. the window was resized).  Screen-sized targets are acquired at the new
+ * size, and the previous ones go back to the pool, which deletes them after a few frames; the render scale is kept, and
+ * the reflective shadow map is reallocated if its size follows the output's.
+ * @param w New output width in pixels.
+ * @param h New output height in pixels.
+ */
+void Renderer::resize( int w, int h )
+{
+	if( w <= 0 || h <= 0 || ( w == width && h == height ) )
+		return;
+
+	const double scale = getRenderScale();
+	const bool rsmFollows = ( rsmResolution == 0 && max( w, h ) != max( width, height ) );
+	width = w;
+	height = h;
+	renderWidth = max( static_cast<int>( lround( width * scale ) ), 1 );
+	renderHeight = max( static_cast<int>( lround( height * scale ) ), 1 );
+	allocateScreenTargets();									// Also marks the targets as stale and drops the history.
+	if( rsmFollows )
+		allocateRSM();
+}
+
+/**
+ * Whether the last render() call collected a new GPU time for a pass.
+ * Results lag a few frames behind, and disabled passes don't produce any.
+ * @param pass Pass identifier.
+ * @return True if getPassMilliseconds() holds a sample not reported before.
+ */
+bool Renderer::hasNewPassTime( Pass pass ) const
+{
+	return passTimed[pass] && passTimers[pass].hasNewResult();
+}
+
+/**
+ * Most recently collected GPU time of a pass.
+ * @param pass Pass identifier.
+ * @return Elapsed time in milliseconds.
+ */
+double Renderer::getPassMilliseconds( Pass pass ) const
+{
+	return passTimers[pass].getMilliseconds();
+}
+
+/**
+ * How late the most recently collected GPU time of a pass is.
+ * @param pass Pass identifier.
+ * @return Number of render() calls between the one that timed the pass and the last one (0 if it was the last one).
+ */
+int Renderer::getPassFrameLag( Pass pass ) const
+{
+	return static_cast<int>( frameIndex - passTimers[pass].getResultFrame() );
+}
+
+/**
+ * G-buffer texture with octahedral-encoded world space normals (for inspection and regression tests).
+ * @return Texture ID.
+ */
+GLuint Renderer::getGBufferNormal() const
+{
+	return gNormal;
+}
+
+/**
+ * Blurred SSAO occlusion factor texture (for inspection and regression tests).
+ * @return Texture ID.
+ */
+GLuint Renderer::getSSAOBlurFactor() const
+{
+	return ssaoBlurFactor;
+}
+
+/**
+ * Choose the resolution of the SSAO pass.  With a factor of 1, occlusion is generated at full resolution; otherwise, it's
+ * generated and blurred once per factor x factor block of pixels (e.g. 2 for 1/4 and 4 for 1/16 of the pixels) from a
+ * point-sampled copy of the G-buffer, and upsampled with the G-buffer normals and depths.
+ * @param factor Full resolution pixels per SSAO pixel, along each axis.
+ */
+void Renderer::setSSAODownsampling( int factor )
+{
+	factor = max( factor, 1 );
+	if( factor == ssaoDownsampling )
+		return;
+
+	ssaoDownsampling = factor;
+	if( ssaoBlurFactor != 0 )									// Already initialized?
+		allocateSSAOLowRes();
+}
+
+/**
+ * Resolution of the SSAO pass.
+ * @return Full resolution pixels per SSAO pixel, along each axis.
+ */
+int Renderer::getSSAODownsampling() const
+{
+	return ssaoDownsampling;
+}
+
+/**
+ * Choose the resolution of the indirect lighting pass.  With a factor of 1 (and no interleaved sampling), indirect
+ * lighting is evaluated at full resolution within the lighting pass; otherwise, it's evaluated once per factor x factor
+ * block of pixels (e.g. 2 for 1/4 and 4 for 1/16 of the pixels) and upsampled with the G-buffer normals and depths.
+ * @param factor Full resolution pixels per indirect lighting pixel, along each axis.
+ */
+void Renderer::setIndirectDownsampling( int factor )
+{
+	factor = max( factor, 1 );
+	if( factor == indirectDownsampling )
+		return;
+
+	indirectDownsampling = factor;								// Its targets are transient: the next frame acquires them.
+}
+
+/**
+ * Resolution of the indirect lighting pass.
+ * @return Full resolution pixels per indirect lighting pixel, along each axis.
+ */
+int Renderer::getIndirectDownsampling() const
+{
+	return indirectDownsampling;
+}
+
+/**
+ * Choose interleaved sampling for indirect lighting: each pixel in an n x n tile gathers a disjoint subset of the RSM
+ * samples (about 1/n^2 of them), and a separable depth and normal-aware blur reconstructs the full estimate.
+ * @param n Tile side; 1 turns interleaved sampling off.
+ */
+void Renderer::setIndirectInterleave( int n )
+{
+	indirectInterleave = max( n, 1 );
+}
+
+/**
+ * Interleaved sampling tile side for indirect lighting.
+ * @return Tile side, or 1 if interleaved sampling is off.
+ */
+int Renderer::getIndirectInterleave() const
+{
+	return indirectInterleave;
+}
+
+/**
+ * Choose how the reflective shadow map is stored (reallocating it if already initialized).
+ * @param format Full precision or compact format.
+ */
+void Renderer::setRSMFormat( RSMFormat format )
+{
+	if( format == rsmFormat || format < 0 || format >= RSM_FORMAT_COUNT )
+		return;
+
+	rsmFormat = format;
+	if( rsmFBO != 0 )											// Already initialized?
+		allocateRSM();
+}
+
+/**
+ * Reflective shadow map storage.
+ * @return Format.
+ */
+Renderer::RSMFormat Renderer::getRSMFormat() const
+{
+	return rsmFormat;
+}
+
+/**
+ * Choose the reflective shadow map resolution, independently of the render resolution (reallocating it if already
+ * initialized).
+ * @param side Atlas texture side in texels; 0 matches the largest render dimension.
+ */
+void Renderer::setRSMResolution( int side )
+{
+	side = max( side, 0 );
+	if( side == rsmResolution )
+		return;
+
+	rsmResolution = side;
+	if( rsmFBO != 0 )
+		allocateRSM();
+}
+
+/**
+ * Requested reflective shadow map resolution.
+ * @return Atlas texture side in texels; 0 matches the largest render dimension.
+ */
+int Renderer::getRSMResolution() const
+{
+	return rsmResolution;
+}
+
+/**
+ * Allocated reflective shadow map atlas side.  With several lights, the requested resolution is rounded up to a multiple
+ * of the smallest tile's side.
+ * @return Side in texels (once allocated).
+ */
+int Renderer::getRSMSideLength() const
+{
+	return rsmSideLength;
+}
+
+/**
+ * Reflective shadow map flux texture, with every light's tile.
+ * @return Texture name (once allocated).
+ */
+GLuint Renderer::getRSMFlux() const
+{
+	return rsmFlux;
+}
+
+/**
+ * Reflective shadow map memory per texel, counting every texture (and the depth buffer) it uses.
+ * @param format Reflective shadow map format.
+ * @return Bytes per texel.
+ */
+size_t Renderer::getRSMBytesPerTexel( RSMFormat format )
+{
+	const size_t DEPTH_BYTES = 4;
+	if( format == RSM_FLOAT32 )
+		return 3 * 12 + DEPTH_BYTES;							// RGB32F positions, normals, and flux.
+	return 4 + 4 + DEPTH_BYTES;									// RG16 normals, and RGB10A2 or R11G11B10F flux.
+}
+
+/**
+ * Parse a reflective shadow map format name (see RSM_FORMAT_NAMES).
+ * @param name Format name.
+ * @return Format, or RSM_FORMAT_COUNT if the name is unknown.
+ */
+Renderer::RSMFormat Renderer::rsmFormatFromName( const string& name )
+{
+	for( int i = 0; i < RSM_FORMAT_COUNT; i++ )
+		if( name == RSM_FORMAT_NAMES[i] )
+			return static_cast<RSMFormat>( i );
+	return RSM_FORMAT_COUNT;
+}
+
+/**
+ * Print the reflective shadow map memory that each format takes at the current resolution.
+ * @param os Output stream.
+ */
+void Renderer::reportRSMMemory( ostream& os ) const
+{
+	os << "[RSM] " << rsmSideLength << "x" << rsmSideLength << " texels:";
+	for( int i = 0; i < RSM_FORMAT_COUNT; i++ )
+	{
+		const size_t bytes = getRSMBytesPerTexel( static_cast<RSMFormat>( i ) ) * rsmSideLength * rsmSideLength;
+		os << ( ( i == rsmFormat )? " [" : " " ) << RSM_FORMAT_NAMES[i] << " " << getRSMBytesPerTexel( static_cast<RSMFormat>( i ) )
+		   << " B/texel, " << fixed << setprecision( 1 ) << bytes / ( 1024.0 * 1024.0 ) << " MiB" << ( ( i == rsmFormat )? "]" : "" );
+	}
+	os << defaultfloat << endl;
+}
+
+/**
+ * Print the memory held by the render target pool.
+ * @param os Output stream.
+ */
+void Renderer::reportTargetMemory( ostream& os ) const
+{
+	targetPool.report( os );
+}
+
+/**
+ * Print the passes the last frame ran, in order, and those its frame graph culled.
+ * @param os Output stream.
+ */
+void Renderer::reportFrameGraph( ostream& os ) const
+{
+	frameGraph.report( os );
+}
+
+/**
+ * Parse an indirect lighting gathering method name (see RSM_GATHER_NAMES).
+ * @param name Method name.
+ * @return Gathering method, or GATHER_COUNT if the name is unknown.
+ */
+Renderer::RSMGather Renderer::rsmGatherFromName( const string& name )
+{
+	for( int i = 0; i < GATHER_COUNT; i++ )
+		if( name == RSM_GATHER_NAMES[i] )
+			return static_cast<RSMGather>( i );
+	return GATHER_COUNT;
+}
+
+/**
+ * Parse a shadow filtering method name (see SHADOW_MODE_NAMES).
+ * @param name Method name.
+ * @return Shadow mode, or SHADOW_MODE_COUNT if the name is unknown.
+ */
+Renderer::ShadowMode Renderer::shadowModeFromName( const string& name )
+{
+	for( int i = 0; i < SHADOW_MODE_COUNT; i++ )
+		if( name == SHADOW_MODE_NAMES[i] )
+			return static_cast<ShadowMode>( i );
+	return SHADOW_MODE_COUNT;
+}
+
+/**
+ * Parse an ambient occlusion method name (see AO_METHOD_NAMES).
+ * @param name Method name.
+ * @return Ambient occlusion method, or AO_METHOD_COUNT if the name is unknown.
+ */
+Renderer::AOMethod Renderer::aoMethodFromName( const string& name )
+{
+	for( int i = 0; i < AO_METHOD_COUNT; i++ )
+		if( name == AO_METHOD_NAMES[i] )
+			return static_cast<AOMethod>( i );
+	return AO_METHOD_COUNT;
+}
+
+/**
+ * Parse an SSAO blur name (see SSAO_BLUR_NAMES).
+ * @param name Blur name.
+ * @return SSAO blur, or SSAO_BLUR_COUNT if the name is unknown.
+ */
+Renderer::SSAOBlur Renderer::ssaoBlurFromName( const string& name )
+{
+	for( int i = 0; i < SSAO_BLUR_COUNT; i++ )
+		if( name == SSAO_BLUR_NAMES[i] )
+			return static_cast<SSAOBlur>( i );
+	return SSAO_BLUR_COUNT;
+}
+
+/**
+ * CPU time spent sampling and clustering virtual point lights in their last rebuild.
+ * @return Milliseconds.
+ */
+double Renderer::getVPLMilliseconds() const
+{
+	return vplExtractor.getCPUMilliseconds();
+}
+
+/**
+ * Force the reflective shadow map to be rendered again in the next frame.
+ * Call it whenever scene objects move or change: the cache only watches the lights and the Model matrix.
+ */
+void Renderer::invalidateRSM()
+{
+	rsmValid = false;
+	rsmMipsValid = false;
+	rsmDepthPyramidValid = false;
+	shadowMomentsValid = false;
+}
+
+/**
+ * Number of frames that rendered the reflective shadow map.
+ * @return Frames since initialization.
+ */
+unsigned long Renderer::getRSMRenderedFrames() const
+{
+	return rsmRenderedFrames;
+}
+
+/**
+ * Number of frames that reused the reflective shadow map from an earlier frame.
+ * @return Frames since initialization.
+ */
+unsigned long Renderer::getRSMReusedFrames() const
+{
+	return rsmReusedFrames;
+}
+
+/**
+ * Whether a pass only runs when the reflective shadow map is rendered, so that frames reusing the RSM skip it (along
+ * with the VPL readback and rebuild, which are untimed).
+ * @param pass Pass identifier.
+ * @return True for the RSM pass and the passes that derive from the RSM alone.
+ */
+bool Renderer::isRSMPass( Pass pass )
+{
+	return pass == RSM_PASS || pass == RSM_DEPTH_PASS || pass == SHADOW_MOMENTS_PASS || pass == RSM_MIPS_PASS;
+}
+
+/**
+ * Output width.
+ * @return Width in pixels.
+ */
+int Renderer::getWidth() const
+{
+	return width;
+}
+
+/**
+ * Output height.
+ * @return Height in pixels.
+ */
+int Renderer::getHeight() const
+{
+	return height;
+}
+
+/**
+ * Render screen-sized passes at a fraction of the output resolution, and upscale the lit scene to the output.  Targets
+ * stay allocated at the output resolution, so changing the scale is cheap.  Switches the frame budget off.
+ * @param scale Fraction of the output width and height, in [0.05, 1].
+ */
+void Renderer::setRenderScale( double scale )
+{
+	scale = min( max( scale, 0.05 ), 1.0 );
+	const int w = max( static_cast<int>( lround( width * scale ) ), 1 );
+	const int h = max( static_cast<int>( lround( height * scale ) ), 1 );
+	if( dynamicResolution.isEnabled() && scale != dynamicResolution.getScale() )
+		dynamicResolution.setBudget( 0 );
+	if( w == renderWidth && h == renderHeight )
+		return;
+
+	renderWidth = w;
+	renderHeight = h;
+	renderTargetsStale = true;
+}
+
+/**
+ * Render scale.
+ * @return Fraction of the output width and height that screen-sized passes render.
+ */
+double Renderer::getRenderScale() const
+{
+	return static_cast<double>( renderWidth ) / width;
+}
+
+/**
+ * Render width.
+ * @return Width of the screen-sized passes in pixels.
+ */
+int Renderer::getRenderWidth() const
+{
+	return renderWidth;
+}
+
+/**
+ * Render height.
+ * @return Height of the screen-sized passes in pixels.
+ */
+int Renderer::getRenderHeight() const
+{
+	return renderHeight;
+}
+
+/**
+ * Choose the render scale automatically from GPU pass times, so that frames take about a given time (see
+ * DynamicResolution).  Scaling starts from the output resolution.
+ * @param milliseconds GPU time per frame to hold; 0 switches dynamic resolution off and goes back to the output resolution.
+ * @param minScale Smallest fraction of the output width and height to render.
+ */
+void Renderer::setFrameBudget( double milliseconds, double minScale )
+{
+	dynamicResolution.setBounds( minScale, 1.0 );
+	dynamicResolution.setBudget( milliseconds );
+	dynamicResolution.reset();
+	setRenderScale( 1.0 );
+}
+
+/**
+ * Frame budget for dynamic resolution.
+ * @return GPU milliseconds per frame (0: off).
+ */
+double Renderer::getFrameBudget() const
+{
+	return dynamicResolution.getBudget();
+}
@@ -0,0 +1,282 @@
+#ifndef Renderer_h
+#define Renderer_h
+
+#include <armadillo>
+#include <vector>
+#include <string>
+#include <ostream>
+#include "OpenGLHeaders.h"
+#include "OpenGL.h"
+#include "Light.h"
+#include "GPUTimer.h"
+#include "DynamicResolution.h"
+#include "RenderTargetPool.h"
+#include "FrameGraph.h"
+#include "VPLExtractor.h"
+
+using namespace std;
+using namespace arma;
+
+/**
+ * Deferred rendering pipeline: reflective shadow map, G-buffer, SSAO, and lighting passes.
+ * It owns every shader program and render target, and is shared by the windowed application and the headless renderer.
+ */
+class Renderer
+{
+public:
+	// Passes of a frame, in the same order as PASS_NAMES.
+	enum Pass { RSM_PASS, RSM_DEPTH_PASS, SHADOW_MOMENTS_PASS, RSM_MIPS_PASS,
+				GBUFFER_PASS, LINEAR_DEPTH_PASS, SSAO_PASS, SSAO_BLUR_PASS, SSAO_UPSAMPLE_PASS,
+				INDIRECT_PASS, INDIRECT_BLUR_PASS, UPSAMPLE_PASS, TEMPORAL_PASS,
+				LIGHTING_PASS, UPSCALE_PASS, PASS_COUNT };
+	static const char* const PASS_NAMES[PASS_COUNT];
+
+	// Reflective shadow map storage: full precision positions, normals, and flux, or compact formats where positions are
+	// reconstructed from depth, normals are octahedral-encoded (RG16), and flux is stored in 32 bits.
+	enum RSMFormat { RSM_FLOAT32, RSM_RGB10A2, RSM_R11G11B10F, RSM_FORMAT_COUNT };
+	static const char* const RSM_FORMAT_NAMES[RSM_FORMAT_COUNT];
+
+	// How indirect lighting is gathered from the reflective shadow map: 151 samples in a disk around each pixel, cells of
+	// a flux-weighted RSM mip chain, or clusters of virtual point lights extracted on the CPU.
+	enum RSMGather { GATHER_DISK, GATHER_HIERARCHICAL, GATHER_VPL, GATHER_COUNT };
+	static const char* const RSM_GATHER_NAMES[GATHER_COUNT];
+
+	// How direct shadows are filtered: percentage closer soft shadows over the RSM depth, or variance shadow maps, where
+	// blurred and mipmapped depth moments make the blocker estimate and the filter a couple of fetches each.
+	enum ShadowMode { SHADOW_PCSS, SHADOW_VSM, SHADOW_MODE_COUNT };
+	static const char* const SHADOW_MODE_NAMES[SHADOW_MODE_COUNT];
+
+	// How ambient occlusion is generated: 48 random samples in a hemisphere around each pixel (SSAO), or ground truth-based
+	// ambient occlusion (GTAO), which marches a few screen space directions for the horizon and integrates visibility.
+	enum AOMethod { AO_SSAO, AO_GTAO, AO_METHOD_COUNT };
+	static const char* const AO_METHOD_NAMES[AO_METHOD_COUNT];
+
+	// How the SSAO occlusion factor is denoised: the original 5x5 box filter, or a separable Gaussian that merges pairs of
+	// taps into linearly filtered fetches and rejects taps across normal or depth discontinuities.
+	enum SSAOBlur { SSAO_BLUR_BOX, SSAO_BLUR_BILATERAL, SSAO_BLUR_COUNT };
+	static const char* const SSAO_BLUR_NAMES[SSAO_BLUR_COUNT];
+
+private:
+	OpenGL* ogl = nullptr;						// OpenGL helper with geometries, 3D objects, and glyphs.
+	int width = 0;								// Output resolution, which every screen-sized target is allocated for.
+	int height = 0;
+	GLsizei rsmSideLength = 0;					// Reflective shadow map atlas texture size.
+	int rsmResolution = 0;						// Requested RSM texture size; 0 matches the largest render dimension.
+	RSMFormat rsmFormat = RSM_FLOAT32;			// Reflective shadow map storage.
+
+	// Reflective shadow map atlas: every light renders its RSM (and shadow map) into a square tile of the same textures,
+	// in a single pass that draws the scene once per light.  Tiles are sized by the importance of their lights.
+	struct RSMTile
+	{
+		GLint x, y;								// Lower left corner, in texels.
+		GLsizei side;
+	};
+	GLuint rsmFBO = 0;
+	GLuint rsmPosition = 0;						// World space positions (not used by compact formats).
+	GLuint rsmNormal = 0;						// World space normals (octahedral-encoded in compact formats).
+	GLuint rsmFlux = 0;							// Flux (= material's albedo times light color).
+	GLuint rsmDepth = 0;						// Depth (= same used in shadow mapping).
+	vector<RSMTile> rsmTiles;					// By light.
+	vector<double> lightImportances;			// Luminance of every light's color.
+
+	// Shader programs.
+	GLuint renderingProgram = 0;				// Deferred lighting.
+	GLuint generateRSMProgram = 0;				// Reflective shadow maps.
+	GLuint generateGBufferProgram = 0;			// G-buffer.
+	GLuint generateSSAOProgram = 0;				// SSAO occlusion factor.
+	GLuint generateGTAOProgram = 0;				// Horizon-based occlusion factor.
+	GLuint generateLinearDepthProgram = 0;		// Linear view depth mip chain.
+	GLuint blurSSAOProgram = 0;					// SSAO box blur.
+	GLuint blurSSAOBilateralProgram = 0;		// Separable bilateral SSAO blur, specialized for a number of taps.
+	int blurSSAOBilateralTaps = -1;
+	GLuint downsampleSSAOProgram = 0;			// G-buffer depth and normals at the SSAO resolution.
+	GLuint upsampleSSAOProgram = 0;				// Geometry-aware upsampling of low resolution SSAO.
+	GLuint indirectLightingProgram = 0;			// Low resolution RSM indirect lighting.
+	GLuint upsampleIndirectProgram = 0;			// Geometry-aware upsampling of indirect lighting.
+	GLuint blurIndirectProgram = 0;				// Geometry-aware blur of interleaved indirect lighting.
+	GLuint temporalProgram = 0;					// Temporal accumulation of SSAO and indirect lighting.
+	GLuint generateRSMMipsProgram = 0;			// Base level of the hierarchical reflective shadow map.
+	GLuint generateDepthPyramidProgram = 0;		// Min/max depth pyramid of the reflective shadow map.
+	GLuint blurShadowMomentsProgram = 0;		// Separable blur of the variance shadow map moments.
+	GLuint upscaleProgram = 0;					// Catmull-Rom upscaling of the lit scene to the output resolution.
+
+	// Screen-sized targets come from the pool, so that a resize reallocates them lazily, and intermediate results that
+	// only live within one pass (blur intermediates, the lit scene before upscaling) share memory with each other.
+	RenderTargetPool targetPool;
+
+	// Dynamic resolution: screen-sized passes render into the lower left renderWidth x renderHeight texels of their
+	// targets (allocated at the output resolution, so changing the scale reallocates nothing), and the lit scene is
+	// upscaled into the output.  The controller picks the scale from the GPU time of the last measured frame.
+	int renderWidth = 0;						// Render resolution.
+	int renderHeight = 0;
+	bool renderTargetsStale = true;				// Whether texels beyond the rendered region may hold older contents.
+	DynamicResolution dynamicResolution;
+
+	// Min/max depth pyramid of the reflective shadow map (RG32F), from half its resolution down to 1x1.  It bounds the
+	// depths in the soft shadows search and filter regions, so that pixels with no blockers skip the blocker search, and
+	// fully lit or fully shadowed pixels skip filtering.
+	GLuint rsmDepthPyramidFBO = 0;
+	GLuint rsmDepthPyramid = 0;
+	int rsmDepthPyramidLevels = 0;
+
+	// Variance shadow map: depth and squared depth, written by the RSM pass (as its fourth attachment), blurred, and
+	// mipmapped (the horizontal blur goes through a pooled target).  Allocated the first time variance shadows are used.
+	GLuint shadowMomentsFBO = 0;
+	GLuint shadowMoments = 0;					// Moments (RG32F, mipmapped).
+
+	// Hierarchical reflective shadow map: mip chains with average flux and flux-weighted positions and normals.
+	GLuint rsmMipFBO = 0;
+	GLuint rsmMipFlux = 0;						// Flux + flux weight (RGBA16F).
+	GLuint rsmMipPosition = 0;					// Positions premultiplied by the flux weight (RGBA32F).
+	GLuint rsmMipNormal = 0;					// Normals premultiplied by the flux weight (RGBA16F).
+	VPLExtractor vplExtractor;					// Virtual point light clusters from a coarse level of the mip chains.
+
+	// Reflective shadow map cache: the RSM and its mip chains are kept until something that affects light space changes.
+	bool rsmValid = false;						// Whether the RSM textures match the state below.
+	bool rsmMipsValid = false;					// Whether the mip chains were built from the current RSM.
+	bool rsmDepthPyramidValid = false;			// Whether the depth pyramid (for PCSS) was built from the current RSM.
+	bool shadowMomentsValid = false;			// Whether the variance shadow map moments (for VSM) were written with it.
+	vector<Light> rsmLights;					// Light transformations, positions, and colors the RSM was rendered with.
+	mat44 rsmModel;								// Model matrix the RSM was rendered with.
+	unsigned long rsmRenderedFrames = 0;		// Frames that rendered the RSM, and frames that reused it.
+	unsigned long rsmReusedFrames = 0;
+
+	// G-buffer.
+	GLuint gBuffer = 0;
+	GLuint gNormal = 0;							// Octahedral-encoded world space normals (RG16).
+	GLuint gAlbedoSpecular = 0;					// Albedo + shininess and Blinn-Phong flag packed in alpha (RGBA8).
+	GLuint gDepth = 0;							// Depth buffer (32F), from which positions are reconstructed.
+
+	// Linear view depth (R32F), written once per frame from the G-buffer depth for the ambient occlusion, blur, and
+	// upsampling passes, which compare and reconstruct positions from view depths.  With enableDepthMips, a few coarser
+	// levels keep one of every 2x2 depths, so that distant AO samples read from a smaller footprint.
+	GLuint linearDepthFBO = 0;
+	GLuint linearDepthBuffer = 0;
+	int linearDepthLevels = 0;
+
+	// SSAO.
+	GLuint ssaoNoiseTexture = 0;				// Tiled random rotation vectors.
+	GLuint ssaoBlurFactor = 0;					// Blurred occlusion factor (at full resolution).
+	GLuint linearSampler = 0;					// Bilinear filtering for the merged taps of the bilateral blur.
+
+	// Low resolution SSAO: occlusion is generated and blurred at 1/factor of the resolution along each axis, from a
+	// point-sampled copy of the G-buffer depth and normals, and upsampled into ssaoBlurFactor.
+	int ssaoDownsampling = 1;					// Full resolution pixels per SSAO pixel, along each axis.
+	GLuint ssaoInputFBO = 0;
+	GLuint ssaoDepthLowRes = 0;					// Linear depth (R32F).
+	GLuint ssaoNormalLowRes = 0;				// Octahedral-encoded normals (RG16).
+	GLuint ssaoLowResBlur = 0;					// Blurred occlusion factor at low resolution.
+
+	// Low resolution indirect lighting (its targets are transient: see render()).
+	int indirectDownsampling = 1;				// Full resolution pixels per indirect lighting pixel, along each axis.
+	int indirectInterleave = 1;					// Side of the tiles of pixels that split the RSM samples among them.
+
+	// Temporal accumulation: history buffers are ping-ponged between frames.
+	GLuint temporalFBOs[2] = {};
+	GLuint ssaoHistory[2] = {};					// Accumulated SSAO factor + history length.
+	GLuint indirectHistory[2] = {};				// Accumulated indirect lighting + history length.
+	GLuint geometryHistory[2] = {};				// Object space normal + view depth, to detect disocclusions.
+	int historyIndex = 0;						// Which buffers the last frame wrote.
+	bool historyValid = false;					// Whether the last frame accumulated anything.
+	bool historySSAO = false;					// Whether SSAO and RSM were enabled in the last frame.
+	bool historyRSM = false;
+	mat44 previousModelView;					// Previous frame's transformations, for reprojection.
+	mat44 previousProjection;
+	float previousViewportScale[2] = { 1, 1 };	// Rendered fraction of the history targets.
+	vector<vec3> previousLightPositions;		// Indirect lighting history is discarded when a light moves.
+	unsigned int frameIndex = 0;				// Frames rendered so far, to rotate sample subsets.
+
+	// Passes of the frame, declared anew by every render() call, and their GPU timing.
+	FrameGraph frameGraph;
+	GPUTimer passTimers[PASS_COUNT];
+	bool passTimed[PASS_COUNT] = {};			// Whether a pass ran (and was timed) during the last render() call.
+
+	void renderScene( const mat44& Projection, const mat44& View, const mat44& Model );
+	void setGBufferUniforms( GLuint program, const mat44& Projection, const mat44& View, const vector<Light>& lights );
+	void setLightUniforms( GLuint program, const vector<Light>& lights );
+	void allocateScreenTargets();
+	RenderTargetPool::Descriptor indirectLowResDescriptor() const;
+	void allocateSSAOLowRes();
+	void clearRenderTargets();
+	void updateRenderScale();
+	void setViewportScale( GLuint program, int w, int h, int allocatedWidth, int allocatedHeight );
+	void compileSSAOBilateralBlur( int taps );
+	void allocateRSM();
+	void layoutRSMAtlas();
+	void allocateRSMMips();
+	void allocateShadowMoments();
+	void fitSampleCounts();
+
+public:
+	static const vec3 POINT_OF_INTEREST;		// Where both the camera and the lights look at.
+	static const int MAX_LIGHTS = 4;			// Shadow-casting lights with their own tile of the RSM atlas.
+	static const int MAX_TILE_LEVEL = 3;		// Smallest atlas tile: the atlas side over 2^MAX_TILE_LEVEL.
+	static const vec3 DEFAULT_EYE;				// Initial camera position.
+	static const int DEFAULT_INTERLEAVE = 4;	// Interleaved sampling tile side when it's switched on.
+	static const int TEMPORAL_SUBSETS = 4;		// Frames that split the SSAO and RSM samples among them.
+	static const int MAX_SSAO_BLUR_RADIUS = 16;	// Must match MAX_TAPS in blurSSAOBilateral.frag, times 2.
+	static const int MAX_LINEAR_DEPTH_LEVELS = 5;	// Linear depth mip levels, including the base level.
+	static const int RESERVED_UNIFORM_VECTORS = 96;	// Fragment uniform vectors left for everything but the sample sets.
+	static constexpr float BACKGROUND_DEPTH = 1.0e6f;	// Linear depth where nothing was rendered (see linearDepth.glsl).
+
+	bool enableSSAO = true;						// Use screen space ambient occlusion.
+	bool enableRSM = false;						// Use reflective shadow maps for indirect lighting.
+	bool enableTemporal = false;				// Accumulate SSAO and indirect lighting over frames.
+	RSMGather rsmGather = GATHER_DISK;			// Indirect lighting gathering method.
+	bool enableRSMCache = true;					// Reuse the last RSM while the light, Model matrix, and scene don't change.
+	ShadowMode shadowMode = SHADOW_PCSS;		// Direct shadows filtering method.
+	AOMethod aoMethod = AO_SSAO;				// Ambient occlusion method, when SSAO is enabled.
+	SSAOBlur ssaoBlur = SSAO_BLUR_BILATERAL;	// SSAO denoising filter.
+	bool enableDepthMips = false;				// Read farther AO samples from coarser linear depth levels.
+	int ssaoBlurRadius = 4;						// Bilateral blur taps on each side of a pixel, up to MAX_SSAO_BLUR_RADIUS.
+	int rsmSampleCount = 151;					// Sample set sizes, read by init() (which specializes the shaders for them):
+	int pcssSampleCount = 33;					// RSM gathering and PCSS blocker search and filtering Poisson disks, and
+	int ssaoKernelSize = 48;					// SSAO hemisphere kernel.  Sizes beyond the uniform limit are shrunk.
+	int lightCount = 1;							// Shadow-casting lights created by init(), up to MAX_LIGHTS.
+
+	void init( OpenGL* openGL, int w, int h, vector<Light>& lights, int seed = -1 );
+	void render( const mat44& Projection, const mat44& View, const vec3& eye, const mat44& Model, vector<Light>& lights, GLuint targetFBO = 0 );
+	void destroy();
+	void resize( int w, int h );
+	bool hasNewPassTime( Pass pass ) const;
+	double getPassMilliseconds( Pass pass ) const;
+	int getPassFrameLag( Pass pass ) const;
+	GLuint getGBufferNormal() const;
+	GLuint getSSAOBlurFactor() const;
+	void setSSAODownsampling( int factor );
+	int getSSAODownsampling() const;
+	void setIndirectDownsampling( int factor );
+	int getIndirectDownsampling() const;
+	void setIndirectInterleave( int n );
+	int getIndirectInterleave() const;
+	void setRSMFormat( RSMFormat format );
+	RSMFormat getRSMFormat() const;
+	void setRSMResolution( int side );
+	int getRSMResolution() const;
+	int getRSMSideLength() const;
+	GLuint getRSMFlux() const;
+	static RSMGather rsmGatherFromName( const string& name );
+	static ShadowMode shadowModeFromName( const string& name );
+	static AOMethod aoMethodFromName( const string& name );
+	static SSAOBlur ssaoBlurFromName( const string& name );
+	double getVPLMilliseconds() const;
+	void invalidateRSM();
+	unsigned long getRSMRenderedFrames() const;
+	unsigned long getRSMReusedFrames() const;
+	static bool isRSMPass( Pass pass );
+	static size_t getRSMBytesPerTexel( RSMFormat format );
+	static RSMFormat rsmFormatFromName( const string& name );
+	void reportRSMMemory( ostream& os ) const;
+	void reportTargetMemory( ostream& os ) const;
+	void reportFrameGraph( ostream& os ) const;
+	int getWidth() const;
+	int getHeight() const;
+	void setRenderScale( double scale );
+	double getRenderScale() const;
+	int getRenderWidth() const;
+	int getRenderHeight() const;
+	void setFrameBudget( double milliseconds, double minScale = DynamicResolution::DEFAULT_MIN_SCALE );
+	double getFrameBudget() const;
+};
+
+#endif /* Renderer_h */
@@ -0,0 +1,53 @@
+#version 410 core
+
+#include "geometryWeights.glsl"
+#include "gbuffer.glsl"
+
+layout (location = 0) out vec4 TexIndirect;		// Blurred indirect lighting + valid sample flag.
+
+uniform sampler2D sIndirectLowRes;				// Interleaved indirect lighting + valid sample flag.
+uniform sampler2D sLinearDepth;					// Full resolution linear depth.
+
+uniform int downsampling;						// Full resolution pixels per indirect lighting pixel, along each axis.
+uniform int interleave;							// Side of the tile of pixels that split the RSM samples among them.
+uniform ivec2 direction;						// (1, 0) for the horizontal pass, (0, 1) for the vertical one.
+
+/**
+ * One direction of the separable geometry-aware blur that reconstructs interleaved indirect lighting: a box of
+ * interleave taps covers every sample subset once along the blur direction, and taps across normal or depth
+ * discontinuities are rejected.
+ */
+void main()
+{
+	ivec2 p = ivec2( gl_FragCoord.xy );
+	vec4 center = texelFetch( sIndirectLowRes, p, 0 );
+	if( center.a == 0.0 )								// Nothing to reconstruct for pixels without indirect lighting.
+	{
+		TexIndirect = vec4( 0.0 );
+		return;
+	}
+
+	ivec2 size = textureSize( sIndirectLowRes, 0 );
+	ivec2 fullSize = textureSize( sLinearDepth, 0 );
+	ivec2 pFull = min( p * downsampling + downsampling / 2, fullSize - 1 );		// Where the G-buffer was sampled.
+	vec3 n = gBufferNormal( pFull );
+	float z = texelFetch( sLinearDepth, pFull, 0 ).r;
+
+	vec3 sum = vec3( 0.0 );
+	float weightSum = 0.0;
+	for( int k = -interleave / 2; k < interleave - interleave / 2; k++ )
+	{
+		ivec2 q = p + k * direction;
+		if( any( lessThan( q, ivec2( 0 ) ) ) || any( greaterThanEqual( q, size ) ) )
+			continue;
+
+		vec4 s = texelFetch( sIndirectLowRes, q, 0 );
+		ivec2 qFull = min( q * downsampling + downsampling / 2, fullSize - 1 );
+		float w = ( k == 0 )? 1.0 : s.a * geometryWeight( n, z, gBufferNormal( qFull ), texelFetch( sLinearDepth, qFull, 0 ).r );
+
+		sum += w * s.rgb;
+		weightSum += w;
+	}
+
+	TexIndirect = vec4( sum / weightSum, 1.0 );
+}
@@ -0,0 +1,71 @@
+#version 410 core
+
+#include "geometryWeights.glsl"
+#include "linearDepth.glsl"
+#include "octahedral.glsl"
+
+#ifndef TAP_COUNT
+#define TAP_COUNT 2								// Merged taps on each side of the center (the blur radius / 2, rounded up).
+#endif
+
+const int MAX_TAPS = 8;							// Must match Renderer::MAX_SSAO_BLUR_RADIUS / 2.
+
+layout (location = 0) out float TexSSAOFactor;	// Blurred occlusion factor along one direction.
+
+uniform sampler2D sSSAOFactor;					// Occlusion factor (linearly filtered).
+uniform sampler2D sSSAODepth;					// Linear depth and octahedral-encoded normals at the SSAO resolution (linearly
+uniform sampler2D sSSAONormal;					// filtered, except for the center tap, which is fetched exactly).
+
+uniform vec2 direction;							// (1, 0) for the horizontal pass, (0, 1) for the vertical one.
+uniform vec2 taps[MAX_TAPS];					// Merged taps on each side of the center: offset in texels and Gaussian weight.
+
+/**
+ * One direction of the separable bilateral SSAO blur: a Gaussian where each pair of adjacent taps is merged into a single
+ * linearly filtered fetch between them, weighted by their summed Gaussian weights (see Renderer::render()).
+ * Every merged tap is also weighted by its normal and depth similarity with the center, so occlusion doesn't bleed across
+ * geometric discontinuities.  Linear depths are compared against the center's depth extrapolated along the blur direction,
+ * so that surfaces seen at grazing angles are still blurred.  The filtered depth and normal of a pair straddling an edge
+ * fall in between both sides, which lowers its weight in proportion to how much of the pair lies across.  The tap count is
+ * a compile-time constant, so that the loop can be unrolled.
+ */
+void main()
+{
+	ivec2 p = ivec2( gl_FragCoord.xy );
+	float center = texelFetch( sSSAOFactor, p, 0 ).r;
+	float z = texelFetch( sSSAODepth, p, 0 ).r;
+	if( isBackground( z ) )								// Nothing to blur on the background.
+	{
+		TexSSAOFactor = center;
+		return;
+	}
+
+	vec3 n = decodeNormal( texelFetch( sSSAONormal, p, 0 ).rg );
+	ivec2 size = textureSize( sSSAOFactor, 0 );
+	vec2 texelSize = 1.0 / vec2( size );
+	vec2 uv = ( vec2( p ) + 0.5 ) * texelSize;
+
+	// Depth change per texel along the blur direction, from the side that doesn't cross a discontinuity.
+	ivec2 step = ivec2( direction );
+	float zPrevious = texelFetch( sSSAODepth, clamp( p - step, ivec2( 0 ), size - 1 ), 0 ).r;
+	float zNext = texelFetch( sSSAODepth, clamp( p + step, ivec2( 0 ), size - 1 ), 0 ).r;
+	float slope = ( abs( z - zPrevious ) < abs( zNext - z ) )? z - zPrevious : zNext - z;
+
+	float sum = center;
+	float weightSum = 1.0;
+	for( int k = 0; k < TAP_COUNT; k++ )
+	{
+		vec2 offset = taps[k].x * texelSize * direction;
+		for( int side = -1; side <= 1; side += 2 )
+		{
+			vec2 q = uv + float( side ) * offset;
+			float zq = texture( sSSAODepth, q ).r;
+			vec3 nq = decodeNormal( texture( sSSAONormal, q ).rg );
+			float w = taps[k].y * geometryWeight( n, z + float( side ) * taps[k].x * slope, nq, zq );
+
+			sum += w * texture( sSSAOFactor, q ).r;
+			weightSum += w;
+		}
+	}
+
+	TexSSAOFactor = sum / weightSum;
+}
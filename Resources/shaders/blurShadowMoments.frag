@@ -0,0 +1,61 @@
+#version 410 core
+
+#include "lights.glsl"
+
+layout (location = 0) out vec2 TexShadowMoments;	// Blurred depth and squared depth.
+
+in vec2 oTexCoords;
+
+uniform sampler2D sSource;							// Variance shadow map moments (bilinearly filtered).
+uniform vec2 direction;								// One texel along the blur direction, in texture coordinates.
+
+#if LIGHT_COUNT > 1
+/**
+ * Moments of an atlas texel, or those of depth 1 if it lies beyond the tile being blurred, as the atlas border answers
+ * for a single light.
+ * @param texel Atlas texel.
+ * @param first Lower left texel of the tile.
+ * @param last Upper right texel of the tile.
+ * @return Depth and squared depth.
+ */
+vec2 tileMoments( ivec2 texel, ivec2 first, ivec2 last )
+{
+	if( any( lessThan( texel, first ) ) || any( greaterThan( texel, last ) ) )
+		return vec2( 1.0 );
+	return texelFetch( sSource, texel, 0 ).rg;
+}
+#endif
+
+/**
+ * One direction of the separable blur of the variance shadow map moments: a 5-tap binomial kernel (1 4 6 4 1) / 16,
+ * where each pair of outer taps is merged into a single bilinear fetch between them.  With several lights, the taps are
+ * fetched one by one instead, so that they stay within the tile of the light they belong to.
+ */
+void main()
+{
+#if LIGHT_COUNT > 1
+	ivec2 atlasSize = textureSize( sSource, 0 );
+	ivec2 texel = ivec2( gl_FragCoord.xy );
+	ivec2 first = ivec2( 0 ), last = atlasSize - 1;	// Texels that no tile covers are never read.
+	for( int light = 0; light < LIGHT_COUNT; light++ )
+	{
+		ivec2 origin = ivec2( rsmTiles[light].xy * vec2( atlasSize ) + 0.5 );
+		int side = int( rsmTiles[light].z * float( atlasSize.x ) + 0.5 );
+		if( all( greaterThanEqual( texel, origin ) ) && all( lessThan( texel, origin + side ) ) )
+		{
+			first = origin;
+			last = origin + side - 1;
+		}
+	}
+
+	ivec2 step = ivec2( sign( direction ) );
+	TexShadowMoments = ( tileMoments( texel - 2 * step, first, last ) + tileMoments( texel + 2 * step, first, last )
+					   + 4.0 * ( tileMoments( texel - step, first, last ) + tileMoments( texel + step, first, last ) )
+					   + 6.0 * tileMoments( texel, first, last ) ) / 16.0;
+#else
+	const float OFFSET = 1.2;						// ( 4 * 1 + 1 * 2 ) / ( 4 + 1 ) texels.
+	TexShadowMoments = textureLod( sSource, oTexCoords, 0.0 ).rg * ( 6.0 / 16.0 )
+					 + textureLod( sSource, oTexCoords - OFFSET * direction, 0.0 ).rg * ( 5.0 / 16.0 )
+					 + textureLod( sSource, oTexCoords + OFFSET * direction, 0.0 ).rg * ( 5.0 / 16.0 );
+#endif
+}
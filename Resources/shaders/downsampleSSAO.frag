@@ -0,0 +1,20 @@
+#version 410 core
+
+#include "gbuffer.glsl"
+
+layout (location = 0) out float TexDepth;		// Linear depth at the SSAO resolution.
+layout (location = 1) out vec2 TexNormal;		// Octahedral-encoded normal at the SSAO resolution.
+
+uniform sampler2D sLinearDepth;					// Full resolution linear depth.
+uniform int downsampling;						// Full resolution pixels per SSAO pixel, along each axis.
+
+/**
+ * Point-sample the linear depth and the G-buffer normal at the center of every downsampling x downsampling block of pixels, so that
+ * low resolution SSAO reads a smaller buffer, and its upsampling knows where every sample was taken.
+ */
+void main()
+{
+	ivec2 p = min( ivec2( gl_FragCoord.xy ) * downsampling + downsampling / 2, textureSize( sLinearDepth, 0 ) - 1 );
+	TexDepth = texelFetch( sLinearDepth, p, 0 ).r;
+	TexNormal = texelFetch( sGNormal, p, 0 ).rg;
+}
@@ -0,0 +1,88 @@
+// Packed G-buffer decoding, shared by every pass that reads the G-buffer.
+// Layout: octahedral world space normal (RG16), albedo + shading code (RGBA8), and depth (32F).  World positions are
+// reconstructed from depth, and positions in light space are recomputed from them.
+
+#include "octahedral.glsl"
+#include "viewport.glsl"
+#include "lights.glsl"
+
+const float MAX_SHININESS = 128.0;
+
+uniform sampler2D sGNormal;							// Octahedral-encoded normals.
+uniform sampler2D sGAlbedoSpecular;					// RGB albedo + shading code (see generateGBuffer.frag).
+uniform sampler2D sGDepth;							// Depth buffer texture.
+
+uniform mat4 InverseViewProjection;					// Takes normalized device coordinates back into world space.
+
+/**
+ * World space normal at a G-buffer texel.
+ * @param p Texel coordinates.
+ * @return Unit normal.
+ */
+vec3 gBufferNormal( ivec2 p )
+{
+	return decodeNormal( texelFetch( sGNormal, p, 0 ).rg );
+}
+
+/**
+ * World space normal at a screen position.
+ * @param uv Screen coordinates.
+ * @return Unit normal.
+ */
+vec3 gBufferNormal( vec2 uv )
+{
+	return decodeNormal( texture( sGNormal, screenToTexture( uv ) ).rg );
+}
+
+/**
+ * Reconstruct a world space position from its depth.
+ * @param uv Texture (screen) coordinates.
+ * @param depth Depth in [0, 1].
+ * @return World space position.
+ */
+vec3 reconstructPosition( vec2 uv, float depth )
+{
+	vec4 p = InverseViewProjection * vec4( vec3( uv, depth ) * 2.0 - 1.0, 1.0 );
+	return p.xyz / p.w;
+}
+
+/**
+ * World space position at a G-buffer texel.
+ * @param p Texel coordinates.
+ * @return World space position.
+ */
+vec3 gBufferPosition( ivec2 p )
+{
+	return reconstructPosition( ( vec2( p ) + 0.5 ) / ( vec2( textureSize( sGDepth, 0 ) ) * viewportScale ), texelFetch( sGDepth, p, 0 ).r );
+}
+
+/**
+ * World space position at a screen position.
+ * @param uv Screen coordinates.
+ * @return World space position.
+ */
+vec3 gBufferPosition( vec2 uv )
+{
+	return reconstructPosition( uv, texture( sGDepth, screenToTexture( uv ) ).r );
+}
+
+/**
+ * Whether a G-buffer albedo/shading sample uses the Blinn-Phong reflectance model (and has a valid normal).
+ * @param albedo Albedo texture sample.
+ * @return True for Blinn-Phong, false for flat shading.
+ */
+bool usesBlinnPhong( vec4 albedo )
+{
+	return albedo.a > 0.5 / 255.0;
+}
+
+/**
+ * Specular shininess of a G-buffer albedo/shading sample.
+ * @param albedo Albedo texture sample.
+ * @return Shininess, or a negative value if specular reflection is off.
+ */
+float shininessOf( vec4 albedo )
+{
+	float code = round( albedo.a * 255.0 );
+	return ( code <= 1.0 )? -1.0 : ( code - 1.0 ) / 254.0 * MAX_SHININESS;
+}
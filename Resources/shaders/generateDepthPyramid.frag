@@ -0,0 +1,32 @@
+#version 410 core
+
+uniform sampler2D sSource;								// RSM depth, or the previous pyramid level (as the base level).
+uniform bool fromDepth;									// Whether sSource is the RSM depth texture.
+
+layout (location = 0) out vec2 MinMaxDepth;				// Minimum and maximum depth.
+
+/**
+ * One level of the min/max depth pyramid of the reflective shadow map.  Every texel covers 2x2 source texels, and the
+ * last row and column also take the extra source texel of odd sizes, so that a texel j of the RSM is always covered by
+ * texel min( j >> (level + 1), size - 1 ) of any level.
+ */
+void main()
+{
+	ivec2 last = textureSize( sSource, 0 ) - 1;
+	ivec2 first = 2 * ivec2( gl_FragCoord.xy );
+	ivec2 end = min( first + 1 + ivec2( equal( first + 2, last ) ), last );
+
+	vec2 bounds = vec2( 1.0, 0.0 );
+	for( int y = first.y; y <= end.y; y++ )
+	{
+		for( int x = first.x; x <= end.x; x++ )
+		{
+			vec2 depth = texelFetch( sSource, ivec2( x, y ), 0 ).rg;
+			if( fromDepth )
+				depth.g = depth.r;
+			bounds = vec2( min( bounds.x, depth.x ), max( bounds.y, depth.y ) );
+		}
+	}
+
+	MinMaxDepth = bounds;
+}
@@ -1,14 +1,16 @@
 #version 410 core
 
-layout (location = 0) out vec3 TexGPosition;			// Output to attachments for positions and normals in world space.
-layout (location = 1) out vec3 TexGNormal;
-layout (location = 2) out vec4 TexGAlbedoSpecular;		// Output to attachment for albedo and specular (RGB -> diffuse component, A -> shininess component).
-layout (location = 3) out vec4 TexGPosLightSpace;       // Output to attachment for position in projective light space: RGB map to position, A maps to 0 -> flat shading, 1 -> Blinn-Phong reflectance model.
+#include "octahedral.glsl"
+
+layout (location = 0) out vec2 TexGNormal;				// Output to attachment for octahedral-encoded normals in world space.
+layout (location = 1) out vec4 TexGAlbedoSpecular;		// Output to attachment for albedo and shading code (RGB -> diffuse component, A -> see below).
+
+// World space positions are reconstructed from depth, and positions in light space are recomputed from them.
+
+const float MAX_SHININESS = 128.0;
 
-in vec3 oGPosition;
 in vec2 oTexCoords;
 in vec3 oGNormal;
-in vec4 oGPosLightSpace;
 
 uniform vec4 diffuse;									// The [r,g,b,a] object albedo (ambient = 0.1 * diffuse, and specular = [0.8, 0.8, 0.8]).
 uniform float shininess;
@@ -20,23 +22,17 @@ uniform sampler2D objectTexture;						// 3D object texture in case albedo is giv
 
 void main()
 {
-	// Store the fragment position vector in the first G buffer texture.
-	TexGPosition = oGPosition;
-
-	// Store the per-fragment normal into second G buffer texture.
+	// Store the per-fragment normal into the first G buffer texture.
 	// If useBlinnPhong is false, this normal vector is meaningless and won't be used in rendering.
-	TexGNormal = normalize( oGNormal );
-
-	// Store the fragment position in projective light space, now in normalized coordinates [0, 1].
-	vec3 projFrag = oGPosLightSpace.xyz / oGPosLightSpace.w;				// Perspective division: fragment is in [-1, +1].
-	projFrag = projFrag * 0.5 + 0.5;										// Normalize fragment position to [0, 1].
-	TexGPosLightSpace = vec4( projFrag, ( useBlinnPhong )? 1: 0 );			// The Alpha channel will be used to store the useBlinnPhong flag.
+	TexGNormal = encodeNormal( normalize( oGNormal ) );
 
-	// Store [R,G,B,A] = Diffuse RGB color, shininess.
+	// Store [R,G,B,A] = Diffuse RGB color, shading code.  The 8-bit code is 0 for flat shading, 1 for Blinn-Phong without
+	// specular component (negative shininess), and 2 to 255 for Blinn-Phong with shininess in (0, MAX_SHININESS].
 	// Ignore alpha or transparency.
 	vec4 color;
 	color.rgb = ((useTexture)? texture( objectTexture, oTexCoords ).rgb * diffuse.rgb : diffuse.rgb);
-	color.a = shininess;
+	float code = ( !useBlinnPhong )? 0.0 : ( shininess <= 0.0 )? 1.0 : 1.0 + max( 1.0, round( min( shininess, MAX_SHININESS ) / MAX_SHININESS * 254.0 ) );
+	color.a = code / 255.0;
 
 	if( drawPoint )
 	{
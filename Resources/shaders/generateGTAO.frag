@@ -0,0 +1,108 @@
+#version 410 core
+
+#include "gbuffer.glsl"
+#include "linearDepth.glsl"
+
+layout (location = 0) out float TexSSAOFactor;	// Visibility (i.e. the NON occlusion factor), like generateSSAO.frag.
+
+const int DIRECTIONS = 2;				// Screen space slices per pixel (per frame, with temporal accumulation).
+const int STEPS = 4;					// Depth samples on each side of a slice.
+const float RADIUS = 0.5;				// Search radius in world units, as the SSAO hemisphere radius.
+const float FALLOFF_START = 0.6;		// Fraction of the radius where samples begin to fade out of the horizon.
+const float INTENSITY = 2.0;			// Exponent applied to the visibility.
+const float LOG_MAX_OFFSET = 3.0;		// Steps within 2^LOG_MAX_OFFSET pixels read the base linear depth level.
+const float PI = 3.14159265;
+
+in vec2 oTexCoords;
+
+uniform sampler2D sLinearDepth;			// Linear depth at the SSAO resolution (mipmapped if enabled, at full resolution).
+uniform sampler2D sSSAONoiseTexture;	// The 4x4 noise texture: unit vectors that rotate the slices of every pixel.
+
+uniform mat4 View;						// View matrix to take normals from the G-buffer into camera coordinates.
+uniform mat4 Projection;
+
+uniform float frameBufferWidth;			// Effective width and height of framebuffer of OpenGL window.
+uniform float frameBufferHeight;
+
+uniform int firstSample;				// With temporal accumulation, each frame takes slices firstSample,
+uniform int sampleStride;				// firstSample + sampleStride, ... out of DIRECTIONS * sampleStride (0 and 1 otherwise).
+uniform vec2 noiseOffset;				// Per-frame shift of the noise texture tiling, in pixels.
+
+/**
+ * Cosine-weighted visibility of the arc between the projected normal and a horizon, within a slice.
+ * @param h Horizon angle from the view vector.
+ * @param n Projected normal angle from the view vector.
+ * @return Visibility integral.
+ */
+float integrateArc( float h, float n )
+{
+	return 0.25 * ( -cos( 2.0 * h - n ) + cos( n ) + 2.0 * h * sin( n ) );
+}
+
+/**
+ * Ground truth-based ambient occlusion (a horizon-based method): for a few screen space directions, march the depth buffer
+ * on both sides of the pixel to find the highest horizon within the search radius, and integrate the cosine-weighted
+ * visible arc between both horizons analytically around the normal projected onto that slice.  A handful of depth fetches
+ * per direction replace the random hemisphere samples of generateSSAO.frag.
+ */
+void main()
+{
+	ivec2 p = ivec2( gl_FragCoord.xy );
+	float z = texelFetch( sLinearDepth, p, 0 ).r;
+	if( isBackground( z ) )										// Background: no occlusion.
+	{
+		TexSSAOFactor = 1.0;
+		return;
+	}
+
+	vec2 size = vec2( frameBufferWidth, frameBufferHeight );
+	vec3 vPosition = viewPosition( oTexCoords, z, Projection );
+	vec3 vNormal = normalize( mat3( View ) * gBufferNormal( p ) );
+	vec3 viewDir = normalize( -vPosition );
+
+	// Steps along each direction cover the search radius projected on screen, but advance at least a pixel at a time.
+	float radiusPixels = RADIUS * Projection[1][1] * 0.5 * size.y / -vPosition.z;
+	float stepPixels = max( radiusPixels / float( STEPS ), 1.0 );
+	float jitter = fract( 52.9829189 * fract( dot( gl_FragCoord.xy, vec2( 0.06711056, 0.00583715 ) ) ) );	// Interleaved gradient noise.
+	vec2 noise = texture( sSSAONoiseTexture, oTexCoords * size / 4.0 + noiseOffset / 4.0 ).xy;
+	float baseAngle = atan( noise.y, noise.x );
+
+	float visibility = 0.0;
+	for( int i = 0; i < DIRECTIONS; i++ )
+	{
+		float angle = baseAngle + PI * float( i * sampleStride + firstSample ) / float( DIRECTIONS * sampleStride );
+		vec2 direction = vec2( cos( angle ), sin( angle ) );
+
+		// Slice plane through the view vector and the screen direction; angles grow from the view vector towards orthoDir.
+		vec3 sliceDir = vec3( direction, 0.0 );
+		vec3 orthoDir = sliceDir - dot( sliceDir, viewDir ) * viewDir;
+		vec3 axis = normalize( cross( sliceDir, viewDir ) );
+		vec3 projNormal = vNormal - axis * dot( vNormal, axis );
+		float projLength = length( projNormal );
+		float n = sign( dot( projNormal, orthoDir ) ) * acos( clamp( dot( projNormal, viewDir ) / max( projLength, 1e-4 ), -1.0, 1.0 ) );
+
+		// Highest horizon on each side, fading out samples towards the search radius.
+		float horizonCos[2] = float[2]( -1.0, -1.0 );
+		for( int side = 0; side < 2; side++ )
+		{
+			vec2 sideDirection = ( side == 0 )? -direction : direction;
+			for( int j = 0; j < STEPS; j++ )
+			{
+				float offset = max( ( float( j ) + jitter ) * stepPixels, 1.0 );
+				vec2 q = oTexCoords + sideDirection * offset / size;
+				float level = max( floor( log2( offset ) ) - LOG_MAX_OFFSET, 0.0 );
+				vec3 delta = viewPosition( q, textureLod( sLinearDepth, screenToTexture( q ), level ).r, Projection ) - vPosition;
+				float dist = length( delta );
+				float falloff = clamp( ( dist / RADIUS - FALLOFF_START ) / ( 1.0 - FALLOFF_START ), 0.0, 1.0 );
+				horizonCos[side] = max( horizonCos[side], mix( dot( delta, viewDir ) / dist, -1.0, falloff ) );
+			}
+		}
+
+		// Horizons can't go below the hemisphere around the normal.
+		float h0 = n + max( -acos( horizonCos[0] ) - n, -0.5 * PI );
+		float h1 = n + min( acos( horizonCos[1] ) - n, 0.5 * PI );
+		visibility += projLength * ( integrateArc( h0, n ) + integrateArc( h1, n ) );
+	}
+
+	TexSSAOFactor = pow( clamp( visibility / float( DIRECTIONS ), 0.0, 1.0 ), INTENSITY );
+}
@@ -0,0 +1,26 @@
+#version 410 core
+
+#include "linearDepth.glsl"
+
+layout (location = 0) out float TexLinearDepth;	// Positive view space distance.
+
+uniform sampler2D sSource;						// G-buffer depth, or the previous level of the chain (as its only level).
+uniform bool fromDepth;							// Whether sSource is the G-buffer depth texture.
+uniform vec2 depthUnprojection;					// Projection matrix entries (2,2) and (2,3), to linearize depth.
+
+/**
+ * One level of the linear depth mip chain.  The base level linearizes the G-buffer depth; every other level keeps one of
+ * the 2x2 texels below it, alternating with the texel parity (a rotated grid), so that coarse levels hold actual surface
+ * depths instead of averages across discontinuities, without a regular subsampling pattern.
+ */
+void main()
+{
+	ivec2 p = ivec2( gl_FragCoord.xy );
+	if( fromDepth )
+	{
+		float d = texelFetch( sSource, p, 0 ).r;
+		TexLinearDepth = ( d >= 1.0 )? BACKGROUND_DEPTH : depthUnprojection.y / ( 2.0 * d - 1.0 + depthUnprojection.x );
+	}
+	else
+		TexLinearDepth = texelFetch( sSource, min( 2 * p + ivec2( p.y & 1, p.x & 1 ), textureSize( sSource, 0 ) - 1 ), 0 ).r;
+}
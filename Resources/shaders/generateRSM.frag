@@ -1,11 +1,20 @@
 #version 410 core
 
+#include "octahedral.glsl"
+
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 1
+#endif
+
 layout (location = 0) out vec3 TexRSMPosition;			// Output to attachements for positions and normals in world space.
 layout (location = 1) out vec3 TexRSMNormal;
 layout (location = 2) out vec3 TexRSMFlux;				// Output to attachement for flux.
+layout (location = 3) out vec2 TexShadowMoments;		// Depth and squared depth, for variance shadow maps (if attached).
+
+uniform bool compactRSM;								// Compact format: no positions, and octahedral-encoded normals.
 
 // We need almost all variables from normal shading to calculate the flux.
-uniform vec3 lightColor;								// Only RGB.
+uniform vec3 lightColors[LIGHT_COUNT];					// Only RGB.
 uniform vec4 diffuse;									// The [r,g,b,a] material's diffuse color/albedo.
 uniform bool useTexture;
 uniform bool drawPoint;
@@ -13,20 +22,27 @@ uniform bool drawPoint;
 uniform sampler2D objectTexture;						// 3D object texture (must be a blurred texture)
 in vec2 oTexCoords;
 
-in vec3 oRSMPosition;									// Inputs from vertex shader, in world space.
+in vec3 oRSMPosition;									// Inputs from geometry shader, in world space.
 in vec3 oRSMNormal;
+flat in int oLight;										// Light whose tile the fragment belongs to.
 
 void main( void )
 {
-	// Store the fragment position vector in the first RSM buffer texture.
+	// Store the fragment position vector in the first RSM buffer texture (ignored in the compact format, where there's
+	// no such texture, and positions are reconstructed from depth).
 	TexRSMPosition = oRSMPosition;
 
 	// Store the per-fragment normal into second RSM buffer texture.
-	TexRSMNormal = normalize( oRSMNormal );
+	vec3 n = normalize( oRSMNormal );
+	TexRSMNormal = ( compactRSM )? vec3( encodeNormal( n ), 0.0 ) : n;
+
+	// Variance shadow map moments: the squared depth accounts for the depth variation within the texel, too.
+	float dx = dFdx( gl_FragCoord.z ), dy = dFdy( gl_FragCoord.z );
+	TexShadowMoments = vec2( gl_FragCoord.z, gl_FragCoord.z * gl_FragCoord.z + 0.25 * ( dx * dx + dy * dy ) );
 
     // Determining the flux: it's the product of color light with material's albedo (i.e. diffuse component).
     // Ignore alpha or transparency.
-    vec3 color = ((useTexture)? texture( objectTexture, oTexCoords ).rgb : diffuse.rgb) * lightColor;
+    vec3 color = ((useTexture)? texture( objectTexture, oTexCoords ).rgb : diffuse.rgb) * lightColors[oLight];
 
 	if( drawPoint )
 	{
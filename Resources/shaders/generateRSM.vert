@@ -5,23 +5,19 @@ in vec3 aNormal;
 in vec2 aTexCoords;
 
 uniform mat4 Model;										// Model transform takes points from model into world coordinates.
-uniform mat4 LightSpaceMatrix;							// Takes world to light space coordinates (= Proj_light * View_light).
 uniform float pointSize;
 
-out vec2 oTexCoords;									// Interpolate texture coordinates into fragment shader.
+out vec2 vTexCoords;									// Into the geometry shader, which projects every triangle once per light.
 
-out vec3 oRSMPosition;									// Outputs into fragment shader in world space to be stored in RSM buffer.
-out vec3 oRSMNormal;
+out vec4 vRSMPosition;									// World space position and normal, to be stored in the RSM buffers.
+out vec3 vRSMNormal;
 
 void main( void )
 {
 	mat3 normalMatrix = transpose( inverse ( mat3( Model ) ) );
-	vec4 p = Model * vec4( aPosition.xyz, 1.0 );		// Vertex position in world coordinates.
-	gl_Position = LightSpaceMatrix * p;					// Projecting to light space.
-
-	oRSMPosition = p.xyz;								// World space position.
-	oRSMNormal = normalMatrix * aNormal;				// World space normal vector.
+	vRSMPosition = Model * vec4( aPosition.xyz, 1.0 );	// Vertex position in world coordinates.
+	vRSMNormal = normalMatrix * aNormal;				// World space normal vector.
 
 	gl_PointSize = pointSize;
-	oTexCoords = aTexCoords;
+	vTexCoords = aTexCoords;
 }
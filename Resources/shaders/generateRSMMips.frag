@@ -0,0 +1,27 @@
+#version 410 core
+
+#include "rsm.glsl"
+
+layout (location = 0) out vec4 TexMipFlux;				// Flux + flux weight.
+layout (location = 1) out vec4 TexMipPosition;			// Position premultiplied by the flux weight.
+layout (location = 2) out vec4 TexMipNormal;			// Normal premultiplied by the flux weight.
+
+const vec3 LUMINANCE = vec3( 0.2126, 0.7152, 0.0722 );
+
+uniform int light;										// Light whose atlas tile is being drawn.
+
+/**
+ * Base level of the hierarchical reflective shadow map, one atlas tile at a time.  Positions and normals are premultiplied
+ * by the flux luminance, so that plain box-filtered mipmaps hold average flux and flux-weighted positions and normals.
+ */
+void main()
+{
+	vec2 st = ( gl_FragCoord.xy ) / vec2( textureSize( sRSMFlux, 0 ) );
+	vec2 uv = ( st - rsmTiles[light].xy ) / rsmTiles[light].z;		// In the light's space.
+	vec3 flux = texture( sRSMFlux, st ).rgb;
+	float weight = dot( flux, LUMINANCE );
+
+	TexMipFlux = vec4( flux, weight );
+	TexMipPosition = vec4( weight * rsmPosition( uv, light ), 0.0 );
+	TexMipNormal = vec4( weight * rsmNormal( uv, light ), 0.0 );
+}
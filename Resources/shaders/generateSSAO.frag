@@ -2,33 +2,51 @@
 
 layout (location = 0) out float TexSSAOFactor;	// Outputting to a single render attachment, which is the NON occlusion factor.
 
-const int KERNEL_SIZE = 48;
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 48					// Hemisphere samples (see Renderer::ssaoKernelSize).
+#endif
+
 const float HEMISPHERE_RADIUS = 0.5;
 const float BIAS = 0.07;
 const float INTENSITY = 5.0;
+const float LOG_MAX_OFFSET = 3.0;		// Samples within 2^LOG_MAX_OFFSET pixels read the base linear depth level.
 
 in vec2 oTexCoords;
 
-uniform sampler2D sGPosition;
-uniform sampler2D sGNormal;
+#include "gbuffer.glsl"
+#include "linearDepth.glsl"
+
+uniform sampler2D sLinearDepth;			// Linear depth at the SSAO resolution (mipmapped if enabled, at full resolution).
 uniform sampler2D sSSAONoiseTexture;	// The 4x4 noise texture.
 
 uniform vec3 ssaoSamples[KERNEL_SIZE];	// Normal hemisphere samples.
-uniform mat4 View;						// View matrix to take points/normals from G-Buffer into camera coordinates.
+uniform mat4 View;						// View matrix to take normals from G-Buffer into camera coordinates.
 uniform mat4 Projection;
 
 uniform float frameBufferWidth;			// Effective width and height of framebuffer of OpenGL window.
 uniform float frameBufferHeight;
 
+uniform int firstSample;				// With temporal accumulation, each frame takes kernel samples firstSample,
+uniform int sampleStride;				// firstSample + sampleStride, ... (0 and 1 otherwise).
+uniform vec2 noiseOffset;				// Per-frame shift of the noise texture tiling, in pixels.
+
 void main()
 {
-	vec2 noiseScale = vec2( frameBufferWidth/4.0, frameBufferHeight/4.0 );							// Tile noise texture over screen.
+	vec2 size = vec2( frameBufferWidth, frameBufferHeight );
+	vec2 noiseScale = size / 4.0;															// Tile noise texture over screen.
+
+	float z = texelFetch( sLinearDepth, ivec2( gl_FragCoord.xy ), 0 ).r;
+	if( isBackground( z ) )																	// Background: no occlusion.
+	{
+		TexSSAOFactor = 1.0;
+		return;
+	}
 
     // Collect position, normal, and random noise from G-Buffer and noise sampler.
-	vec3 vPosition = ( View * vec4( texture( sGPosition, oTexCoords ).xyz, 1.0 ) ).xyz;				// Position in camera space.
+	vec3 vPosition = viewPosition( oTexCoords, z, Projection );										// Position in camera space.
 
-	vec3 vNormal = normalize( ( View * vec4( texture( sGNormal, oTexCoords ).xyz, 1.0 ) ).xyz );	// Normal in camera space.
-	vec3 randomVector = texture( sSSAONoiseTexture, oTexCoords * noiseScale ).xyz;					// Pick a unit random vector from noise texture in the xy plane.
+	vec3 vNormal = normalize( ( View * vec4( gBufferNormal( oTexCoords ), 1.0 ) ).xyz );			// Normal in camera space.
+	vec3 randomVector = texture( sSSAONoiseTexture, oTexCoords * noiseScale + noiseOffset / 4.0 ).xyz;					// Pick a unit random vector from noise texture in the xy plane.
 
 	// Create a transform matrix that takes points from tangent space to view space (since normal is in camera space already).
 	// Gramm-Schmidt process.
@@ -38,7 +56,8 @@ void main()
 
 	// Iterate over the samples kernel and calculate occlusion factor.
     float occlusion = 0.0;
-	for( int i = 0; i < KERNEL_SIZE; ++i )
+	int count = 0;
+	for( int i = firstSample; i < KERNEL_SIZE; i += sampleStride )
 	{
 		vec3 s = T * ssaoSamples[i]; 					// Pick sample and transform it to view space.
 		s = vPosition + s * HEMISPHERE_RADIUS;			// Place sample around the current fragment.
@@ -49,12 +68,15 @@ void main()
 		offset.xyz /= offset.w; 						// Perspective division.
 		offset.xyz = offset.xyz * 0.5 + 0.5; 			// From [-1, +1] to [0, 1].
 
-		// Get viewing depth stored at the G-buffer gPosition texture at the location given by current sample.
-		float vDepth = ( View * vec4( texture( sGPosition, offset.xy ).xyz, 1.0 ) ).z;
+		// Get viewing depth at the location given by current sample, from coarser levels for farther samples when the linear
+		// depth is mipmapped (the level is ignored otherwise), which keeps the fetches of neighboring pixels close in memory.
+		float level = max( floor( log2( length( ( offset.xy - oTexCoords ) * size ) ) ) - LOG_MAX_OFFSET, 0.0 );
+		float vDepth = -textureLod( sLinearDepth, screenToTexture( offset.xy ), level ).r;
 
 		// Range check and accumulate.
 		float rangeCheck = smoothstep( 0.0, 1.0, HEMISPHERE_RADIUS / abs( vPosition.z - vDepth ) );
 		occlusion += ( vDepth >= s.z + BIAS ? 1.0 : 0.0 ) * rangeCheck;
+		count++;
     }
-	TexSSAOFactor = pow( 1.0 - ( occlusion / KERNEL_SIZE ), INTENSITY );
+	TexSSAOFactor = pow( 1.0 - ( occlusion / max( count, 1 ) ), INTENSITY );
 }
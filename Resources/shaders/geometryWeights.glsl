@@ -0,0 +1,20 @@
+// Geometry-aware weights shared by the SSAO and indirect lighting blur and upsampling passes, over linear depths (see
+// linearDepth.glsl).
+
+const float NORMAL_POWER = 32.0;				// Sharpness of the normal similarity weight.
+const float DEPTH_TOLERANCE = 0.05;				// Relative view depth difference beyond which samples are rejected.
+
+/**
+ * Similarity between the surface at a pixel and the surface at a neighboring sample.
+ * @param n Pixel normal.
+ * @param z Pixel linear depth.
+ * @param nq Sample normal.
+ * @param zq Sample linear depth.
+ * @return Weight in [0, 1]: 0 across normal or depth discontinuities.
+ */
+float geometryWeight( vec3 n, float z, vec3 nq, float zq )
+{
+	float wNormal = pow( max( dot( n, nq ), 0.0 ), NORMAL_POWER );
+	float wDepth = max( 0.0, 1.0 - abs( z - zq ) / ( DEPTH_TOLERANCE * z ) );
+	return wNormal * wDepth;
+}
@@ -0,0 +1,33 @@
+#version 410 core
+
+#include "rsm.glsl"
+#include "gbuffer.glsl"
+
+layout (location = 0) out vec4 TexIndirect;		// RGB indirect lighting + valid sample flag.
+
+uniform int downsampling;						// Full resolution pixels per low resolution pixel, along each axis.
+uniform int interleave;							// Side of the tile of pixels that split the RSM samples among them (1: off).
+uniform int temporalSubsets;					// Consecutive frames that split the RSM samples among them (1: off).
+uniform int frame;								// Frame counter, to rotate sample subsets with temporal accumulation.
+
+/**
+ * Evaluate indirect lighting at a low resolution: every pixel takes the G-buffer sample at the center of the block of
+ * full resolution pixels it covers.  The upsampling pass uses the same sample positions.
+ * With interleaved sampling, each pixel in an interleave x interleave tile gathers a disjoint subset of the RSM samples,
+ * and the blur pass combines the subsets back.  With temporal accumulation, subsets also rotate from frame to frame.
+ */
+void main()
+{
+	ivec2 p = min( ivec2( gl_FragCoord.xy ) * downsampling + downsampling / 2, textureSize( sGDepth, 0 ) - 1 );
+
+	// Only lit geometry with normals receives indirect lighting; other samples are flagged invalid.
+	if( texelFetch( sGDepth, p, 0 ).r >= 1.0 || !usesBlinnPhong( texelFetch( sGAlbedoSpecular, p, 0 ) ) )
+		TexIndirect = vec4( 0.0 );
+	else
+	{
+		ivec2 tile = ivec2( gl_FragCoord.xy ) % interleave;
+		int subset = tile.y * interleave + tile.x + interleave * interleave * ( frame % temporalSubsets );
+		vec3 x = gBufferPosition( p );
+		TexIndirect = vec4( indirectLighting( gBufferNormal( p ), x, subset, interleave * interleave * temporalSubsets ), 1.0 );
+	}
+}
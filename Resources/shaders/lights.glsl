@@ -0,0 +1,54 @@
+// Shadow-casting lights.  Every light renders its reflective shadow map (and shadow map) into its own square tile of a
+// shared atlas, whose side depends on the light's importance (see Renderer::layoutRSMAtlas()).  Lookups take
+// coordinates in the light's projective space, which are mapped into its tile.
+
+#ifndef LIGHTS_GLSL
+#define LIGHTS_GLSL
+
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 1								// Lights in the atlas (see Renderer::lightCount).
+#endif
+
+uniform mat4 LightSpaceMatrices[LIGHT_COUNT];		// Take world space points into every light's projective space.
+uniform mat4 InverseLightSpaceMatrices[LIGHT_COUNT];	// Take the lights' normalized device coordinates back into world space.
+uniform vec3 rsmTiles[LIGHT_COUNT];					// Atlas tiles: lower left corner and side, in atlas texture coordinates.
+
+/**
+ * Position in normalized light projective space, as used to look up the reflective shadow map.
+ * @param x World space position.
+ * @param light Light index.
+ * @return Coordinates in [0, 1]^3.
+ */
+vec3 lightSpacePosition( vec3 x, int light )
+{
+	vec4 p = LightSpaceMatrices[light] * vec4( x, 1.0 );
+	return p.xyz / p.w * 0.5 + 0.5;
+}
+
+/**
+ * Atlas texture coordinates of a position in a light's reflective shadow map.
+ * @param uv Texture coordinates in light space.
+ * @param light Light index.
+ * @return Coordinates within the light's tile.
+ */
+vec2 atlasCoordinates( vec2 uv, int light )
+{
+	return rsmTiles[light].xy + uv * rsmTiles[light].z;
+}
+
+/**
+ * Whether light space coordinates fall beyond the light's tile, where lookups would read a neighboring tile instead of
+ * the atlas border.  A single light takes the whole atlas, whose border already answers them.
+ * @param uv Texture coordinates in light space.
+ * @return True if callers should treat the lookup as beyond the borders of light space.
+ */
+bool beyondTile( vec2 uv )
+{
+#if LIGHT_COUNT > 1
+	return any( lessThan( uv, vec2( 0.0 ) ) ) || any( greaterThanEqual( uv, vec2( 1.0 ) ) );
+#else
+	return false;
+#endif
+}
+
+#endif
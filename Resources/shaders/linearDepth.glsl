@@ -0,0 +1,33 @@
+// Linear view depth buffer (see generateLinearDepth.frag), shared by the ambient occlusion, blur, and upsampling passes:
+// one 32-bit float per pixel holding the positive view space distance, instead of a depth to linearize or a position to
+// reconstruct and transform.
+
+#ifndef LINEAR_DEPTH_GLSL
+#define LINEAR_DEPTH_GLSL
+
+const float BACKGROUND_DEPTH = 1.0e6;			// Stored where nothing was rendered: beyond any far plane.
+
+/**
+ * Whether a linear depth sample belongs to the background.
+ * @param z Linear depth.
+ * @return True if nothing was rendered there.
+ */
+bool isBackground( float z )
+{
+	return z >= BACKGROUND_DEPTH;
+}
+
+/**
+ * Camera space position from its linear depth, with the perspective projection terms instead of an inverse matrix.
+ * @param uv Texture (screen) coordinates.
+ * @param z Linear depth.
+ * @param projection Perspective projection matrix.
+ * @return Position in camera space.
+ */
+vec3 viewPosition( vec2 uv, float z, mat4 projection )
+{
+	vec2 ndc = uv * 2.0 - 1.0;
+	return vec3( z * ( ndc.x + projection[2][0] ) / projection[0][0], z * ( ndc.y + projection[2][1] ) / projection[1][1], -z );
+}
+
+#endif
@@ -0,0 +1,35 @@
+// Octahedral encoding of unit vectors into two [0, 1] components, shared by the G-buffer and the reflective shadow map.
+
+#ifndef OCTAHEDRAL_GLSL
+#define OCTAHEDRAL_GLSL
+
+/**
+ * Octahedral encoding of a unit vector: project it onto the octahedron |x| + |y| + |z| = 1, and fold the lower
+ * hemisphere over the diagonals.
+ * @param n Unit vector.
+ * @return Encoded vector in [0, 1]^2.
+ */
+vec2 encodeNormal( vec3 n )
+{
+	n /= abs( n.x ) + abs( n.y ) + abs( n.z );
+	vec2 e = n.xy;
+	if( n.z < 0.0 )
+		e = ( 1.0 - abs( n.yx ) ) * vec2( ( n.x >= 0.0 )? 1.0 : -1.0, ( n.y >= 0.0 )? 1.0 : -1.0 );
+	return e * 0.5 + 0.5;
+}
+
+/**
+ * Decode an octahedral-encoded unit vector.
+ * @param e Encoded vector in [0, 1]^2.
+ * @return Unit vector.
+ */
+vec3 decodeNormal( vec2 e )
+{
+	e = e * 2.0 - 1.0;
+	vec3 n = vec3( e, 1.0 - abs( e.x ) - abs( e.y ) );
+	if( n.z < 0.0 )									// Lower hemisphere was folded over the diagonals.
+		n.xy = ( 1.0 - abs( n.yx ) ) * vec2( ( n.x >= 0.0 )? 1.0 : -1.0, ( n.y >= 0.0 )? 1.0 : -1.0 );
+	return normalize( n );
+}
+
+#endif
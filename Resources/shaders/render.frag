@@ -1,91 +1,50 @@
 #version 410 core
 
-// Reflective shadow maps constants.
-const uint N_SAMPLES = 151;
-const float R_MAX = 0.09;							// Maximum sampling radius.
-const float RSM_INTENSITY = 0.4;
+#include "rsm.glsl"
+#include "gbuffer.glsl"
 
 // Percentage closer soft shadow constants.
-const uint PCSS_SAMPLES = 33;
+#ifndef PCSS_SAMPLES
+#define PCSS_SAMPLES 33							// Poisson disk samples (see Renderer::pcssSampleCount).
+#endif
 const float NEAR_PLANE = 0.01;
 const float LIGHT_WORLD_SIZE = 2.0;
 const float LIGHT_FRUSTUM_WIDTH = 20.0;
 const float LIGHT_SIZE_UV = (LIGHT_WORLD_SIZE / LIGHT_FRUSTUM_WIDTH);	// Assuming that LIGHT_FRUSTUM_WIDTH = LIGHT_FRUSTUM_HEIGHT.
+const float PYRAMID_EPSILON = 1e-6;				// Depth pyramid slack: fixed-point depths may convert to float differently.
+
+// Shadow filtering methods (see Renderer::ShadowMode) and variance shadow map constants.
+const int SHADOW_PCSS = 0;
+const int SHADOW_VSM = 1;
+const float VSM_MIN_VARIANCE = 1e-6;				// Keeps the Chebyshev bound from failing on flat, lit receivers.
+const float VSM_BLEEDING_REDUCTION = 0.3;		// Bounds below this fraction are treated as fully shadowed.
+const float VSM_BLUR_TEXELS = 3.0;				// Width of the blur that the moments texture has at level 0.
 
 // Screen Space Ambient Occlusion constants.
 const float SSAO_AMBIENT_WEIGHT = 0.3;
 
 // Shader variables.
-uniform vec2 RSMSamplePositions[N_SAMPLES];			// Array of uniformly-distributed sampling positions in a unit disk.
-
-uniform sampler2D sRSMPosition;						// Reflective shadow map textures: positions.
-uniform sampler2D sRSMNormal;						// Normals.
-uniform sampler2D sRSMFlux;							// Flux.
-uniform sampler2D sRSMDepth;						// Depths.
-
-uniform sampler2D sGPosition;						// G-Buffer textures: positions.
-uniform sampler2D sGNormal;							// Normals.
-uniform sampler2D sGAlbedoSpecular;					// Object's RGB albedo + specular shininess.
-uniform sampler2D sGPosLightSpace;					// Fragment position in normalized reflective light space + using Blinn-Phong shading flag.
-uniform sampler2D sGDepth;							// Depth buffer texture.
 
 uniform sampler2D sSSAOFactor;						// SSAO occlusion factor sampler.
+uniform sampler2D sIndirect;						// Upsampled indirect lighting (when computed at a lower resolution).
+uniform sampler2D sRSMDepthPyramid;					// Min/max RSM atlas depth, from half the atlas resolution down to 1x1.
+uniform sampler2D sShadowMoments;					// Blurred and mipmapped depth and squared depth, for variance shadows (atlas).
 
-in vec2 oTexCoords;									// NDC quad texture coordinates.
+in vec2 oTexCoords;									// NDC quad texture (screen) coordinates.
 
-uniform vec4 lightPosition;							// In world space.
-uniform vec3 lightColor;							// Only RGB.
+uniform vec3 lightPositions[LIGHT_COUNT];			// In world space.
+uniform vec3 lightColors[LIGHT_COUNT];				// Only RGB.
 uniform vec3 eyePosition;							// Viewer position in world space.
 
 uniform bool enableSSAO;							// Use or not SSAO.
 uniform bool enableRSM;								// Use or not RSM.
+uniform bool useIndirectTexture;					// Read indirect lighting from sIndirect instead of evaluating it here.
+uniform int shadowMode;								// Percentage closer soft shadows or variance shadow maps.
 
-// Used for searching and filtering the depth/shadow map.
-// Used for searching and filtering the depth/shadow map.
-const vec2 poissonDisk[PCSS_SAMPLES] = vec2[PCSS_SAMPLES](
-	vec2(-0.17232697437460032, -0.5062881718328716), vec2(-0.294162930913042, -0.8107894897875367), vec2(-0.019831996686628273, -0.935165017572383), vec2(0.24271866619042637, -0.5106033293811425),
-	vec2(-0.5395439431143971, -0.7651503978096444), vec2(0.07389515110145806, -0.7012223077921668), vec2(0.08780299948354009, -0.14727029215602516), vec2(0.47655543531189926, -0.4407089253864036),
-	vec2(0.502639069753168, -0.7324190784846516), vec2(-0.5416255049871092, -0.48581401377682243), vec2(0.34139565919314796, -0.19305756133365937), vec2(-0.18275878403669044, -0.14268591370966954),
-	vec2(-0.9842915819814386, -0.03681602905392933), vec2(-0.7399111319357496, -0.2868575213448644), vec2(0.7283424328534942, -0.28861487434709754), vec2(-0.3186284178614639, 0.18467631504722215),
-	vec2(-0.5131076967664215, -0.11779853725441991), vec2(-0.5914496428377283, 0.13717144734270348), vec2(0.775378879856607, 0.11622481346074376), vec2(0.5908709361594684, 0.38952087361743426),
-	vec2(-0.8277838430235871, 0.2119381439781829), vec2(-0.46220197836090016, 0.3932213768459396), vec2(-0.3012476690126118, 0.5996622534406295), vec2(-0.04652760771971687, 0.5935589013065825),
-	vec2(0.7986665781534596, 0.584016274681399), vec2(0.3322325098601957, 0.45927262078368414), vec2(0.15110118164212016, 0.1220800298717366), vec2(-0.6040595292023718, 0.6787992564550387),
-	vec2(0.49039889863745545, 0.017502013993166088), vec2(-0.014882147350587793, 0.32762762866048045), vec2(0.3725777142294926, 0.7107790265580047), vec2(0.07493684595473016, 0.8008472791079064),
-	vec2(-0.20100611752963116, 0.8623389977253264)
-  );
+uniform vec2 PCSSSamplePositions[PCSS_SAMPLES];		// Poisson disk for searching and filtering the depth/shadow map.
 
 out vec4 color;
 
-///////////////////////////////////////// Reflective shadow maps functions /////////////////////////////////////////////
-
-/**
- * Compute indirect lighting from pixels in the surroundings of current fragment.
- * @param uvFrag Current fragment's projected coordinates in light space (texture).
- * @param n Normalized normal vector to current fragment in world space coordinates.
- * @param x Fragment position in world space coordinates.
- */
-vec3 indirectLighting( vec2 uvFrag, vec3 n, vec3 x )
-{
-	vec3 rsmShading = vec3( 0 );
-	for( int i = 0; i < N_SAMPLES; i++ )				// Sum contributions of sampling locations.
-	{
-		vec2 uv = uvFrag + R_MAX * RSMSamplePositions[i];
-		vec3 flux = texture( sRSMFlux, uv ).rgb;		// Collect components from corresponding RSM textures.
-		vec3 x_p = texture( sRSMPosition, uv ).xyz;		// Position (x_p) and normal (n_p) are in world coordinates too.
-		vec3 n_p = texture( sRSMNormal, uv ).xyz;
-
-		// Irradiance at current fragment w.r.t. pixel light at uv.
-		vec3 r = x - x_p;								// Difference vector.
-		float d2 = dot( r, r );							// Square distance.
-		vec3 E_p = flux * ( max( 0.0, dot( n_p, r ) ) * max( 0.0, dot( n, -r ) ) );
-		E_p *= RSMSamplePositions[i].x * RSMSamplePositions[i].x / ( d2 * d2 );				// Weighting contribution and normalizing.
-
-		rsmShading += E_p;								// Accumulate.
-	}
-
-	return rsmShading * RSM_INTENSITY;					// Modulate result with some intensity value.
-}
-
 ///////////////////////////////////// Percentage closer soft shadows functions /////////////////////////////////////////
 
 /**
@@ -99,14 +58,73 @@ float penumbraSize( float zReceiver, float zBlocker )
 	return ( zReceiver - zBlocker ) / zBlocker;			//Parallel plane estimation
 }
 
+/**
+ * Shadow map depth at a position in a light's projected space.
+ * @param uv Position in normalized coordinates [0, 1] with respect to light projected space.
+ * @param light Light index.
+ * @return Depth (1 beyond the borders of the light's tile).
+ */
+float shadowMapDepth( vec2 uv, int light )
+{
+	return beyondTile( uv )? 1.0 : texture( sRSMDepth, atlasCoordinates( uv, light ) ).r;
+}
+
+/**
+ * Conservative depth bounds of the shadow map texels touched by samples in a square around a fragment.  They're read from
+ * the one level of the min/max depth pyramid where the square spans at most 2x2 texels.  Atlas tiles are aligned to
+ * their side, so pyramid texels that straddle two tiles only make the bounds looser.
+ * @param uv Center of the square in normalized coordinates [0, 1] with respect to light projected space.
+ * @param radiusUV Half the side of the square.
+ * @param light Light index.
+ * @return Minimum and maximum depth (samples beyond the shadow map borders have depth 1).
+ */
+vec2 depthBounds( vec2 uv, float radiusUV, int light )
+{
+	ivec2 atlasSize = textureSize( sRSMDepth, 0 );
+	int side = int( rsmTiles[light].z * float( atlasSize.x ) + 0.5 );			// The light's tile, in atlas texels.
+	ivec2 origin = ivec2( rsmTiles[light].xy * vec2( atlasSize ) + 0.5 );
+	vec2 lo = floor( ( uv - radiusUV ) * float( side ) ), hi = floor( ( uv + radiusUV ) * float( side ) );
+	ivec2 first = origin + clamp( ivec2( lo ), ivec2( 0 ), ivec2( side - 1 ) );
+	ivec2 last = origin + clamp( ivec2( hi ), ivec2( 0 ), ivec2( side - 1 ) );
+
+	// Squares up to 2x2 texels read the RSM depth itself; larger ones, the level where 2^(level + 1) texels cover them.
+	int extent = max( last.x - first.x, last.y - first.y ) + 1;
+	vec2 bounds;
+	if( extent <= 2 )
+	{
+		float d0 = texelFetch( sRSMDepth, first, 0 ).r;
+		float d1 = texelFetch( sRSMDepth, ivec2( last.x, first.y ), 0 ).r;
+		float d2 = texelFetch( sRSMDepth, ivec2( first.x, last.y ), 0 ).r;
+		float d3 = texelFetch( sRSMDepth, last, 0 ).r;
+		bounds = vec2( min( min( d0, d1 ), min( d2, d3 ) ), max( max( d0, d1 ), max( d2, d3 ) ) );
+	}
+	else
+	{
+		int level = min( findMSB( extent - 1 ), findMSB( side ) - 1 );
+		ivec2 levelLast = max( atlasSize >> ( level + 1 ), ivec2( 1 ) ) - 1;		// Level sizes as allocated.
+		ivec2 a = min( first >> ( level + 1 ), levelLast ), b = min( last >> ( level + 1 ), levelLast );
+
+		vec2 c0 = texelFetch( sRSMDepthPyramid, a, level ).rg;
+		vec2 c1 = texelFetch( sRSMDepthPyramid, ivec2( b.x, a.y ), level ).rg;
+		vec2 c2 = texelFetch( sRSMDepthPyramid, ivec2( a.x, b.y ), level ).rg;
+		vec2 c3 = texelFetch( sRSMDepthPyramid, b, level ).rg;
+		bounds = vec2( min( min( c0.x, c1.x ), min( c2.x, c3.x ) ), max( max( c0.y, c1.y ), max( c2.y, c3.y ) ) );
+	}
+
+	if( any( lessThan( lo, vec2( 0 ) ) ) || any( greaterThanEqual( hi, vec2( side ) ) ) )
+		bounds.y = 1.0;								// Part of the square is beyond the borders.
+	return bounds;
+}
+
 /**
  * Get the average blocker depth values that are closer to the light than current depth.
  * @param uv Fragment position in normalized coordinates [0, 1].
  * @param zReceiver Depth of current fragment in normalized coordinates [0, 1].
  * @param bias If given, evaluation bias to prevent 'depth' acne.
+ * @param light Light index.
  * @return Average blocker depth or -1 if no blockers were found.
  */
-float findBlockerDepth( vec2 uv, float zReceiver, float bias )
+float findBlockerDepth( vec2 uv, float zReceiver, float bias, int light )
 {
 	// Uses similar triangles to compute what area of the shadow map we should search.
 	float searchWidth = LIGHT_SIZE_UV * ( zReceiver - NEAR_PLANE );
@@ -114,10 +132,10 @@ float findBlockerDepth( vec2 uv, float zReceiver, float bias )
 
 	for( int i = 0; i < PCSS_SAMPLES; i++ )
 	{
-		float shadowMapDepth = texture( sRSMDepth, uv + poissonDisk[i] * searchWidth ).r;
-		if( zReceiver - shadowMapDepth > 0 )				// A blocker? Closer to light.
+		float blockerDepth = shadowMapDepth( uv + PCSSSamplePositions[i] * searchWidth, light );
+		if( zReceiver - blockerDepth > 0 )					// A blocker? Closer to light.
 		{
-			blockerSum += shadowMapDepth;					// Accumulate blockers depth.
+			blockerSum += blockerDepth;						// Accumulate blockers depth.
 			numBlockers++;
 		}
 	}
@@ -131,113 +149,235 @@ float findBlockerDepth( vec2 uv, float zReceiver, float bias )
  * @param zReceiver Fragment's depth value in light projected space.
  * @param filterRadiusUV Sampling radius around the fragment's position in shadow map.
  * @param bias Evaluation bias to prevent shadow acne.
+ * @param light Light index.
  * @return Percentage of shadow to be assigned to fragment.
  */
-float applyPCFilter( vec2 uv, float zReceiver, float filterRadiusUV, float bias )
+float applyPCFilter( vec2 uv, float zReceiver, float filterRadiusUV, float bias, int light )
 {
 	float shadow = 0;
 	for( int i = 0; i < PCSS_SAMPLES; i++ )
 	{
-		vec2 offset = poissonDisk[i] * max( bias/3.0, filterRadiusUV );
-		float pcfDepth = texture( sRSMDepth, uv + offset ).r;
+		vec2 offset = PCSSSamplePositions[i] * max( bias/3.0, filterRadiusUV );
+		float pcfDepth = shadowMapDepth( uv + offset, light );
 		shadow += ( zReceiver - pcfDepth > bias )? 1.0 : 0.0;
 	}
-	return shadow / PCSS_SAMPLES;
+	return shadow / float( PCSS_SAMPLES );
 }
 
 /**
  * Percentage closer soft shadow method.
  * @param projFrag Fragment position in normalized projected light space.
  * @param incidence Dot product of light and normal vectors at fragment to be rendered.
+ * @param light Light index.
  * @return Shadow percentage for fragment (1: Completely in shadow, 0: Completely lit).
  */
-float pcss( vec3 projFrag, float incidence )
+float pcss( vec3 projFrag, float incidence, int light )
 {
 	vec2 uv = projFrag.xy;
 	float zReceiver = projFrag.z;
 
 	if( zReceiver > 1.0 )							// Anything farther than the light frustrum should be lit.
-		return 0;
+		return 0.0;
 
 	float bias = max( 0.004 * ( 1.0 - incidence ), 0.0045 );
 
+	// Step 0: Bound the depths in the search region; nothing closer to the light than the receiver means no blockers.
+	vec2 searchBounds = depthBounds( uv, LIGHT_SIZE_UV * ( zReceiver - NEAR_PLANE ), light );
+	if( searchBounds.x - PYRAMID_EPSILON >= zReceiver )
+		return 0.0;
+
 	// Step 1: Blocker search.
-	float avgBlockerDepth = findBlockerDepth( uv, zReceiver, 0.0 );
+	float avgBlockerDepth = findBlockerDepth( uv, zReceiver, 0.0, light );
 	if( avgBlockerDepth < 0 )						// There are no occluders so early out (this saves filtering).
-		return 0;
+		return 0.0;
 
 	// Step 2: Penumbra size.
 	float penumbraRatio = penumbraSize( zReceiver, avgBlockerDepth );
 	float filterRadiusUV = penumbraRatio * LIGHT_SIZE_UV * NEAR_PLANE / zReceiver;
 
-	// Step 3: Filtering.
-	return applyPCFilter( uv, zReceiver, filterRadiusUV, bias );
+	// Step 3: Filtering, unless every depth in the filter radius passes (or fails) the biased test.
+	float radiusUV = max( bias / 3.0, filterRadiusUV );
+	vec2 filterBounds = depthBounds( uv, radiusUV, light );
+	if( filterBounds.x - PYRAMID_EPSILON >= zReceiver - bias )
+		return 0.0;
+	if( filterBounds.y + PYRAMID_EPSILON < zReceiver - bias )
+		return 1.0;
+	return applyPCFilter( uv, zReceiver, filterRadiusUV, bias, light );
+}
+
+////////////////////////////////////////////// Variance shadow map functions /////////////////////////////////////////////
+
+/**
+ * One-tailed Chebyshev inequality: upper bound of the fraction of depths in a filter region that aren't closer to the
+ * light than the receiver.
+ * @param moments Mean depth and mean squared depth in the filter region.
+ * @param zReceiver Depth of current fragment in normalized coordinates [0, 1].
+ * @return Lit fraction bound in [0, 1].
+ */
+float chebyshevUpperBound( vec2 moments, float zReceiver )
+{
+	if( zReceiver <= moments.x )
+		return 1.0;
+
+	float variance = max( moments.y - moments.x * moments.x, VSM_MIN_VARIANCE );
+	float d = zReceiver - moments.x;
+	return variance / ( variance + d * d );
+}
+
+/**
+ * Filter region moments: one trilinear fetch from the mip level whose texels are as wide as the region.  Atlas tiles
+ * are aligned to their side, so levels up to the one where the light's tile is a single texel don't mix other lights.
+ * @param uv Center of the region in normalized coordinates [0, 1] with respect to light projected space.
+ * @param radiusUV Region radius.
+ * @param light Light index.
+ * @return Mean depth and mean squared depth (those of depth 1 beyond the borders of the light's tile).
+ */
+vec2 shadowMoments( vec2 uv, float radiusUV, int light )
+{
+	if( beyondTile( uv ) )
+		return vec2( 1.0 );
+
+	vec2 atlasSize = vec2( textureSize( sShadowMoments, 0 ) );
+	float side = atlasSize.x * rsmTiles[light].z;								// The light's tile, in atlas texels.
+	float lod = min( log2( max( 2.0 * radiusUV * side / VSM_BLUR_TEXELS, 1.0 ) ), log2( side ) );
+	vec2 st = atlasCoordinates( uv, light );
+#if LIGHT_COUNT > 1
+	// Keep the bilinear footprints of both levels of the fetch inside the tile.
+	vec2 halfTexel = 0.5 * exp2( ceil( lod ) ) / atlasSize;
+	st = clamp( st, rsmTiles[light].xy + halfTexel, rsmTiles[light].xy + rsmTiles[light].z - halfTexel );
+#endif
+	return textureLod( sShadowMoments, st, lod ).rg;
+}
+
+/**
+ * Variance soft shadows: the same three steps as pcss(), but the blocker search and the filter read the mean and variance
+ * of the depths in their regions from the moments mip chain, so each takes a single fetch regardless of its size.
+ * @param projFrag Fragment position in normalized projected light space.
+ * @param incidence Dot product of light and normal vectors at fragment to be rendered.
+ * @param light Light index.
+ * @return Shadow percentage for fragment (1: Completely in shadow, 0: Completely lit).
+ */
+float vsm( vec3 projFrag, float incidence, int light )
+{
+	vec2 uv = projFrag.xy;
+	float zReceiver = projFrag.z;
+
+	if( zReceiver > 1.0 )							// Anything farther than the light frustrum should be lit.
+		return 0.0;
+
+	// Step 1: Blocker estimate.  The region's mean depth mixes blockers with a lit fraction (bounded by Chebyshev) that
+	// is assumed to lie at the receiver's depth.
+	vec2 moments = shadowMoments( uv, LIGHT_SIZE_UV * ( zReceiver - NEAR_PLANE ), light );
+	float litFraction = chebyshevUpperBound( moments, zReceiver );
+	if( litFraction >= 0.99 )						// No blockers to speak of.
+		return 0.0;
+	float avgBlockerDepth = max( ( moments.x - litFraction * zReceiver ) / ( 1.0 - litFraction ), NEAR_PLANE );
+
+	// Step 2: Penumbra size.
+	float penumbraRatio = penumbraSize( zReceiver, avgBlockerDepth );
+	float filterRadiusUV = penumbraRatio * LIGHT_SIZE_UV * NEAR_PLANE / zReceiver;
+
+	// Step 3: Filtering, with light bleeding reduction.  Half the PCSS bias keeps grazing receivers from streaking.
+	float bias = 0.5 * max( 0.004 * ( 1.0 - incidence ), 0.0045 );
+	litFraction = chebyshevUpperBound( shadowMoments( uv, filterRadiusUV, light ), zReceiver - bias );
+	return 1.0 - clamp( ( litFraction - VSM_BLEEDING_REDUCTION ) / ( 1.0 - VSM_BLEEDING_REDUCTION ), 0.0, 1.0 );
 }
 
 ////////////////////////////////////////////////// Shading functions ///////////////////////////////////////////////////
 
+/**
+ * Shadow of a light at a fragment, with the selected filtering method.
+ * @param projFrag Fragment position in normalized projected light space.
+ * @param incidence Dot product of light and normal vectors at fragment to be rendered.
+ * @param light Light index.
+ * @return Shadow percentage for fragment (1: Completely in shadow, 0: Completely lit).
+ */
+float shadowOf( vec3 projFrag, float incidence, int light )
+{
+	return ( shadowMode == SHADOW_VSM )? vsm( projFrag, incidence, light ) : pcss( projFrag, incidence, light );
+}
+
 /**
  * Main function.
  */
 void main( void )
 {
 	// Retrieve data from G-Buffer textures.
-	vec3 diffuseColor = texture( sGAlbedoSpecular, oTexCoords ).rgb;
+	vec2 uv = screenToTexture( oTexCoords );			// Into the rendered region of the G-buffer and screen-sized inputs.
+	vec4 albedo = texture( sGAlbedoSpecular, uv );
+	vec3 diffuseColor = albedo.rgb;
+	float depth = texture( sGDepth, uv ).r;
 	
-	if( texture( sGDepth, oTexCoords ).r < 1.0 )		// Perform calculations for fragments not in the far plane (depth = 1).
+	if( depth < 1.0 )									// Perform calculations for fragments not in the far plane (depth = 1).
 	{
-		diffuseColor *= lightColor;
-		vec3 specularColor = vec3( 0.8, 0.8, 0.8 );
-		float shininess = texture( sGAlbedoSpecular, oTexCoords ).a;
-		vec3 position = texture( sGPosition, oTexCoords ).rgb;
-		vec3 projFrag = texture( sGPosLightSpace, oTexCoords ).rgb;
-		bool useBlinnPhong = texture( sGPosLightSpace, oTexCoords ).a != 0.0;
+		vec3 lightsColor = lightColors[0];				// The ambient term takes every light.
+		for( int light = 1; light < LIGHT_COUNT; light++ )
+			lightsColor += lightColors[light];
+		vec3 albedoColor = diffuseColor;
+		diffuseColor *= lightsColor;
+		float shininess = shininessOf( albedo );
+		vec3 position = reconstructPosition( oTexCoords, depth );
+		bool useBlinnPhong = usesBlinnPhong( albedo );
 		
 		// Retrieve data from the SSAO occlusion sampler if it is enabled.
 		float ambientOcclusion = 0.0;
 		vec3 ambientColor = diffuseColor * 0.1;
 		if( enableSSAO )
 		{
-			ambientOcclusion = texture( sSSAOFactor, oTexCoords ).r;
+			ambientOcclusion = texture( sSSAOFactor, uv ).r;
 			ambientColor = diffuseColor * ambientOcclusion * SSAO_AMBIENT_WEIGHT;
 		}
 		
-		float shadow = 0;												// PCSS shadow result for this fragment.
+		vec3 N = vec3( 0 ), E = vec3( 0 );
+		if( useBlinnPhong )
+		{
+			N = gBufferNormal( oTexCoords );
+			E = normalize( eyePosition - position );					// View direction.
+		}
+		
+		// Indirect lighting gathers from every light's reflective shadow map, and goes with the key light's shadow.
 		vec3 eColor = vec3( 0 );										// Indirect lighting works only when normals are given.
-		if( useBlinnPhong )												// Use Blinn-Phong reflectance model?
+		if( enableRSM && useBlinnPhong )
+			eColor = useIndirectTexture? texture( sIndirect, uv ).rgb : indirectLighting( N, position );
+		
+		// Direct lighting from every light, each with its own shadow.
+		vec3 litColor = vec3( 0 );
+		for( int light = 0; light < LIGHT_COUNT; light++ )
 		{
-			vec3 N = texture( sGNormal, oTexCoords ).rgb;
-			vec3 E = normalize( eyePosition - position );				// View direction.
-			vec3 L = normalize( lightPosition.xyz - position );			// Light direction.
-			vec3 H = normalize( L + E );								// Half vector.
-			float incidence = dot( N, L );
-			
-			// Diffuse component.
-			float cDiff = max( incidence, 0.0 );
-			diffuseColor = cDiff * diffuseColor;
-			
-			// Specular component.
-			if( incidence > 0 && shininess > 0.0 )						// Negative shininess turns off specular component.
+			vec3 projFrag = lightSpacePosition( position, light );
+			vec3 lightDiffuse = albedoColor * lightColors[light];
+			vec3 specularColor = vec3( 0.8, 0.8, 0.8 );
+			float shadow = 0;											// PCSS or VSM shadow result for this fragment.
+			if( useBlinnPhong )											// Use Blinn-Phong reflectance model?
 			{
-				float cSpec = pow( max( dot( N, H ), 0.0 ), shininess );
-				specularColor = cSpec * specularColor;
+				vec3 L = normalize( lightPositions[light] - position );	// Light direction.
+				vec3 H = normalize( L + E );							// Half vector.
+				float incidence = dot( N, L );
+				
+				// Diffuse component.
+				float cDiff = max( incidence, 0.0 );
+				lightDiffuse = cDiff * lightDiffuse;
+				
+				// Specular component.
+				if( incidence > 0 && shininess > 0.0 )					// Negative shininess turns off specular component.
+				{
+					float cSpec = pow( max( dot( N, H ), 0.0 ), shininess );
+					specularColor = cSpec * specularColor;
+				}
+				else
+					specularColor = vec3( 0.0, 0.0, 0.0 );
+				shadow = shadowOf( projFrag, incidence, light );
 			}
 			else
+			{
 				specularColor = vec3( 0.0, 0.0, 0.0 );
-			shadow = pcss( projFrag, incidence );
-			
-			// Calculate indirect lighting using the reflective shadow map.
-			if( enableRSM )
-				eColor = indirectLighting( projFrag.xy, N, position );
-		}
-		else
-		{
-			specularColor = vec3( 0.0, 0.0, 0.0 );
-			shadow = pcss( projFrag, 1 );
+				shadow = shadowOf( projFrag, 1, light );
+			}
+			litColor += ( 1.0 - shadow ) * ( lightDiffuse + specularColor + ( ( light == 0 )? eColor : vec3( 0 ) ) );
 		}
 		
 		// Fragment color.
-		color = vec4( ambientColor + ( 1.0 - shadow ) * ( diffuseColor + specularColor + eColor ) * ( 1.0 - ( enableSSAO ? SSAO_AMBIENT_WEIGHT : 0.0 ) ), 1.0 );
+		color = vec4( ambientColor + litColor * ( 1.0 - ( enableSSAO ? SSAO_AMBIENT_WEIGHT : 0.0 ) ), 1.0 );
 	}
 	else
 		color = vec4( diffuseColor, 1.0 );
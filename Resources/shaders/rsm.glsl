@@ -0,0 +1,241 @@
+// Reflective shadow maps: indirect lighting shared by the lighting pass and the low-resolution indirect lighting passes.
+// Every light's reflective shadow map is a tile of the atlas textures below (see lights.glsl), and indirect lighting
+// sums the contributions of all of them.
+
+#include "octahedral.glsl"
+#include "lights.glsl"
+
+// Reflective shadow maps constants.
+#ifndef N_SAMPLES
+#define N_SAMPLES 151								// Poisson disk samples (see Renderer::rsmSampleCount).
+#endif
+const float R_MAX = 0.09;							// Maximum sampling radius.
+const float RSM_INTENSITY = 0.4;
+const float PI = 3.14159265358979;
+
+// Hierarchical gathering: the R_MAX disk is split into a center disk of radius R_MAX / 2^HRSM_RINGS with
+// HRSM_CENTER_CELLS sectors, and HRSM_RINGS rings that double their radius, each with HRSM_SECTORS sectors.
+const int HRSM_RINGS = 3;
+const int HRSM_CENTER_CELLS = 4;
+const int HRSM_SECTORS = 8;
+const int HRSM_CELLS = HRSM_CENTER_CELLS + HRSM_RINGS * HRSM_SECTORS;
+
+// Gathering methods (see Renderer::RSMGather).
+const int GATHER_DISK = 0;
+const int GATHER_HIERARCHICAL = 1;
+const int GATHER_VPL = 2;
+
+const int MAX_VPL_CLUSTERS = 256;					// Must match VPLExtractor::MAX_CLUSTERS.
+
+uniform vec2 RSMSamplePositions[N_SAMPLES];			// Array of uniformly-distributed sampling positions in a unit disk.
+
+uniform sampler2D sRSMPosition;						// Reflective shadow map atlas textures: positions.
+uniform sampler2D sRSMNormal;						// Normals.
+uniform sampler2D sRSMFlux;							// Flux.
+uniform sampler2D sRSMDepth;						// Depths (same used in shadow mapping).
+
+uniform bool compactRSM;							// Compact format: positions come from depth, and normals are encoded.
+
+uniform int rsmGather;								// Gathering method.
+uniform sampler2D sRSMMipFlux;						// Mip chain: average flux + flux weight (luminance).
+uniform sampler2D sRSMMipPosition;					// Flux-weighted positions (premultiplied by the flux weight).
+uniform sampler2D sRSMMipNormal;					// Flux-weighted normals.
+
+layout (std140) uniform VPLClusters					// Virtual point light clusters extracted on the CPU.
+{
+	vec4 vplPositions[MAX_VPL_CLUSTERS];			// World space position + radius.
+	vec4 vplNormals[MAX_VPL_CLUSTERS];
+	vec4 vplPowers[MAX_VPL_CLUSTERS];				// Flux integrated over the cluster's RSM area (in texture units).
+};
+uniform int vplCount;
+
+/**
+ * World space position stored in a light's reflective shadow map.
+ * @param uv Texture coordinates in light space.
+ * @param light Light index.
+ * @return World space position.
+ */
+vec3 rsmPosition( vec2 uv, int light )
+{
+	vec2 st = atlasCoordinates( uv, light );
+	if( !compactRSM )
+		return texture( sRSMPosition, st ).xyz;
+
+	vec4 p = InverseLightSpaceMatrices[light] * vec4( vec3( uv, texture( sRSMDepth, st ).r ) * 2.0 - 1.0, 1.0 );
+	return p.xyz / p.w;
+}
+
+/**
+ * World space normal stored in a light's reflective shadow map.
+ * @param uv Texture coordinates in light space.
+ * @param light Light index.
+ * @return Unit normal.
+ */
+vec3 rsmNormal( vec2 uv, int light )
+{
+	vec2 st = atlasCoordinates( uv, light );
+	if( !compactRSM )
+		return texture( sRSMNormal, st ).xyz;
+	return decodeNormal( texture( sRSMNormal, st ).rg );
+}
+
+/**
+ * Compute indirect lighting from the cells that partition the R_MAX disk around the current fragment.  Each cell is a
+ * single fetch from the RSM mip level whose texels are about as large as the cell, where flux is averaged and positions
+ * and normals are flux-weighted.  Cells contribute in proportion to their area, so that the result has the same
+ * expected value as the sampled estimator (whose x^2 sample weights average 1/4 over the unit disk).  There are few
+ * enough cells that they aren't split into subsets for interleaved sampling or temporal accumulation.  Cells beyond the
+ * light's tile are empty, as they are beyond the borders of light space.
+ * @param uvFrag Current fragment's projected coordinates in light space (texture).
+ * @param n Normalized normal vector to current fragment in world space coordinates.
+ * @param x Fragment position in world space coordinates.
+ * @param light Light index.
+ */
+vec3 hierarchicalIndirectLighting( vec2 uvFrag, vec3 n, vec3 x, int light )
+{
+	float rsmSize = float( textureSize( sRSMMipFlux, 0 ).x ) * rsmTiles[light].z;	// Texels across the light's tile.
+	float uvToWorld = 2.0 * length( InverseLightSpaceMatrices[light][0].xyz );		// World units per light space texture unit.
+	vec3 rsmShading = vec3( 0 );
+	float area = 0.0;
+	for( int c = 0; c < HRSM_CELLS; c++ )
+	{
+		// Cell bounds in polar coordinates: the center disk, then rings of doubling radii.
+		float r0, r1, sectorAngle, angle;
+		if( c < HRSM_CENTER_CELLS )
+		{
+			r0 = 0.0;
+			r1 = R_MAX / float( 1 << HRSM_RINGS );
+			sectorAngle = 2.0 * PI / float( HRSM_CENTER_CELLS );
+			angle = ( float( c ) + 0.5 ) * sectorAngle;
+		}
+		else
+		{
+			int ring = ( c - HRSM_CENTER_CELLS ) / HRSM_SECTORS;
+			r0 = R_MAX / float( 1 << ( HRSM_RINGS - ring ) );
+			r1 = 2.0 * r0;
+			sectorAngle = 2.0 * PI / float( HRSM_SECTORS );
+			angle = ( float( ( c - HRSM_CENTER_CELLS ) % HRSM_SECTORS ) + 0.5 * float( 1 + ring % 2 ) ) * sectorAngle;	// Stagger rings.
+		}
+
+		float cellArea = 0.5 * ( r1 * r1 - r0 * r0 ) * sectorAngle;
+		float radius = sqrt( 0.5 * ( r0 * r0 + r1 * r1 ) );				// Splits the cell area in halves.
+		vec2 uv = uvFrag + radius * vec2( cos( angle ), sin( angle ) );
+		float lod = log2( max( 1.0, sqrt( cellArea ) * rsmSize ) );
+
+		vec2 st = atlasCoordinates( uv, light );
+		vec4 flux = beyondTile( uv )? vec4( 0.0 ) : textureLod( sRSMMipFlux, st, lod );
+		if( flux.a > 0.0 )
+		{
+			vec3 x_p = textureLod( sRSMMipPosition, st, lod ).xyz / flux.a;
+			vec3 n_p = textureLod( sRSMMipNormal, st, lod ).xyz;
+			float nLength = length( n_p );
+			n_p = ( nLength > 0.0 )? n_p / nLength : n_p;
+
+			vec3 r = x - x_p;
+			float d2 = max( dot( r, r ), cellArea * uvToWorld * uvToWorld );	// An aggregate isn't closer than its own size.
+			vec3 E_p = flux.rgb * ( max( 0.0, dot( n_p, r ) ) * max( 0.0, dot( n, -r ) ) ) / ( d2 * d2 );
+			rsmShading += E_p * cellArea;
+		}
+		area += cellArea;
+	}
+
+	if( area <= 0.0 )
+		return vec3( 0 );
+	return rsmShading * ( RSM_INTENSITY * 0.25 * float( N_SAMPLES ) / area );
+}
+
+/**
+ * Compute indirect lighting from virtual point light clusters, which cover the whole reflective shadow map atlas (every
+ * light at once) rather than the R_MAX disk.  Their power integrates flux over RSM area, which is turned into the
+ * sampled estimator's expected value by dividing by the disk area (and scaling by the 1/4 average of its x^2 weights).
+ * Like the hierarchical cells, clusters aren't split into subsets.
+ * @param n Normalized normal vector to current fragment in world space coordinates.
+ * @param x Fragment position in world space coordinates.
+ */
+vec3 vplIndirectLighting( vec3 n, vec3 x )
+{
+	vec3 rsmShading = vec3( 0 );
+	for( int i = 0; i < vplCount; i++ )
+	{
+		vec3 r = x - vplPositions[i].xyz;
+		float d2 = max( dot( r, r ), vplPositions[i].w * vplPositions[i].w );	// A cluster isn't closer than its own size.
+		rsmShading += vplPowers[i].rgb * ( max( 0.0, dot( vplNormals[i].xyz, r ) ) * max( 0.0, dot( n, -r ) ) ) / ( d2 * d2 );
+	}
+	return rsmShading * ( RSM_INTENSITY * 0.25 * float( N_SAMPLES ) / ( PI * R_MAX * R_MAX ) );
+}
+
+/**
+ * Compute indirect lighting from a subset of pixels in the surroundings of current fragment in a light's reflective
+ * shadow map: samples first, first + stride, first + 2 * stride, and so on.  The result is scaled to estimate the sum
+ * over all samples.  Samples beyond the light's tile count, but contribute nothing, like those beyond the borders of
+ * light space.
+ * @param uvFrag Current fragment's projected coordinates in light space (texture).
+ * @param n Normalized normal vector to current fragment in world space coordinates.
+ * @param x Fragment position in world space coordinates.
+ * @param first Index of the first sample.
+ * @param stride Distance between consecutive sample indices.
+ * @param light Light index.
+ */
+vec3 diskIndirectLighting( vec2 uvFrag, vec3 n, vec3 x, int first, int stride, int light )
+{
+	vec3 rsmShading = vec3( 0 );
+	int count = 0;
+	for( int i = first; i < N_SAMPLES; i += stride )	// Sum contributions of sampling locations.
+	{
+		vec2 uv = uvFrag + R_MAX * RSMSamplePositions[i];
+		count++;
+		if( beyondTile( uv ) )
+			continue;
+
+		vec3 flux = texture( sRSMFlux, atlasCoordinates( uv, light ) ).rgb;	// Collect components from corresponding RSM textures.
+		vec3 x_p = rsmPosition( uv, light );			// Position (x_p) and normal (n_p) are in world coordinates too.
+		vec3 n_p = rsmNormal( uv, light );
+
+		// Irradiance at current fragment w.r.t. pixel light at uv.
+		vec3 r = x - x_p;								// Difference vector.
+		float d2 = dot( r, r );							// Square distance.
+		vec3 E_p = flux * ( max( 0.0, dot( n_p, r ) ) * max( 0.0, dot( n, -r ) ) );
+		E_p *= RSMSamplePositions[i].x * RSMSamplePositions[i].x / ( d2 * d2 );				// Weighting contribution and normalizing.
+
+		rsmShading += E_p;								// Accumulate.
+	}
+
+	if( count == 0 )
+		return vec3( 0 );
+	return rsmShading * ( RSM_INTENSITY * float( N_SAMPLES ) / float( count ) );	// Modulate result with some intensity value.
+}
+
+/**
+ * Compute indirect lighting at a fragment from every light's reflective shadow map, with a subset of the samples of the
+ * disk gathering (see diskIndirectLighting()).
+ * @param n Normalized normal vector to current fragment in world space coordinates.
+ * @param x Fragment position in world space coordinates.
+ * @param first Index of the first sample.
+ * @param stride Distance between consecutive sample indices.
+ */
+vec3 indirectLighting( vec3 n, vec3 x, int first, int stride )
+{
+	if( rsmGather == GATHER_VPL )
+		return vplIndirectLighting( n, x );
+
+	vec3 rsmShading = vec3( 0 );
+	for( int light = 0; light < LIGHT_COUNT; light++ )
+	{
+		vec2 uvFrag = lightSpacePosition( x, light ).xy;
+		if( rsmGather == GATHER_HIERARCHICAL )
+			rsmShading += hierarchicalIndirectLighting( uvFrag, n, x, light );
+		else
+			rsmShading += diskIndirectLighting( uvFrag, n, x, first, stride, light );
+	}
+	return rsmShading;
+}
+
+/**
+ * Compute indirect lighting at a fragment from every light's reflective shadow map.
+ * @param n Normalized normal vector to current fragment in world space coordinates.
+ * @param x Fragment position in world space coordinates.
+ */
+vec3 indirectLighting( vec3 n, vec3 x )
+{
+	return indirectLighting( n, x, 0, 1 );
+}
@@ -0,0 +1,73 @@
+#version 410 core
+
+layout (location = 0) out vec4 TexSSAOHistory;		// Accumulated SSAO factor in R, history length in A.
+layout (location = 1) out vec4 TexIndirectHistory;	// Accumulated indirect lighting in RGB, history length in A.
+layout (location = 2) out vec4 TexGeometryHistory;	// Object space normal in RGB, view depth in A, to validate history next frame.
+
+#include "gbuffer.glsl"
+
+in vec2 oTexCoords;
+
+uniform sampler2D sSSAOFactor;						// Current frame's (blurred) SSAO factor.
+uniform sampler2D sIndirect;						// Current frame's (upsampled) indirect lighting.
+uniform sampler2D sSSAOHistory;						// Previous frame's outputs.
+uniform sampler2D sIndirectHistory;
+uniform sampler2D sGeometryHistory;
+
+uniform mat4 InverseModel;							// Takes G-buffer positions and normals into object space.
+uniform mat4 View;									// Current view matrix.
+uniform mat4 PreviousModelView;						// Previous frame's Model and View matrices, from object space.
+uniform mat4 PreviousProjection;
+uniform vec2 previousViewportScale;					// Rendered fraction of the history targets, in the previous frame.
+uniform bool resetSSAO;								// Discard history (e.g. first frame, or SSAO was just switched on).
+uniform bool resetIndirect;							// Discard history (e.g. the light moved).
+
+const float MAX_HISTORY = 16.0;						// Frames after which the running average becomes exponential.
+const float DEPTH_TOLERANCE = 0.02;					// Relative view depth difference that reveals a disocclusion.
+const float MIN_NORMAL_COSINE = 0.9;				// Normals must not differ by more than about 25 degrees.
+
+/**
+ * Blend the current frame's SSAO factor and indirect lighting into their history, reprojected to where the surface was
+ * in the previous frame.  History is rejected when the previous frame saw a different surface there (disocclusion).
+ */
+void main()
+{
+	vec2 uv = screenToTexture( oTexCoords );
+	if( texture( sGDepth, uv ).r >= 1.0 )			// Nothing to accumulate in the far plane.
+	{
+		TexSSAOHistory = vec4( 1.0, 0.0, 0.0, 0.0 );
+		TexIndirectHistory = vec4( 0.0 );
+		TexGeometryHistory = vec4( 0.0 );
+		return;
+	}
+
+	vec3 worldPosition = gBufferPosition( oTexCoords );
+	vec4 position = InverseModel * vec4( worldPosition, 1.0 );							// Object space.
+	vec3 normal = normalize( mat3( InverseModel ) * gBufferNormal( oTexCoords ) );
+	float depth = -( View * vec4( worldPosition, 1.0 ) ).z;
+
+	// Where was this surface point in the previous frame, and what did the previous frame see there?
+	vec4 previousView = PreviousModelView * position;
+	vec4 previousClip = PreviousProjection * previousView;
+	vec2 previousUV = previousClip.xy / previousClip.w * 0.5 + 0.5;
+	bool valid = all( greaterThanEqual( previousUV, vec2( 0.0 ) ) ) && all( lessThan( previousUV, vec2( 1.0 ) ) );
+	previousUV *= previousViewportScale;
+	if( valid )
+	{
+		vec4 previousGeometry = texelFetch( sGeometryHistory, ivec2( previousUV * vec2( textureSize( sGeometryHistory, 0 ) ) ), 0 );
+		valid = previousGeometry.a > 0.0
+				&& abs( previousGeometry.a + previousView.z ) < DEPTH_TOLERANCE * previousGeometry.a
+				&& dot( previousGeometry.rgb, normal ) > MIN_NORMAL_COSINE;
+	}
+
+	// Exponential moving average that starts as a plain average while history builds up.
+	vec4 ssaoHistory = ( valid && !resetSSAO )? texture( sSSAOHistory, previousUV ) : vec4( 0.0 );
+	float ssaoLength = min( ssaoHistory.a + 1.0, MAX_HISTORY );
+	TexSSAOHistory = vec4( mix( ssaoHistory.r, texture( sSSAOFactor, uv ).r, 1.0 / ssaoLength ), 0.0, 0.0, ssaoLength );
+
+	vec4 indirectHistory = ( valid && !resetIndirect )? texture( sIndirectHistory, previousUV ) : vec4( 0.0 );
+	float indirectLength = min( indirectHistory.a + 1.0, MAX_HISTORY );
+	TexIndirectHistory = vec4( mix( indirectHistory.rgb, texture( sIndirect, uv ).rgb, 1.0 / indirectLength ), indirectLength );
+
+	TexGeometryHistory = vec4( normal, depth );
+}
@@ -0,0 +1,67 @@
+#version 410 core
+
+#include "rsm.glsl"
+#include "geometryWeights.glsl"
+#include "linearDepth.glsl"
+#include "gbuffer.glsl"
+
+layout (location = 0) out vec3 TexIndirect;		// Full resolution indirect lighting.
+
+uniform sampler2D sIndirectLowRes;				// Low resolution indirect lighting + valid sample flag.
+uniform sampler2D sLinearDepth;					// Full resolution linear depth.
+
+uniform int downsampling;						// Full resolution pixels per low resolution pixel, along each axis.
+
+const float BILINEAR_FLOOR = 0.01;				// Lets any geometrically similar neighbor contribute.
+const float MIN_WEIGHT = 0.001;					// Below this total weight interpolation fails.
+
+/**
+ * Joint bilateral upsampling of indirect lighting: the four nearest low resolution samples are weighted by bilinear
+ * distance and by their normal and depth similarity with the current pixel.  If every neighbor lies across a geometric
+ * discontinuity, indirect lighting is evaluated at full resolution for this pixel.
+ */
+void main()
+{
+	ivec2 p = ivec2( gl_FragCoord.xy );
+	float z = texelFetch( sLinearDepth, p, 0 ).r;
+	if( isBackground( z ) || !usesBlinnPhong( texelFetch( sGAlbedoSpecular, p, 0 ) ) )	// No indirect lighting without normals.
+	{
+		TexIndirect = vec3( 0.0 );
+		return;
+	}
+
+	vec3 n = gBufferNormal( p );
+
+	ivec2 lowSize = textureSize( sIndirectLowRes, 0 );
+	ivec2 fullSize = textureSize( sLinearDepth, 0 );
+	vec2 lowCoord = ( vec2( p ) + 0.5 ) / float( downsampling ) - 0.5;
+	ivec2 base = ivec2( floor( lowCoord ) );
+	vec2 f = lowCoord - vec2( base );
+
+	vec3 sum = vec3( 0.0 );
+	float weightSum = 0.0;
+	for( int j = 0; j <= 1; j++ )
+	{
+		for( int i = 0; i <= 1; i++ )
+		{
+			ivec2 q = clamp( base + ivec2( i, j ), ivec2( 0 ), lowSize - 1 );
+			vec4 s = texelFetch( sIndirectLowRes, q, 0 );
+			ivec2 qFull = min( q * downsampling + downsampling / 2, fullSize - 1 );		// Where the low resolution sample was taken.
+
+			float wBilinear = ( ( i == 0 )? 1.0 - f.x : f.x ) * ( ( j == 0 )? 1.0 - f.y : f.y ) + BILINEAR_FLOOR;
+			float wGeometry = geometryWeight( n, z, gBufferNormal( qFull ), texelFetch( sLinearDepth, qFull, 0 ).r );
+			float w = wBilinear * wGeometry * s.a;
+
+			sum += w * s.rgb;
+			weightSum += w;
+		}
+	}
+
+	if( weightSum > MIN_WEIGHT )
+		TexIndirect = sum / weightSum;
+	else
+	{
+		vec3 x = gBufferPosition( p );
+		TexIndirect = indirectLighting( n, x );
+	}
+}
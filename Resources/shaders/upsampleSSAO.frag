@@ -0,0 +1,63 @@
+#version 410 core
+
+#include "geometryWeights.glsl"
+#include "linearDepth.glsl"
+#include "gbuffer.glsl"
+
+layout (location = 0) out float TexSSAOFactor;	// Full resolution (blurred) occlusion factor.
+
+uniform sampler2D sSSAOLowRes;					// Blurred low resolution occlusion factor.
+uniform sampler2D sSSAODepthLowRes;				// Linear depth and octahedral-encoded normal where every low resolution
+uniform sampler2D sSSAONormalLowRes;			// sample was taken.
+uniform sampler2D sLinearDepth;					// Full resolution linear depth.
+
+uniform int downsampling;						// Full resolution pixels per low resolution pixel, along each axis.
+
+const float BILINEAR_FLOOR = 0.01;				// Lets any geometrically similar neighbor contribute.
+const float MIN_WEIGHT = 0.001;					// Below this total weight interpolation fails.
+
+/**
+ * Joint bilateral upsampling of SSAO: the four nearest low resolution samples are weighted by bilinear distance and by
+ * their normal and depth similarity with the current pixel.  If every neighbor lies across a geometric discontinuity,
+ * the plain bilinear interpolation is kept, since occlusion varies slowly anyway.
+ */
+void main()
+{
+	ivec2 p = ivec2( gl_FragCoord.xy );
+	float z = texelFetch( sLinearDepth, p, 0 ).r;
+	if( isBackground( z ) )								// Background: no occlusion.
+	{
+		TexSSAOFactor = 1.0;
+		return;
+	}
+
+	vec3 n = gBufferNormal( p );
+
+	ivec2 lowSize = textureSize( sSSAOLowRes, 0 );
+	vec2 lowCoord = ( vec2( p ) + 0.5 ) / float( downsampling ) - 0.5;
+	ivec2 base = ivec2( floor( lowCoord ) );
+	vec2 f = lowCoord - vec2( base );
+
+	float sum = 0.0, weightSum = 0.0;
+	float bilinearSum = 0.0, bilinearWeightSum = 0.0;
+	for( int j = 0; j <= 1; j++ )
+	{
+		for( int i = 0; i <= 1; i++ )
+		{
+			ivec2 q = clamp( base + ivec2( i, j ), ivec2( 0 ), lowSize - 1 );
+			float s = texelFetch( sSSAOLowRes, q, 0 ).r;
+			vec3 nq = decodeNormal( texelFetch( sSSAONormalLowRes, q, 0 ).rg );
+			float zq = texelFetch( sSSAODepthLowRes, q, 0 ).r;
+
+			float wBilinear = ( ( i == 0 )? 1.0 - f.x : f.x ) * ( ( j == 0 )? 1.0 - f.y : f.y ) + BILINEAR_FLOOR;
+			float w = wBilinear * geometryWeight( n, z, nq, zq );
+
+			sum += w * s;
+			weightSum += w;
+			bilinearSum += wBilinear * s;
+			bilinearWeightSum += wBilinear;
+		}
+	}
+
+	TexSSAOFactor = ( weightSum > MIN_WEIGHT )? sum / weightSum : bilinearSum / bilinearWeightSum;
+}
@@ -0,0 +1,42 @@
+#version 410 core
+
+layout (location = 0) out vec4 color;
+
+#include "viewport.glsl"
+
+in vec2 oTexCoords;
+
+uniform sampler2D sScene;							// Lit scene, in the lower left corner (see viewportScale).
+
+/**
+ * Upscale the lit scene from the render resolution to the output resolution with a Catmull-Rom filter.  The 4x4 texel
+ * footprint takes 9 bilinear fetches: along each axis, the two middle taps have weights of the same sign, so they're
+ * merged into a single fetch at their weighted mean offset.  Fetches are kept within the rendered region.
+ */
+void main()
+{
+	vec2 size = vec2( textureSize( sScene, 0 ) );
+	vec2 region = size * viewportScale;				// Rendered texels.
+	vec2 position = oTexCoords * region;
+	vec2 center = floor( position - 0.5 ) + 0.5;	// Texel center below and to the left of the position.
+	vec2 f = position - center;
+
+	vec2 w0 = f * ( -0.5 + f * ( 1.0 - 0.5 * f ) );
+	vec2 w1 = 1.0 + f * f * ( -2.5 + 1.5 * f );
+	vec2 w2 = f * ( 0.5 + f * ( 2.0 - 1.5 * f ) );
+	vec2 w3 = f * f * ( -0.5 + 0.5 * f );
+	vec2 w12 = w1 + w2;
+
+	vec2 t[3] = vec2[3]( center - 1.0, center + w2 / w12, center + 2.0 );
+	vec2 w[3] = vec2[3]( w0, w12, w3 );
+	vec3 sum = vec3( 0.0 );
+	for( int j = 0; j < 3; j++ )
+	{
+		for( int i = 0; i < 3; i++ )
+		{
+			vec2 q = clamp( vec2( t[i].x, t[j].y ), vec2( 0.5 ), region - 0.5 ) / size;
+			sum += textureLod( sScene, q, 0.0 ).rgb * ( w[i].x * w[j].y );
+		}
+	}
+	color = vec4( clamp( sum, 0.0, 1.0 ), 1.0 );	// Negative lobes may overshoot.
+}
@@ -0,0 +1,20 @@
+// Dynamic resolution (see Renderer::setRenderScale()): screen-sized passes render into the lower left corner of targets
+// allocated at the full output resolution.  Screen coordinates in [0, 1] span that corner, so they're scaled into texture
+// coordinates to read those targets.  Texels beyond the corner hold the background (see Renderer::clearRenderTargets()).
+
+#ifndef VIEWPORT_GLSL
+#define VIEWPORT_GLSL
+
+uniform vec2 viewportScale;						// Rendered fraction of the targets read by a pass, along each axis.
+
+/**
+ * Texture coordinates of a screen position, in the targets rendered by the current frame.
+ * @param uv Screen coordinates.
+ * @return Texture coordinates.
+ */
+vec2 screenToTexture( vec2 uv )
+{
+	return uv * viewportScale;
+}
+
+#endif
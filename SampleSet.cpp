@@ -0,0 +1,261 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "Configuration.h"
+#include "SampleSet.h"
+#include "Sampling.h"
+
+const char SampleSet::MAGIC[4] = { 'R', 'S', 'M', 'S' };
+const char* const SampleSet::KIND_NAMES[KIND_COUNT] = { "disk", "hemisphere", "sphere" };
+const int SampleSet::DIMENSIONS[KIND_COUNT] = { 2, 3, 3 };
+
+/**
+ * Whether the host stores words with their least significant byte first, as sample set files do.
+ * @return True on little-endian hosts.
+ */
+bool SampleSet::isLittleEndian()
+{
+	const uint32_t one = 1;
+	return *reinterpret_cast<const unsigned char*>( &one ) == 1;
+}
+
+/**
+ * Reverse the byte order of a 32-bit word, to convert it between the file and a big-endian host.
+ * @param word Integer or float bits.
+ * @return Word with its bytes reversed.
+ */
+uint32_t SampleSet::swapBytes( uint32_t word )
+{
+	return ( word >> 24 ) | ( ( word >> 8 ) & 0xFF00u ) | ( ( word << 8 ) & 0xFF0000u ) | ( word << 24 );
+}
+
+/**
+ * Create an empty sample set.
+ */
+SampleSet::SampleSet(): samples( nullptr ), count( 0 ), dimension( 0 ), mapping( nullptr ), mappingBytes( 0 )
+{}
+
+/**
+ * Unmap the file, if any.
+ */
+SampleSet::~SampleSet()
+{
+	close();
+}
+
+/**
+ * Map a sample set file and validate its header against its size.
+ * @param filename Full path of the file.
+ * @return True if the set is ready, false if the file is missing or malformed (which is reported, except for missing).
+ */
+bool SampleSet::open( const string& filename )
+{
+	close();
+
+	const char* bytes = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	ifstream file( filename, ios::binary | ios::ate );
+	if( !file )
+		return false;
+	size = static_cast<size_t>( file.tellg() );
+	buffer.resize( ( size + sizeof( float ) - 1 ) / sizeof( float ) );
+	file.seekg( 0 );
+	if( !file.read( reinterpret_cast<char*>( buffer.data() ), size ) )
+	{
+		cerr << "[SampleSet] Unable to read " << filename << endl;
+		close();
+		return false;
+	}
+	bytes = reinterpret_cast<const char*>( buffer.data() );
+#else
+	int fd = ::open( filename.c_str(), O_RDONLY );
+	if( fd < 0 )
+		return false;
+	struct stat info;
+	if( fstat( fd, &info ) == 0 && info.st_size > 0 )
+	{
+		size = static_cast<size_t>( info.st_size );
+		void* address = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if( address != MAP_FAILED )
+		{
+			mapping = address;
+			mappingBytes = size;
+		}
+	}
+	::close( fd );										// The mapping stays valid.
+	if( !mapping )
+	{
+		cerr << "[SampleSet] Unable to map " << filename << endl;
+		return false;
+	}
+	bytes = static_cast<const char*>( mapping );
+#endif
+
+	uint32_t header[4];
+	if( size >= HEADER_BYTES )
+		memcpy( header, bytes, HEADER_BYTES );
+	if( !isLittleEndian() )
+		for( int i = 1; i < 4; i++ )					// The magic number is compared byte by byte.
+			header[i] = swapBytes( header[i] );
+	if( size < HEADER_BYTES || memcmp( header, MAGIC, sizeof( MAGIC ) ) != 0 || header[1] != VERSION
+		|| header[2] == 0 || size != HEADER_BYTES + static_cast<size_t>( header[2] ) * header[3] * sizeof( float ) )
+	{
+		cerr << "[SampleSet] " << filename << " is not a version " << VERSION << " sample set" << endl;
+		close();
+		return false;
+	}
+
+	dimension = static_cast<int>( header[2] );
+	count = static_cast<int>( header[3] );
+	samples = reinterpret_cast<const float*>( bytes + HEADER_BYTES );		// Page-aligned mapping, so aligned floats.
+	if( !isLittleEndian() )
+	{
+		vector<float> swapped( static_cast<size_t>( dimension ) * count );
+		for( size_t i = 0; i < swapped.size(); i++ )
+		{
+			uint32_t word;
+			memcpy( &word, samples + i, sizeof( word ) );
+			word = swapBytes( word );
+			memcpy( &swapped[i], &word, sizeof( word ) );
+		}
+		buffer.swap( swapped );							// Drops the file contents read on Windows, if any.
+		samples = buffer.data();
+	}
+	return true;
+}
+
+/**
+ * Release the set.
+ */
+void SampleSet::close()
+{
+#ifndef _WIN32
+	if( mapping )
+		munmap( mapping, mappingBytes );
+#endif
+	mapping = nullptr;
+	mappingBytes = 0;
+	buffer.clear();
+	samples = nullptr;
+	count = 0;
+	dimension = 0;
+}
+
+/**
+ * @return Interleaved coordinates of the samples (valid until the set is closed).
+ */
+const float* SampleSet::data() const
+{
+	return samples;
+}
+
+/**
+ * @return Number of samples.
+ */
+int SampleSet::getCount() const
+{
+	return count;
+}
+
+/**
+ * @return Coordinates per sample.
+ */
+int SampleSet::getDimension() const
+{
+	return dimension;
+}
+
+/**
+ * Write a sample set file.
+ * @param filename Full path of the file.
+ * @param dimension Coordinates per sample.
+ * @param samples Interleaved coordinates.
+ * @return True if the file was written, false otherwise.
+ */
+bool SampleSet::save( const string& filename, int dimension, const vector<float>& samples )
+{
+	if( dimension <= 0 || samples.size() % dimension != 0 )
+		return false;
+
+	uint32_t header[4];
+	memcpy( header, MAGIC, sizeof( MAGIC ) );
+	header[1] = VERSION;
+	header[2] = static_cast<uint32_t>( dimension );
+	header[3] = static_cast<uint32_t>( samples.size() / dimension );
+	vector<uint32_t> words( samples.size() );
+	memcpy( words.data(), samples.data(), samples.size() * sizeof( float ) );
+	if( !isLittleEndian() )
+	{
+		for( int i = 1; i < 4; i++ )
+			header[i] = swapBytes( header[i] );
+		for( uint32_t& word : words )
+			word = swapBytes( word );
+	}
+
+	ofstream file( filename, ios::binary );
+	file.write( reinterpret_cast<const char*>( header ), HEADER_BYTES );
+	file.write( reinterpret_cast<const char*>( words.data() ), words.size() * sizeof( uint32_t ) );
+	if( !file )
+	{
+		cerr << "[SampleSet] Unable to write " << filename << endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @param kind Sample set kind.
+ * @param count Number of samples.
+ * @return File name of a set within the library folder (e.g. "disk151.bin").
+ */
+string SampleSet::filename( Kind kind, int count )
+{
+	return string( KIND_NAMES[kind] ) + to_string( count ) + ".bin";
+}
+
+/**
+ * Generate a sample set (see Sampling).
+ * @param kind Unit disk samples, or cosine-weighted hemisphere or uniform sphere directions.
+ * @param count Number of samples.
+ * @param seed Random seed.
+ * @return Interleaved coordinates.
+ */
+vector<float> SampleSet::generate( Kind kind, int count, unsigned seed )
+{
+	switch( kind )
+	{
+		case HEMISPHERE: return Sampling::hemisphere( count, seed );
+		case SPHERE: return Sampling::sphere( count, seed );
+		default: return Sampling::poissonDisk( count, seed );
+	}
+}
+
+/**
+ * Read a sample set from the library if it's there for the default seed, or generate it otherwise.
+ * @param kind Unit disk samples, or cosine-weighted hemisphere or uniform sphere directions.
+ * @param count Number of samples.
+ * @param seed Random seed.
+ * @return Interleaved coordinates.
+ */
+vector<float> SampleSet::get( Kind kind, int count, unsigned seed )
+{
+	if( seed == Sampling::SEED )
+	{
+		SampleSet set;
+		if( set.open( conf::SAMPLES_FOLDER + filename( kind, count ) ) )
+		{
+			if( set.getCount() == count && set.getDimension() == DIMENSIONS[kind] )
+				return vector<float>( set.data(), set.data() + count * DIMENSIONS[kind] );
+			cerr << "[SampleSet] " << filename( kind, count ) << " doesn't hold " << count << " samples of dimension "
+				 << DIMENSIONS[kind] << endl;
+		}
+	}
+	return generate( kind, count, seed );
+}
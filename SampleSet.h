@@ -0,0 +1,58 @@
+#ifndef SampleSet_h
+#define SampleSet_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Precomputed sample sets in a compact binary file: a 16-byte header (the "RSMS" magic, format version, dimension, and
+ * sample count, as little-endian 32-bit unsigned integers) followed by the interleaved coordinates as little-endian
+ * 32-bit floats.  Files are memory-mapped, so on little-endian hosts data() points into the file without parsing (big-
+ * endian hosts swap the bytes into a buffer).  get() copies a set out of its file for callers that outlive it.  The
+ * library in Resources/samples (written by the RSMSamples tool) holds disks, hemispheres, and spheres of several sizes
+ * generated with Sampling::SEED; get() falls back to generating any set that isn't there.
+ */
+class SampleSet
+{
+public:
+	enum Kind { DISK, HEMISPHERE, SPHERE, KIND_COUNT };
+
+private:
+	static const uint32_t VERSION = 1;
+	static const size_t HEADER_BYTES = 16;
+	static const char MAGIC[4];
+
+	const float* samples;						// Coordinates within the mapping, or within buffer.
+	int count;
+	int dimension;
+	void* mapping;								// Mapped file, if any.
+	size_t mappingBytes;
+	vector<float> buffer;						// File contents where memory mapping isn't available, or byte-swapped.
+
+	static bool isLittleEndian();
+	static uint32_t swapBytes( uint32_t word );
+
+public:
+	static const char* const KIND_NAMES[KIND_COUNT];
+	static const int DIMENSIONS[KIND_COUNT];
+
+	SampleSet();
+	~SampleSet();
+	SampleSet( const SampleSet& ) = delete;
+	SampleSet& operator=( const SampleSet& ) = delete;
+	bool open( const string& filename );
+	void close();
+	const float* data() const;
+	int getCount() const;
+	int getDimension() const;
+
+	static bool save( const string& filename, int dimension, const vector<float>& samples );
+	static string filename( Kind kind, int count );
+	static vector<float> generate( Kind kind, int count, unsigned seed );
+	static vector<float> get( Kind kind, int count, unsigned seed );
+};
+
+#endif /* SampleSet_h */
@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Sampling.h"
+
+/**
+ * Uniform random number from the raw generator output, since the standard distributions may differ between libraries
+ * and samples must be the same everywhere.
+ * @param generator Random number generator.
+ * @return Number in [0, 1).
+ */
+double Sampling::uniform( mt19937& generator )
+{
+	return generator() / 4294967296.0;
+}
+
+/**
+ * Bridson's Poisson disk sampling of the unit disk: new samples are drawn around random active samples, and accepted if
+ * no other sample lies closer than radius.  A background grid with cells of radius / sqrt(2) holds at most one sample
+ * each, so every test looks at the 5x5 cells around the candidate.
+ * @param radius Minimum distance between samples.
+ * @param generator Random number generator.
+ * @return Interleaved x and y coordinates of the samples, in the order they were accepted.
+ */
+vector<float> Sampling::bridson( double radius, mt19937& generator )
+{
+	const double cell = radius / sqrt( 2.0 );
+	const int gridSide = max( static_cast<int>( ceil( 2.0 / cell ) ), 1 );
+	vector<int> grid( static_cast<size_t>( gridSide ) * gridSide, -1 );
+	auto cellOf = [cell, gridSide]( double v ) {
+		return min( max( static_cast<int>( ( v + 1.0 ) / cell ), 0 ), gridSide - 1 );
+	};
+
+	vector<float> points;
+	vector<int> active;
+	auto insert = [&]( double x, double y ) {
+		const int index = static_cast<int>( points.size() / 2 );
+		points.push_back( static_cast<float>( x ) );
+		points.push_back( static_cast<float>( y ) );
+		grid[cellOf( y ) * gridSide + cellOf( x )] = index;
+		active.push_back( index );
+	};
+
+	const double firstAngle = 2.0 * M_PI * uniform( generator );
+	const double firstRadius = sqrt( uniform( generator ) );
+	insert( firstRadius * cos( firstAngle ), firstRadius * sin( firstAngle ) );
+
+	// Candidate directions are evenly spaced from a random angle, so consecutive ones come from a rotation instead of
+	// trigonometric functions, at random distances (uniform in the area of the annulus between radius and twice radius).
+	const double stepCos = cos( 2.0 * M_PI / CANDIDATES ), stepSin = sin( 2.0 * M_PI / CANDIDATES );
+	while( !active.empty() )
+	{
+		const size_t slot = min( static_cast<size_t>( uniform( generator ) * active.size() ), active.size() - 1 );
+		const double px = points[2 * active[slot]], py = points[2 * active[slot] + 1];
+		const double angle = 2.0 * M_PI * uniform( generator );
+		double dx = cos( angle ), dy = sin( angle );
+		bool found = false;
+		for( int k = 0; k < CANDIDATES && !found; k++ )
+		{
+			const double distance = radius * sqrt( 1.0 + 3.0 * uniform( generator ) );
+			const double x = px + distance * dx, y = py + distance * dy;
+			const double rotatedX = dx * stepCos - dy * stepSin;
+			dy = dx * stepSin + dy * stepCos;
+			dx = rotatedX;
+			if( x * x + y * y > 1.0 )
+				continue;
+
+			const int cx = cellOf( x ), cy = cellOf( y );
+			bool valid = true;
+			for( int j = max( cy - 2, 0 ); j <= min( cy + 2, gridSide - 1 ) && valid; j++ )
+				for( int i = max( cx - 2, 0 ); i <= min( cx + 2, gridSide - 1 ) && valid; i++ )
+				{
+					const int other = grid[j * gridSide + i];
+					if( other >= 0 )
+					{
+						const double ox = points[2 * other] - x, oy = points[2 * other + 1] - y;
+						valid = ( ox * ox + oy * oy >= radius * radius );
+					}
+				}
+
+			if( valid )
+			{
+				insert( x, y );
+				found = true;
+			}
+		}
+
+		if( !found )											// Retire the sample: its neighborhood is full.
+		{
+			active[slot] = active.back();
+			active.pop_back();
+		}
+	}
+
+	return points;
+}
+
+/**
+ * Trim a sample set by repeatedly removing a sample of the closest pair, which keeps the remaining samples as far apart
+ * as possible.
+ * @param points Interleaved x and y coordinates, trimmed in place (keeping their relative order).
+ * @param count Number of samples to keep.
+ */
+void Sampling::eliminate( vector<float>& points, int count )
+{
+	const int n = static_cast<int>( points.size() / 2 );
+	if( n <= count )
+		return;
+
+	vector<bool> alive( n, true );
+	vector<double> nearest( n );								// Squared distance to the nearest sample.
+	vector<int> neighbor( n );
+	auto update = [&]( int i ) {
+		nearest[i] = numeric_limits<double>::max();
+		for( int j = 0; j < n; j++ )
+		{
+			if( j == i || !alive[j] )
+				continue;
+			const double dx = points[2 * j] - points[2 * i], dy = points[2 * j + 1] - points[2 * i + 1];
+			const double d2 = dx * dx + dy * dy;
+			if( d2 < nearest[i] )
+			{
+				nearest[i] = d2;
+				neighbor[i] = j;
+			}
+		}
+	};
+	for( int i = 0; i < n; i++ )
+		update( i );
+
+	for( int removed = 0; removed < n - count; removed++ )
+	{
+		int worst = -1;
+		for( int i = 0; i < n; i++ )
+			if( alive[i] && ( worst < 0 || nearest[i] < nearest[worst] ) )
+				worst = i;
+		alive[worst] = false;
+		for( int i = 0; i < n; i++ )
+			if( alive[i] && neighbor[i] == worst )
+				update( i );
+	}
+
+	vector<float> kept;
+	for( int i = 0; i < n; i++ )
+		if( alive[i] )
+		{
+			kept.push_back( points[2 * i] );
+			kept.push_back( points[2 * i + 1] );
+		}
+	points.swap( kept );
+}
+
+/**
+ * Poisson disk samples in the unit disk: the Bridson radius is corrected from the number of samples it yields (which
+ * goes with the inverse of its square) until a set has at least count samples and few in excess, and those are
+ * eliminated.  Every attempt restarts from the seed, so the result only depends on the count and the seed.
+ * @param count Number of samples.
+ * @param seed Random seed.
+ * @return Interleaved x and y coordinates of count samples.
+ */
+vector<float> Sampling::poissonDisk( int count, unsigned seed )
+{
+	if( count <= 0 )
+		return {};
+
+	mt19937 generator;
+	vector<float> best;
+	double radius = 1.5 / sqrt( count );						// Samples of a maximal set are about this far apart.
+	for( int attempt = 0; attempt < RADIUS_ATTEMPTS || best.empty(); attempt++ )
+	{
+		generator.seed( seed );
+		vector<float> points = bridson( radius, generator );
+		const double ratio = static_cast<double>( points.size() / 2 ) / count;
+		if( ratio >= 1.0 )
+		{
+			best.swap( points );
+			if( ratio <= MAX_EXCESS )
+				break;
+		}
+		radius *= sqrt( ratio ) * ( ( ratio >= 1.0 )? 1.0 : 0.99 );	// Aim just below the count when it fell short.
+	}
+
+	eliminate( best, count );
+	return best;
+}
+
+/**
+ * Cosine-weighted directions on the unit hemisphere (z up): Poisson disk samples lifted onto the hemisphere, which
+ * distributes their directions by the cosine to the z-axis.  Bridson's order follows the growth of the disk, so samples
+ * are shuffled, and any range of them covers the whole hemisphere.
+ * @param count Number of samples.
+ * @param seed Random seed.
+ * @return Interleaved x, y, and z coordinates of count unit vectors.
+ */
+vector<float> Sampling::hemisphere( int count, unsigned seed )
+{
+	const vector<float> disk = poissonDisk( count, seed );
+
+	mt19937 generator( seed );
+	vector<int> order( count );
+	for( int i = 0; i < count; i++ )
+		order[i] = i;
+	for( int i = count - 1; i > 0; i-- )
+		swap( order[i], order[min( static_cast<int>( uniform( generator ) * ( i + 1 ) ), i )] );
+
+	vector<float> directions;
+	for( int i = 0; i < count; i++ )
+	{
+		const double x = disk[2 * order[i]], y = disk[2 * order[i] + 1];
+		directions.push_back( static_cast<float>( x ) );
+		directions.push_back( static_cast<float>( y ) );
+		directions.push_back( static_cast<float>( sqrt( max( 1.0 - x * x - y * y, 0.0 ) ) ) );
+	}
+	return directions;
+}
+
+/**
+ * Uniformly distributed directions on the unit sphere: Poisson disk samples taken onto the sphere by the inverse Lambert
+ * azimuthal equal-area projection, which keeps their spacing away from the pole opposite to z (where the disk rim lands).
+ * @param count Number of samples.
+ * @param seed Random seed.
+ * @return Interleaved x, y, and z coordinates of count unit vectors.
+ */
+vector<float> Sampling::sphere( int count, unsigned seed )
+{
+	const vector<float> disk = poissonDisk( count, seed );
+
+	vector<float> directions;
+	for( int i = 0; i < count; i++ )
+	{
+		const double x = disk[2 * i], y = disk[2 * i + 1];
+		const double r2 = min( x * x + y * y, 1.0 );
+		const double s = 2.0 * sqrt( 1.0 - r2 );
+		directions.push_back( static_cast<float>( x * s ) );
+		directions.push_back( static_cast<float>( y * s ) );
+		directions.push_back( static_cast<float>( 1.0 - 2.0 * r2 ) );
+	}
+	return directions;
+}
+
+/**
+ * Tileable blue-noise texture by Ulichney's void-and-cluster method: an initial random pattern of about a tenth of the
+ * texels is relaxed by moving its tightest cluster into its largest void until they coincide, where clusters and voids
+ * are the maximum and minimum of a Gaussian-filtered energy over the torus.  Then texels are ranked by removing the
+ * tightest clusters from the initial pattern, and by filling the largest voids from it up to the full texture.
+ * @param side Texture side in texels.
+ * @param seed Random seed.
+ * @return Rank of every texel (row by row) mapped to [0, 1), each rank appearing once.
+ */
+vector<float> Sampling::blueNoise( int side, unsigned seed )
+{
+	if( side <= 0 )
+		return {};
+
+	const int n = side * side;
+	vector<double> filter( n );									// Energy contributed at every toroidal offset.
+	for( int dy = 0; dy < side; dy++ )
+		for( int dx = 0; dx < side; dx++ )
+		{
+			const double wx = min( dx, side - dx ), wy = min( dy, side - dy );
+			filter[dy * side + dx] = exp( -( wx * wx + wy * wy ) / ( 2.0 * VOID_CLUSTER_SIGMA * VOID_CLUSTER_SIGMA ) );
+		}
+
+	vector<bool> on( n, false );
+	vector<double> energy( n, 0.0 );
+	// The filter is negligible beyond 4 standard deviations, so texels only update the energy of their neighborhood.
+	const int extent = min( static_cast<int>( ceil( 4.0 * VOID_CLUSTER_SIGMA ) ), side / 2 );
+	const int last = ( 2 * extent + 1 > side )? extent - 1 : extent;		// Don't wrap onto the same texel twice.
+	auto set = [&]( int p, bool value ) {
+		on[p] = value;
+		const double sign = value? 1.0 : -1.0;
+		const int px = p % side, py = p / side;
+		for( int dy = -extent; dy <= last; dy++ )
+		{
+			const int qy = ( py + dy + side ) % side, fy = ( dy + side ) % side;
+			for( int dx = -extent; dx <= last; dx++ )
+				energy[qy * side + ( px + dx + side ) % side] += sign * filter[fy * side + ( dx + side ) % side];
+		}
+	};
+	auto tightestCluster = [&]() {
+		int best = -1;
+		for( int p = 0; p < n; p++ )
+			if( on[p] && ( best < 0 || energy[p] > energy[best] ) )
+				best = p;
+		return best;
+	};
+	auto largestVoid = [&]() {
+		int best = -1;
+		for( int p = 0; p < n; p++ )
+			if( !on[p] && ( best < 0 || energy[p] < energy[best] ) )
+				best = p;
+		return best;
+	};
+
+	// Initial binary pattern, relaxed so that its samples are evenly spread.
+	mt19937 generator( seed );
+	const int initialCount = max( n / 10, 1 );
+	for( int placed = 0; placed < initialCount; )
+	{
+		const int p = min( static_cast<int>( uniform( generator ) * n ), n - 1 );
+		if( !on[p] )
+		{
+			set( p, true );
+			placed++;
+		}
+	}
+	for( int iteration = 0; iteration < n; iteration++ )
+	{
+		const int cluster = tightestCluster();
+		set( cluster, false );
+		const int gap = largestVoid();
+		set( gap, true );
+		if( gap == cluster )
+			break;
+	}
+	const vector<bool> initialOn = on;
+	const vector<double> initialEnergy = energy;
+
+	// Ranks below the initial count: remove the tightest clusters.
+	vector<int> rank( n );
+	for( int r = initialCount - 1; r >= 0; r-- )
+	{
+		const int cluster = tightestCluster();
+		set( cluster, false );
+		rank[cluster] = r;
+	}
+
+	// The rest: fill the largest voids.
+	on = initialOn;
+	energy = initialEnergy;
+	for( int r = initialCount; r < n; r++ )
+	{
+		const int gap = largestVoid();
+		set( gap, true );
+		rank[gap] = r;
+	}
+
+	vector<float> texture( n );
+	for( int p = 0; p < n; p++ )
+		texture[p] = static_cast<float>( ( rank[p] + 0.5 ) / n );
+	return texture;
+}
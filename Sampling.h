@@ -0,0 +1,36 @@
+#ifndef Sampling_h
+#define Sampling_h
+
+#include <vector>
+#include <random>
+
+using namespace std;
+
+/**
+ * Deterministic blue-noise sample sets: Poisson disks of any size (Bridson's algorithm on a background grid, trimmed to
+ * the requested count by sample elimination), hemisphere and sphere directions mapped from them, and tileable
+ * blue-noise textures (void-and-cluster).  The same count and seed always produce the same samples, and sets of a few
+ * thousand points take milliseconds, so they can be regenerated whenever a sample count changes.
+ */
+class Sampling
+{
+private:
+	static const int CANDIDATES = 16;				// Bridson's attempts around an active sample before retiring it.
+	static const int RADIUS_ATTEMPTS = 6;			// Radius corrections before settling for any set with enough samples.
+	static constexpr double MAX_EXCESS = 1.02;		// Samples in excess (as a ratio) that are fine to eliminate.
+	static constexpr double VOID_CLUSTER_SIGMA = 1.5;	// Energy filter standard deviation in texels.
+
+	static vector<float> bridson( double radius, mt19937& generator );
+	static void eliminate( vector<float>& points, int count );
+
+public:
+	static const unsigned SEED = 2019;				// Default seed.
+
+	static double uniform( mt19937& generator );
+	static vector<float> poissonDisk( int count, unsigned seed = SEED );
+	static vector<float> hemisphere( int count, unsigned seed = SEED );
+	static vector<float> sphere( int count, unsigned seed = SEED );
+	static vector<float> blueNoise( int side, unsigned seed = SEED );
+};
+
+#endif /* Sampling_h */
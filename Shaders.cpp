@@ -2,6 +2,8 @@
 
 /**
  * Read shader file, line by line.
+ * Lines of the form #include "file" are replaced by the contents of that file (relative to the including one), so that
+ * several shaders can share the same functions.
  * @param fname Shader file name, with relative path.
  */
 string Shaders::read( const string& fname )
@@ -11,9 +13,17 @@ string Shaders::read( const string& fname )
 	
 	if( sFile.is_open() )
 	{
+		const string directory = fname.substr( 0, fname.find_last_of( '/' ) + 1 );
 		string line;
 		while( getline( sFile, line ) )
-			content += line + '\n';
+		{
+			size_t start = line.find( "#include \"" );
+			size_t end = line.rfind( '"' );
+			if( start != string::npos && end > start + 10 )
+				content += read( directory + line.substr( start + 10, end - start - 10 ) );
+			else
+				content += line + '\n';
+		}
 		
 		sFile.close();
 	}
@@ -27,57 +37,65 @@ string Shaders::read( const string& fname )
 }
 
 /**
- * Creates a program from the vertex and fragment shaders provided.
- * @param fvert Vertex shader file name, with relative path.
- * @param ffrag Fragment shader file name, with relative parth.
- * @return A shading program, otherwise, it exits the application with an error.
+ * Insert preprocessor definitions right after the #version line of a shader source.
+ * @param source Shader source code.
+ * @param defines Definitions, one per line (e.g. "#define TAPS 2\n").
+ * @return Source code with the definitions.
+ */
+string Shaders::define( const string& source, const string& defines )
+{
+	size_t versionEnd = source.find( '\n' );
+	if( defines.empty() || versionEnd == string::npos )
+		return source;
+	return source.substr( 0, versionEnd + 1 ) + defines + source.substr( versionEnd + 1 );
+}
+
+/**
+ * Compile one shader stage.
+ * @param type Shader type (e.g. GL_VERTEX_SHADER).
+ * @param fname Shader file name, with relative path.
+ * @param defines Preprocessor definitions.
+ * @return The shader object, otherwise, it exits the application with an error.
  */
-GLuint Shaders::compile( const string& fvert, const string& ffrag )
+GLuint Shaders::compileStage( GLenum type, const string& fname, const string& defines )
 {
 	const GLint MAXLENGTH = 500;
-	GLuint vertexShader;
-	GLuint fragmentShader;
-	GLuint program;
 	GLint compileParam;
 	GLchar compileInfoLog[MAXLENGTH+1];
 	GLint compileInfoLength;
 	
-	// Source code for vertex shader.
-	string s = read( fvert );
-	const GLchar* vertexShaderSource = s.c_str();
+	// Source code for the stage.
+	string s = define( read( fname ), defines );
+	const GLchar* shaderSource = s.c_str();
 	
-	// Source code for fragment shader.
-	string t = read( ffrag );
-	const GLchar* fragmentShaderSource = t.c_str();
-	
-	// Create and compile verter shader.
-	vertexShader = glCreateShader( GL_VERTEX_SHADER );
-	glShaderSource( vertexShader, 1, &vertexShaderSource, NULL );
-	glCompileShader( vertexShader );
-	glGetShaderiv( vertexShader, GL_COMPILE_STATUS, &compileParam );
+	// Create and compile the shader.
+	GLuint shader = glCreateShader( type );
+	glShaderSource( shader, 1, &shaderSource, NULL );
+	glCompileShader( shader );
+	glGetShaderiv( shader, GL_COMPILE_STATUS, &compileParam );
 	if( compileParam == GL_FALSE )
 	{
-		glGetShaderInfoLog( vertexShader, MAXLENGTH, &compileInfoLength, compileInfoLog );
+		glGetShaderInfoLog( shader, MAXLENGTH, &compileInfoLength, compileInfoLog );
 		cerr << compileInfoLog << endl;
 		exit( EXIT_FAILURE );
 	}
 	
-	// Create and compile fragment shader.
-	fragmentShader = glCreateShader( GL_FRAGMENT_SHADER );
-	glShaderSource( fragmentShader, 1, &fragmentShaderSource, NULL );
-	glCompileShader( fragmentShader );
-	glGetShaderiv( fragmentShader, GL_COMPILE_STATUS, &compileParam );
-	if( compileParam == GL_FALSE )
-	{
-		glGetShaderInfoLog( fragmentShader, MAXLENGTH, &compileInfoLength, compileInfoLog );
-		cerr << compileInfoLog << endl;
-		exit( EXIT_FAILURE );
-	}
+	return shader;
+}
+
+/**
+ * Link a program from compiled shader stages, and delete them.
+ * @param shaders Shader objects.
+ * @return A shading program, otherwise, it exits the application with an error.
+ */
+GLuint Shaders::link( const vector<GLuint>& shaders )
+{
+	const GLint MAXLENGTH = 500;
 	
 	// Create program, attach shaders to it, and link it.
-	program = glCreateProgram();
-	glAttachShader( program, vertexShader );
-	glAttachShader( program, fragmentShader );
+	GLuint program = glCreateProgram();
+	for( GLuint shader : shaders )
+		glAttachShader( program, shader );
 	glLinkProgram( program );
 	
 	GLint linkParam;
@@ -92,8 +110,34 @@ GLuint Shaders::compile( const string& fvert, const string& ffrag )
 	}
 	
 	// Delete shaders since the program has them all now.
-	glDeleteShader( vertexShader );
-	glDeleteShader( fragmentShader );
+	for( GLuint shader : shaders )
+		glDeleteShader( shader );
 	
 	return program;
 }
+
+/**
+ * Creates a program from the vertex and fragment shaders provided.
+ * @param fvert Vertex shader file name, with relative path.
+ * @param ffrag Fragment shader file name, with relative parth.
+ * @param defines Preprocessor definitions for both shaders, e.g. to specialize loop bounds.
+ * @return A shading program, otherwise, it exits the application with an error.
+ */
+GLuint Shaders::compile( const string& fvert, const string& ffrag, const string& defines )
+{
+	return link( { compileStage( GL_VERTEX_SHADER, fvert, defines ), compileStage( GL_FRAGMENT_SHADER, ffrag, defines ) } );
+}
+
+/**
+ * Creates a program from the vertex, geometry, and fragment shaders provided.
+ * @param fvert Vertex shader file name, with relative path.
+ * @param fgeom Geometry shader file name, with relative path.
+ * @param ffrag Fragment shader file name, with relative path.
+ * @param defines Preprocessor definitions for all three shaders.
+ * @return A shading program, otherwise, it exits the application with an error.
+ */
+GLuint Shaders::compile( const string& fvert, const string& fgeom, const string& ffrag, const string& defines )
+{
+	return link( { compileStage( GL_VERTEX_SHADER, fvert, defines ), compileStage( GL_GEOMETRY_SHADER, fgeom, defines ),
+				   compileStage( GL_FRAGMENT_SHADER, ffrag, defines ) } );
+}
@@ -4,7 +4,8 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <OpenGL/gl3.h>
+#include <vector>
+#include "OpenGLHeaders.h"
 
 using namespace std;
 
@@ -12,9 +13,13 @@ class Shaders
 {
 private:
 	string read( const string& fname );
+	static string define( const string& source, const string& defines );
+	GLuint compileStage( GLenum type, const string& fname, const string& defines );
+	static GLuint link( const vector<GLuint>& shaders );
 	
 public:
-	GLuint compile( const string& fvert, const string& ffrag );
+	GLuint compile( const string& fvert, const string& ffrag, const string& defines = "" );
+	GLuint compile( const string& fvert, const string& fgeom, const string& ffrag, const string& defines );
 };
 
 #endif /* shaders_h */
@@ -0,0 +1,460 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <cstring>
+#include "Sampling.h"
+#include "VPLExtractor.h"
+
+/**
+ * Allocate the pixel-pack buffers for the readbacks and the uniform buffer for the clusters, and start the builder and
+ * assignment worker threads.
+ */
+void VPLExtractor::init()
+{
+	const auto readbackSize = static_cast<GLsizeiptr>( 3 * GRID * GRID * 4 * sizeof( float ) );
+	for( Slot& slot : slots )
+	{
+		glGenBuffers( 1, &slot.pbo );
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbo );
+		glBufferData( GL_PIXEL_PACK_BUFFER, readbackSize, nullptr, GL_STREAM_READ );
+		slot.fence = nullptr;
+		slot.side = slot.rsmSide = 0;
+		slot.regions.clear();
+	}
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	glGenBuffers( 1, &ubo );
+	glBindBuffer( GL_UNIFORM_BUFFER, ubo );
+	glBufferData( GL_UNIFORM_BUFFER, 3 * MAX_CLUSTERS * 4 * sizeof( float ), nullptr, GL_DYNAMIC_DRAW );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+
+	oldest = inFlight = 0;
+	clusterCount = 0;
+	hasClusters = false;
+
+	stopping = jobPending = building = built = false;
+	assignGeneration = 0;
+	assignPending = 0;
+	const int workerCount = max( 1, min( static_cast<int>( thread::hardware_concurrency() ), 8 ) );
+	builder = thread( &VPLExtractor::builderLoop, this );
+	for( int w = 1; w < workerCount; w++ )
+		workers.emplace_back( &VPLExtractor::workerLoop, this, w, workerCount );
+}
+
+/**
+ * Issue the asynchronous readback of the hierarchical RSM level with at most GRID x GRID texels, hand the latest finished
+ * readback to the builder thread, and upload the clusters it built since the last call.  Only the very first readback
+ * and rebuild are waited for, so that there are always clusters to use.  While the RSM doesn't change, no new readbacks
+ * are issued and the clusters converge to those of the last one.
+ * Leaves the cluster uniform buffer bound to BINDING.
+ * @param flux Hierarchical RSM flux + flux weight texture (with mipmaps).
+ * @param position Hierarchical RSM texture with positions premultiplied by the flux weight.
+ * @param normal Hierarchical RSM texture with normals premultiplied by the flux weight.
+ * @param rsmSide Side of the base level in texels.
+ * @param regions Squares of the base level that every light renders into (the whole of it for a single light).
+ * @param rsmChanged Whether the hierarchical RSM changed since the last call.
+ */
+void VPLExtractor::update( GLuint flux, GLuint position, GLuint normal, int rsmSide, const vector<Region>& regions, bool rsmChanged )
+{
+	collect( false );
+	if( ( rsmChanged || !hasClusters ) && inFlight < RING_SIZE )
+	{
+		int level = 0, side = rsmSide;
+		while( side > GRID )
+		{
+			side = max( side / 2, 1 );
+			level++;
+		}
+
+		Slot& slot = slots[( oldest + inFlight ) % RING_SIZE];
+		slot.side = side;
+		slot.rsmSide = rsmSide;
+		slot.regions = regions;
+
+		const size_t textureSize = static_cast<size_t>( side ) * side * 4 * sizeof( float );
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbo );
+		glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+		GLuint textures[] = { flux, position, normal };
+		for( int i = 0; i < 3; i++ )								// Into the buffer: returns immediately.
+		{
+			glBindTexture( GL_TEXTURE_2D, textures[i] );
+			glGetTexImage( GL_TEXTURE_2D, level, GL_RGBA, GL_FLOAT, reinterpret_cast<void*>( i * textureSize ) );
+		}
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+		slot.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+		inFlight++;
+	}
+
+	if( !hasClusters )
+		collect( true );
+	publish( !hasClusters );
+	glBindBufferBase( GL_UNIFORM_BUFFER, BINDING, ubo );
+}
+
+/**
+ * Map the pixel-pack buffers whose readbacks are complete, oldest first, and hand them to the builder thread.  A readback
+ * that the builder hasn't taken yet is replaced by a newer one.
+ * @param wait If true, block until at least the oldest readback completes.
+ */
+void VPLExtractor::collect( bool wait )
+{
+	while( inFlight > 0 )
+	{
+		Slot& slot = slots[oldest];
+		GLenum status = glClientWaitSync( slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait? 1000000000 : 0 );
+		if( status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED )
+		{
+			if( !wait || status == GL_WAIT_FAILED )
+				break;
+			continue;
+		}
+		wait = false;											// Only the first readback is waited for.
+
+		glDeleteSync( slot.fence );
+		slot.fence = nullptr;
+		oldest = ( oldest + 1 ) % RING_SIZE;
+		inFlight--;
+
+		const size_t count = static_cast<size_t>( 3 ) * slot.side * slot.side * 4;
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.pbo );
+		const void* data = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>( count * sizeof( float ) ), GL_MAP_READ_BIT );
+		if( data )
+		{
+			{
+				unique_lock<mutex> guard( lock );
+				job.side = slot.side;
+				job.rsmSide = slot.rsmSide;
+				job.regions = slot.regions;
+				job.pixels.resize( count );
+				memcpy( job.pixels.data(), data, count * sizeof( float ) );
+				jobPending = true;
+				changed.notify_all();
+			}
+			glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+		}
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	}
+}
+
+/**
+ * Upload the clusters of the last finished rebuild, if any.
+ * @param wait If true, block until the rebuild of the readback handed to the builder (if there's one) finishes.
+ */
+void VPLExtractor::publish( bool wait )
+{
+	vector<float> data;
+	{
+		unique_lock<mutex> guard( lock );
+		if( wait )
+			changed.wait( guard, [this]() { return built || ( !jobPending && !building ); } );
+		if( !built )
+			return;
+		data.swap( builtData );
+		clusterCount = builtCount;
+		cpuMilliseconds = builtMilliseconds;
+		built = false;
+	}
+
+	glBindBuffer( GL_UNIFORM_BUFFER, ubo );
+	glBufferSubData( GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>( data.size() * sizeof( float ) ), data.data() );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+	hasClusters = true;
+}
+
+/**
+ * Builder thread: rebuild the clusters from every readback handed over by collect(), until the extractor is destroyed.
+ */
+void VPLExtractor::builderLoop()
+{
+	unique_lock<mutex> guard( lock );
+	while( true )
+	{
+		changed.wait( guard, [this]() { return stopping || jobPending; } );
+		if( stopping )
+			break;
+
+		Job current = move( job );
+		jobPending = false;
+		building = true;
+
+		guard.unlock();									// Cluster without holding the lock.
+		auto start = chrono::steady_clock::now();
+		vector<float> data;
+		int count = 0;
+		build( current, data, count );
+		double milliseconds = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+		guard.lock();
+
+		builtData.swap( data );
+		builtCount = count;
+		builtMilliseconds = milliseconds;
+		built = true;
+		building = false;
+		changed.notify_all();
+	}
+}
+
+/**
+ * Assignment worker thread: run its range of every k-means assignment step, until the extractor is destroyed.
+ * @param worker Worker index (the builder thread is worker 0).
+ * @param workerCount Number of workers, including the builder thread.
+ */
+void VPLExtractor::workerLoop( int worker, int workerCount )
+{
+	unique_lock<mutex> guard( lock );
+	unsigned generation = assignGeneration;
+	while( true )
+	{
+		changed.wait( guard, [&]() { return ( stopping && !building ) || assignGeneration != generation; } );
+		if( assignGeneration == generation )			// Stopping, and the builder won't start another step.
+			break;
+
+		generation = assignGeneration;
+		const int k = assignClusters;
+		guard.unlock();
+		assign( worker * SAMPLES / workerCount, ( worker + 1 ) * SAMPLES / workerCount, k );
+		guard.lock();
+
+		if( --assignPending == 0 )
+			changed.notify_all();
+	}
+}
+
+/**
+ * Importance-sample VPLs by flux from a readback and cluster them with k-means (on the builder thread).
+ * Every VPL's power is its flux times its texel area (in the texture units of its light's space) divided by its sampling
+ * probability, so the clusters' total power estimates the flux integrated over every light's reflective shadow map.
+ * @param readback Readback and its description.
+ * @param data Receives the clusters' positions + radius, normals, and power (std140 vec4 arrays).
+ * @param count Receives the number of clusters.
+ */
+void VPLExtractor::build( const Job& readback, vector<float>& data, int& count )
+{
+	const int n = readback.side * readback.side;
+	const float* flux = readback.pixels.data();					// RGB average flux + flux weight.
+	const float* positions = flux + 4 * n;					// Premultiplied by the flux weight.
+	const float* normals = flux + 8 * n;
+
+	// Cumulative distribution of flux weights.
+	vector<double> cdf( static_cast<size_t>( n ) );
+	double total = 0;
+	for( int t = 0; t < n; t++ )
+	{
+		total += max( 0.0f, flux[4 * t + 3] );
+		cdf[t] = total;
+	}
+
+	count = 0;
+	data.assign( 3 * MAX_CLUSTERS * 4, 0.0f );
+	if( total > 0 )
+	{
+		// Stratified importance sampling: every VPL carries the same share of the total flux weight.
+		generator.seed( SEED );
+		const double texelArea = 1.0 / n;						// In atlas texture units.
+		const float levelScale = static_cast<float>( readback.rsmSide ) / static_cast<float>( readback.side );	// Base level texels per texel.
+		float texelWorldSize = INFINITY;						// Of the finest light, at the level read back.
+		for( const Region& region : readback.regions )
+			texelWorldSize = min( texelWorldSize, region.texelWorldSize * static_cast<float>( readback.rsmSide ) / static_cast<float>( readback.side ) );
+		vpls.resize( SAMPLES );
+		for( int i = 0; i < SAMPLES; i++ )
+		{
+			double u = ( i + Sampling::uniform( generator ) ) / SAMPLES * total;
+			int t = min( static_cast<int>( lower_bound( cdf.begin(), cdf.end(), u ) - cdf.begin() ), n - 1 );
+			while( t < n - 1 && flux[4 * t + 3] <= 0 )			// Skip texels with no flux (u landed on a CDF plateau edge).
+				t++;
+
+			// Texel areas grow in the space of lights with smaller tiles.
+			double tileRatio = 1.0;
+			const float tx = ( t % readback.side + 0.5f ) * levelScale, ty = ( t / readback.side + 0.5f ) * levelScale;
+			for( const Region& region : readback.regions )
+				if( tx >= region.x && tx < region.x + region.side && ty >= region.y && ty < region.y + region.side )
+					tileRatio = static_cast<double>( readback.rsmSide ) / region.side;
+
+			const float w = flux[4 * t + 3];
+			const double scale = total * texelArea * tileRatio * tileRatio / ( SAMPLES * w );
+			const float* normal = normals + 4 * t;
+			float normalLength = sqrt( normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2] );
+			for( int c = 0; c < 3; c++ )
+			{
+				vpls[i].position[c] = positions[4 * t + c] / w;
+				vpls[i].normal[c] = ( normalLength > 0 )? normal[c] / normalLength : 0;
+				vpls[i].power[c] = static_cast<float>( flux[4 * t + c] * scale );
+			}
+		}
+
+		// k-means on positions and normals, seeded with the previous centers (the RSM changes little between frames), or
+		// else with evenly spaced VPLs (they're sorted by texel).
+		const int k = min( MAX_CLUSTERS, SAMPLES );
+		const bool warm = ( centers.size() == static_cast<size_t>( 6 * k ) );
+		if( !warm )
+		{
+			centers.resize( 6 * k );
+			for( int j = 0; j < k; j++ )
+			{
+				const VPL& vpl = vpls[j * SAMPLES / k];
+				copy( vpl.position, vpl.position + 3, centers.begin() + 6 * j );
+				copy( vpl.normal, vpl.normal + 3, centers.begin() + 6 * j + 3 );
+			}
+		}
+
+		assignment.assign( SAMPLES, 0 );
+		const int workerCount = static_cast<int>( workers.size() ) + 1;
+		vector<double> sums( 7 * k );
+		for( int iteration = 0; iteration < ( warm? WARM_ITERATIONS : ITERATIONS ); iteration++ )
+		{
+			// Assignment step, split among the workers.
+			{
+				unique_lock<mutex> guard( lock );
+				assignClusters = k;
+				assignPending = workerCount - 1;
+				assignGeneration++;
+				changed.notify_all();
+			}
+			assign( 0, SAMPLES / workerCount, k );
+			{
+				unique_lock<mutex> guard( lock );
+				changed.wait( guard, [this]() { return assignPending == 0; } );
+			}
+
+			// Update step: every VPL has the same flux weight, so centers are plain means.  Empty clusters stay put.
+			fill( sums.begin(), sums.end(), 0.0 );
+			for( int i = 0; i < SAMPLES; i++ )
+			{
+				double* s = &sums[7 * assignment[i]];
+				for( int c = 0; c < 3; c++ )
+				{
+					s[c] += vpls[i].position[c];
+					s[3 + c] += vpls[i].normal[c];
+				}
+				s[6]++;
+			}
+			for( int j = 0; j < k; j++ )
+			{
+				const double* s = &sums[7 * j];
+				if( s[6] == 0 )
+					continue;
+				double normalLength = sqrt( s[3] * s[3] + s[4] * s[4] + s[5] * s[5] );
+				for( int c = 0; c < 3; c++ )
+				{
+					centers[6 * j + c] = static_cast<float>( s[c] / s[6] );
+					centers[6 * j + 3 + c] = ( normalLength > 0 )? static_cast<float>( s[3 + c] / normalLength ) : 0.0f;
+				}
+			}
+		}
+
+		// Representatives: total power, mean position and normal, and RMS distance to the center as radius.
+		vector<double> radii( k, 0.0 ), counts( k, 0.0 ), power( 3 * k, 0.0 );
+		for( int i = 0; i < SAMPLES; i++ )
+		{
+			const int j = assignment[i];
+			double d2 = 0;
+			for( int c = 0; c < 3; c++ )
+			{
+				double d = vpls[i].position[c] - centers[6 * j + c];
+				d2 += d * d;
+				power[3 * j + c] += vpls[i].power[c];
+			}
+			radii[j] += d2;
+			counts[j]++;
+		}
+
+		for( int j = 0; j < k; j++ )
+		{
+			if( counts[j] == 0 )
+				continue;
+			float* p = &data[4 * count];
+			float* nrm = &data[4 * ( MAX_CLUSTERS + count )];
+			float* pw = &data[4 * ( 2 * MAX_CLUSTERS + count )];
+			for( int c = 0; c < 3; c++ )
+			{
+				p[c] = centers[6 * j + c];
+				nrm[c] = centers[6 * j + 3 + c];
+				pw[c] = static_cast<float>( power[3 * j + c] );
+			}
+			p[3] = max( static_cast<float>( sqrt( radii[j] / counts[j] ) ), texelWorldSize );	// Never smaller than a texel.
+			count++;
+		}
+	}
+}
+
+/**
+ * k-means assignment step for a range of VPLs: each goes to the nearest center in position and normal.
+ * @param begin First VPL index.
+ * @param end One past the last VPL index.
+ * @param k Number of clusters.
+ */
+void VPLExtractor::assign( int begin, int end, int k )
+{
+	for( int i = begin; i < end; i++ )
+	{
+		const VPL& vpl = vpls[i];
+		float best = INFINITY;
+		for( int j = 0; j < k; j++ )
+		{
+			const float* center = &centers[6 * j];
+			float dp = 0, dn = 0;
+			for( int c = 0; c < 3; c++ )
+			{
+				float d = vpl.position[c] - center[c];
+				dp += d * d;
+				d = vpl.normal[c] - center[3 + c];
+				dn += d * d;
+			}
+			float distance = dp + NORMAL_WEIGHT * dn;
+			if( distance < best )
+			{
+				best = distance;
+				assignment[i] = j;
+			}
+		}
+	}
+}
+
+/**
+ * Number of clusters in the uniform buffer.
+ * @return Cluster count.
+ */
+int VPLExtractor::getClusterCount() const
+{
+	return clusterCount;
+}
+
+/**
+ * CPU time the builder thread spent sampling and clustering VPLs in the last rebuild that was uploaded.
+ * @return Milliseconds.
+ */
+double VPLExtractor::getCPUMilliseconds() const
+{
+	return cpuMilliseconds;
+}
+
+/**
+ * Stop the threads and release the buffers, dropping the readbacks in flight.
+ */
+void VPLExtractor::destroy()
+{
+	{
+		unique_lock<mutex> guard( lock );
+		stopping = true;
+		changed.notify_all();
+	}
+	if( builder.joinable() )
+		builder.join();									// Finishes the rebuild in progress, if any.
+	for( thread& worker : workers )
+		worker.join();
+	workers.clear();
+
+	for( Slot& slot : slots )
+	{
+		if( slot.fence )
+			glDeleteSync( slot.fence );
+		slot.fence = nullptr;
+		glDeleteBuffers( 1, &slot.pbo );
+	}
+	glDeleteBuffers( 1, &ubo );
+	inFlight = 0;
+	hasClusters = false;
+	centers.clear();
+}
@@ -0,0 +1,116 @@
+#ifndef VPLExtractor_h
+#define VPLExtractor_h
+
+#include <vector>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "OpenGLHeaders.h"
+
+using namespace std;
+
+/**
+ * CPU-side virtual point light (VPL) extraction from a downsampled reflective shadow map.
+ * A coarse level of the hierarchical RSM (average flux, and flux-weighted positions and normals) is read back through a
+ * ring of pixel-pack buffers, and mapped only once its fence has signaled, so the render loop doesn't wait for the GPU.
+ * Then, a builder thread importance-samples a few thousand VPLs by flux and clusters them into a few hundred
+ * representatives with a k-means whose assignment step is split among a pool of worker threads, which live as long as
+ * the extractor.  The next update() uploads the clusters to a uniform buffer that the lighting shaders evaluate, so that
+ * the cost of indirect lighting doesn't depend on the RSM resolution or the sampling radius, and the render loop only
+ * copies the readback.
+ */
+class VPLExtractor
+{
+public:
+	static const int MAX_CLUSTERS = 256;		// Must match MAX_VPL_CLUSTERS in rsm.glsl.
+	static const int SAMPLES = 2048;			// Importance-sampled VPLs per update.
+	static const int GRID = 64;					// Largest side of the RSM level that is read back.
+	static const GLuint BINDING = 0;			// Uniform buffer binding point.
+
+	struct Region								// Square of the RSM atlas that one light renders into.
+	{
+		int x, y;								// Lower left corner, in base level texels.
+		int side;
+		float texelWorldSize;					// World units per base level texel.
+	};
+
+private:
+	static const int RING_SIZE = 3;				// Readbacks in flight.
+	static const int ITERATIONS = 8;			// k-means iterations from scratch.
+	static const int WARM_ITERATIONS = 3;		// k-means iterations starting from the previous clusters.
+	static constexpr float NORMAL_WEIGHT = 4.0f;	// Squared world units that a unit normal difference counts as.
+	static const unsigned SEED = 2019;			// Fixed seed, so that VPLs are stable from frame to frame.
+
+	struct Slot
+	{
+		GLuint pbo;
+		GLsync fence;							// Non-null while the readback is in flight.
+		int side;								// Side of the RSM level read back.
+		int rsmSide;							// Side of the base level.
+		vector<Region> regions;					// Lights' squares of the atlas, at the base level.
+	};
+
+	struct Job									// Readback handed to the builder thread.
+	{
+		int side;
+		int rsmSide;
+		vector<Region> regions;
+		vector<float> pixels;					// Flux + weight, positions, normals (RGBA32F each).
+	};
+
+	struct VPL
+	{
+		float position[3];
+		float normal[3];
+		float power[3];							// Flux times the texel area, divided by the sampling probability.
+	};
+
+	Slot slots[RING_SIZE];
+	int oldest = 0;								// Oldest slot in flight.
+	int inFlight = 0;
+
+	GLuint ubo = 0;								// Cluster positions (+ radius), normals, and power.
+	int clusterCount = 0;
+	bool hasClusters = false;					// Whether any readback has been processed.
+	double cpuMilliseconds = 0;					// Time spent sampling and clustering in the last rebuild.
+
+	// Builder thread state: only the builder and the assignment workers touch it.
+	mt19937 generator;
+	vector<VPL> vpls;
+	vector<int> assignment;						// Cluster index of every VPL.
+	vector<float> centers;						// Cluster centers: position and normal, 6 floats each.
+
+	// Threads and what they share (guarded by mutex).
+	thread builder;
+	vector<thread> workers;						// Assignment workers; the builder takes the first range itself.
+	mutex lock;
+	condition_variable changed;
+	bool stopping = false;
+	Job job;									// Latest readback not yet taken by the builder.
+	bool jobPending = false;
+	bool building = false;						// Whether the builder is working on a readback.
+	vector<float> builtData;					// Clusters of the last rebuild not yet uploaded (std140 layout).
+	int builtCount = 0;
+	double builtMilliseconds = 0;
+	bool built = false;
+	unsigned assignGeneration = 0;				// Bumped for every assignment step.
+	int assignPending = 0;						// Workers still running the current assignment step.
+	int assignClusters = 0;
+
+	void collect( bool wait );
+	void publish( bool wait );
+	void builderLoop();
+	void workerLoop( int worker, int workerCount );
+	void build( const Job& job, vector<float>& data, int& count );
+	void assign( int begin, int end, int k );
+
+public:
+	void init();
+	void update( GLuint flux, GLuint position, GLuint normal, int rsmSide, const vector<Region>& regions, bool rsmChanged );
+	int getClusterCount() const;
+	double getCPUMilliseconds() const;
+	void destroy();
+};
+
+#endif /* VPLExtractor_h */
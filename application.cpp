@@ -3,17 +3,21 @@
  */
 
 #include <iostream>
+#include <fstream>
 #include <armadillo>
-#include <OpenGL/gl3.h>
+#include "OpenGLHeaders.h"
 #include <string>
-#include <random>
 #include "GLFW/glfw3.h"
 #include "ArcBall/Ball.h"
 #include "OpenGL.h"
 #include "Transformations.h"
+#include "Renderer.h"
+#include "FrameStats.h"
+#include "GPUTimer.h"
+#include "Benchmark.h"
+#include "FrameCapture.h"
 
 using namespace std;
-using namespace std::chrono;
 using namespace arma;
 
 // Perspective projection matrix.
@@ -32,8 +36,7 @@ bool gLocked;							// Track if mouse button is pressed down.
 bool gUsingArrowKey;					// Track if we are using the arrow keys for rotating scene.
 bool gRotatingLights;					// Enable/disable rotating lights about the scene.
 bool gRotatingCamera;					// Enable/disable rotating camera.
-bool gEnableSSAO;						// Enable use of screen space ambient occlusion.
-bool gEnableRSM;
+bool gShowFrameStats;					// Show frame-time percentiles and graph on screen.
 float gZoom;							// Camera zoom.
 const float ZOOM_IN = 1.015;
 const float ZOOM_OUT = 0.985;
@@ -47,31 +50,70 @@ float gRetinaRatio;						// How many screen dots exist per OpenGL pixel.
 OpenGL ogl;								// Initialize application OpenGL.
 
 // Lights.
-Light gLight;							// Light source object.
+vector<Light> gLights;					// Shadow-casting light sources (created by the renderer).
 
-// Frame rate variables and functions.
-static const int NUM_FPS_SAMPLES = 64;
-float gFpsSamples[NUM_FPS_SAMPLES];
-unsigned char gCurrentSample = 0;		// Should start storing from gCurrentSample >= 1.
+Renderer gRenderer;						// Deferred rendering pipeline.
+
+// Frame-time statistics.
+FrameStats gFrameStats;					// CPU/GPU frame-time recorder.
+GPUTimer gFrameGPUTimer;				// Measures the GPU time of whole frames.
+const size_t GRAPH_FRAMES = 120;		// Number of frames plotted in the frame-time graph.
+const float GRAPH_MIN_MS = 1000.0f / 30.0f;	// Frame time mapped to the top of the graph (raised if frames get slower).
+
+// Frame capture.
+FrameCapture gCapture;					// Asynchronous recorder of the rendered frames.
+string gCapturePath;					// File name prefix (PNG sequence) or file name (Y4M video).
+FrameCapture::Format gCaptureFormat;
+
+// Benchmark mode.
+Benchmark gBenchmark;					// Scripted timeline and recorded times.
+bool gBenchmarking;						// Whether the benchmark drives the scene instead of the user.
 
 /**
- * Calculate the number of frames per second using a window.
- * @param dt Amount of seconds for current frame.
- * @return Frames per second.
+ * Render frame-time statistics and graph with the glyph atlas.
+ * Expects the glyphs program to be in use and blending enabled.
+ * @param color Text and graph color.
  */
-float calculateFPS( float dt )
+void renderFrameStats( const float* color )
 {
-	gCurrentSample++;
-	gCurrentSample = static_cast<unsigned char>( max( 1, static_cast<int>( gCurrentSample ) ) );
-	if( dt <= 0 )
-		cout << "error" << endl;
-	gFpsSamples[(gCurrentSample - 1) % NUM_FPS_SAMPLES] = 1.0f / dt;
-	float fps = 0;
-	int i = 0;
-	for( i = 0; i < min( NUM_FPS_SAMPLES, static_cast<int>( gCurrentSample ) ); i++ )
-		fps += gFpsSamples[i];
-	fps /= i;
-	return fps;
+	const float hitchColor[] = { 1.0, 0.25, 0.25, 0.9 };
+	const auto sx = static_cast<float>( gTextScaleX * 0.45 );
+	const auto sy = static_cast<float>( gTextScaleY * 0.45 );
+	char text[128];
+
+	FrameStats::Summary frame = gFrameStats.summarize( FrameStats::FRAME );
+	FrameStats::Summary gpu = gFrameStats.summarize( FrameStats::GPU );
+
+	sprintf( text, "Frame p50 %.2f p95 %.2f p99 %.2f max %.2f ms", frame.p50, frame.p95, frame.p99, frame.max );
+	ogl.renderText( text, ogl.atlas48, -1 + 10 * gTextScaleX, 1 - 55 * gTextScaleY, sx, sy, color );
+	sprintf( text, "GPU   p50 %.2f p95 %.2f p99 %.2f max %.2f ms", gpu.p50, gpu.p95, gpu.p99, gpu.max );
+	ogl.renderText( text, ogl.atlas48, -1 + 10 * gTextScaleX, 1 - 80 * gTextScaleY, sx, sy, color );
+	sprintf( text, "Var %.3f ms^2  Hitches %lu  Render %dx%d", frame.variance, gFrameStats.getTotalHitches(),
+			 gRenderer.getRenderWidth(), gRenderer.getRenderHeight() );
+	ogl.renderText( text, ogl.atlas48, -1 + 10 * gTextScaleX, 1 - 105 * gTextScaleY, sx, sy, color );
+
+	// Frame-time graph at the bottom left corner: hitches are drawn again on top in a different color.
+	vector<float> values, hitches;
+	gFrameStats.getGraph( GRAPH_FRAMES, values, hitches );
+	const auto graphMax = static_cast<float>( max( static_cast<double>( GRAPH_MIN_MS ), ceil( frame.p99 ) ) );
+	const float x = -1 + 10 * gTextScaleX, y = -1 + 10 * gTextScaleY;
+	const float w = 480 * gTextScaleX, h = 120 * gTextScaleY;
+	ogl.renderBars( values, graphMax, ogl.atlas48, x, y, w, h, color );
+	ogl.renderBars( hitches, graphMax, ogl.atlas48, x, y, w, h, hitchColor );
+
+	sprintf( text, "%.0f ms", graphMax );
+	ogl.renderText( text, ogl.atlas48, x + w + 5 * gTextScaleX, y + h - 15 * gTextScaleY, sx, sy, color );
+}
+
+/**
+ * Start or stop recording the rendered frames.
+ */
+void toggleCapture()
+{
+	if( gCapture.isActive() )
+		gCapture.stop();
+	else if( gCapture.start( fbWidth, fbHeight, gCaptureFormat, gCapturePath ) )
+		cout << "[!] Capturing frames into " << gCapturePath << endl;
 }
 
 /**
@@ -164,19 +206,82 @@ void keyCallback( GLFWwindow* window, int key, int scancode, int action, int mod
 				gRotatingCamera = !gRotatingCamera;
 			break;
 		case GLFW_KEY_O:
-			gEnableSSAO = !gEnableSSAO;
-			if( gEnableSSAO )
+			gRenderer.enableSSAO = !gRenderer.enableSSAO;
+			if( gRenderer.enableSSAO )
 				cout << "[!] SSAO enabled" << endl;
 			else
 				cout << "[!] SSAO disabled" << endl;
 			break;
 		case GLFW_KEY_I:
-			gEnableRSM = !gEnableRSM;
-			if( gEnableRSM )
+			gRenderer.enableRSM = !gRenderer.enableRSM;
+			if( gRenderer.enableRSM )
 				cout << "[!] RSM enabled" << endl;
 			else
 				cout << "[!] RSM disabled" << endl;
 			break;
+		case GLFW_KEY_K:
+		{
+			int factor = ( gRenderer.getSSAODownsampling() < 4 )? 2 * gRenderer.getSSAODownsampling() : 1;
+			gRenderer.setSSAODownsampling( factor );
+			if( factor > 1 )
+				cout << "[!] SSAO at 1/" << factor * factor << " resolution" << endl;
+			else
+				cout << "[!] SSAO at full resolution" << endl;
+			break;
+		}
+		case GLFW_KEY_G:
+		{
+			int factor = ( gRenderer.getIndirectDownsampling() < 4 )? 2 * gRenderer.getIndirectDownsampling() : 1;
+			gRenderer.setIndirectDownsampling( factor );
+			if( factor > 1 )
+				cout << "[!] RSM indirect lighting at 1/" << factor * factor << " resolution" << endl;
+			else
+				cout << "[!] RSM indirect lighting at full resolution" << endl;
+			break;
+		}
+		case GLFW_KEY_N:
+			gRenderer.setIndirectInterleave( ( gRenderer.getIndirectInterleave() > 1 )? 1 : Renderer::DEFAULT_INTERLEAVE );
+			if( gRenderer.getIndirectInterleave() > 1 )
+				cout << "[!] RSM interleaved sampling enabled" << endl;
+			else
+				cout << "[!] RSM interleaved sampling disabled" << endl;
+			break;
+		case GLFW_KEY_H:
+			gRenderer.rsmGather = static_cast<Renderer::RSMGather>( ( gRenderer.rsmGather + 1 ) % Renderer::GATHER_COUNT );
+			cout << "[!] RSM indirect lighting gathering: " << Renderer::RSM_GATHER_NAMES[gRenderer.rsmGather] << endl;
+			break;
+		case GLFW_KEY_S:
+			gRenderer.shadowMode = static_cast<Renderer::ShadowMode>( ( gRenderer.shadowMode + 1 ) % Renderer::SHADOW_MODE_COUNT );
+			cout << "[!] Shadows: " << Renderer::SHADOW_MODE_NAMES[gRenderer.shadowMode] << endl;
+			break;
+		case GLFW_KEY_A:
+			gRenderer.aoMethod = static_cast<Renderer::AOMethod>( ( gRenderer.aoMethod + 1 ) % Renderer::AO_METHOD_COUNT );
+			cout << "[!] Ambient occlusion: " << Renderer::AO_METHOD_NAMES[gRenderer.aoMethod] << endl;
+			break;
+		case GLFW_KEY_B:
+			gRenderer.ssaoBlur = static_cast<Renderer::SSAOBlur>( ( gRenderer.ssaoBlur + 1 ) % Renderer::SSAO_BLUR_COUNT );
+			cout << "[!] SSAO blur: " << Renderer::SSAO_BLUR_NAMES[gRenderer.ssaoBlur] << endl;
+			break;
+		case GLFW_KEY_D:
+			gRenderer.enableDepthMips = !gRenderer.enableDepthMips;
+			if( gRenderer.enableDepthMips )
+				cout << "[!] Linear depth mips enabled" << endl;
+			else
+				cout << "[!] Linear depth mips disabled" << endl;
+			break;
+		case GLFW_KEY_T:
+			gRenderer.enableTemporal = !gRenderer.enableTemporal;
+			if( gRenderer.enableTemporal )
+				cout << "[!] Temporal accumulation enabled" << endl;
+			else
+				cout << "[!] Temporal accumulation disabled" << endl;
+			break;
+		case GLFW_KEY_F:
+			gShowFrameStats = !gShowFrameStats;
+			break;
+		case GLFW_KEY_V:
+			toggleCapture();
+			break;
 		default: return;
 	}
 }
@@ -260,6 +365,8 @@ void resizeCallback( GLFWwindow* window, int w, int h )
 {
 	fbWidth = w;		// w and h are width and height of framebuffer, not window.
 	fbHeight = h;
+	if( w == 0 || h == 0 )								// Minimized.
+		return;
 
 	//Proj = Tx::frustrum( -0.5, 0.5, -0.5, 0.5, 1.0, 100 );
 
@@ -274,50 +381,161 @@ void resizeCallback( GLFWwindow* window, int w, int h )
 	gTextScaleY = 1.0f / windowH;
 }
 
-/**
- * Render the scene.
- * @param Projection The 4x4 projection matrix to use.
- * @param View The 4x4 view matrix.
- * @param Model Any previously built 4x4 model matrix (usually containing current zoom and scene rotation as provided by arcball).
- * @param currentTime Current step.
- */
-void renderScene( const mat44& Projection, const mat44& View, const mat44& Model, double currentTime )
-{
-	// Statue.
-	ogl.setColor( 0.65, 0.65, 0.65, 1.0, -1.0f );
-	ogl.render3DObject( Projection, View, Model * Tx::translate( -0.5, 0.0, -2.0 ) * Tx::rotate( 5.0 * M_PI / 4.0, Tx::Y_AXIS ) * Tx::scale( 1.35 ), "mercury" );
-
-	// Left wall.
-	ogl.setColor( 0.8941, 0.0, 0.4862, 1.0, -1.0f );
-	ogl.drawCube( Projection, View, Model * Tx::rotate( -M_PI / 4.0, Tx::Y_AXIS ) * Tx::translate( -3.0, 3.0, 0.0 ) * Tx::scale( 0.05, 12.0, 12.0 ) );
-
-	// Right wall.
-	ogl.setColor( 0.06274, 0.5843, 0.8941, 1.0, -1.0f );
-	ogl.drawCube( Projection, View, Model * Tx::rotate( M_PI / 4.0, Tx::Y_AXIS ) * Tx::translate( 3.0, 3.0, 0.0 ) * Tx::scale( 0.05, 12.0, 12.0 ) );
-	
-	// Bottom wall.
-	ogl.setColor( 1.0, 1.0, 0.0, 1.0, -1.0f );
-	ogl.drawCube( Projection, View, Model * Tx::translate( 0.0, -0.025, 0.0 ) * Tx::rotate( M_PI / 4.0, Tx::Y_AXIS ) * Tx::scale( 12.0, 0.05, 12.0 ) );
-}
-
 /**
  * Application main function.
  * @param argc Number of input arguments.
- * @param argv Input arguments.
+ * @param argv Input arguments: --histogram <file> dumps the frame-time histogram to file on exit; --benchmark <file> runs the
+ * scripted benchmark and writes its results to a JSON file, with optional --timeline <file>, --frames <n>, --seed <n>, and
+ * --label <text>; --capture <path> records frames from the start, as a PNG sequence or, with --capture-format y4m, as a
+ * Y4M video; --ao <ssao|gtao> chooses the ambient occlusion method; --ssao-downsampling <1|2|4> generates SSAO once
+ * per factor x factor pixels; --ssao-blur <box|bilateral> chooses the SSAO denoising filter, and --ssao-blur-radius <n>
+ * the bilateral blur radius; --depth-mips 1 reads farther AO samples from coarser linear depth levels;
+ * --rsm-downsampling <1|2|4> evaluates RSM indirect lighting once per factor x factor pixels;
+ * --rsm-interleave <n> splits the RSM samples among the pixels of n x n tiles; --temporal 1 accumulates SSAO and RSM over
+ * frames;
+ * --rsm-format <float32|rgb10a2|r11g11b10f> chooses the RSM storage; --rsm-resolution <n> sets the RSM texture side;
+ * --rsm-gather <disk|hierarchical|vpl> chooses how RSM indirect lighting is gathered; --rsm-cache 0 renders the RSM every
+ * frame, even when neither the lights nor the scene change; --lights <n> casts shadows and RSMs from n lights (up to 4)
+ * sharing an atlas; --shadows <pcss|vsm> chooses how direct shadows are filtered;
+ * --rsm-samples, --pcss-samples, and --ssao-samples <n> set the sample set sizes (151, 33, and 48); --render-scale <s>
+ * renders at a fraction of the window resolution and upscales; --frame-budget <ms> adjusts that fraction to hold a GPU
+ * time per frame, down to --min-render-scale <s>.
  * @return Exit code.
  */
 int main( int argc, const char * argv[] )
 {
-	gPointOfInterest = { 0, 3, 0 };		// Camera controls globals.
-	gEye = { 5, 5, 5 };
+	string histogramFilename;
+	string benchmarkFilename, benchmarkLabel;
+	bool captureFromStart = false;
+	int ssaoDownsampling = 1;
+	int indirectDownsampling = 1;
+	int indirectInterleave = 1;
+	Renderer::RSMFormat rsmFormat = Renderer::RSM_FLOAT32;
+	int rsmResolution = 0;
+	double renderScale = 1, frameBudget = 0, minRenderScale = DynamicResolution::DEFAULT_MIN_SCALE;
+	gBenchmarking = false;
+	gCaptureFormat = FrameCapture::PNG_SEQUENCE;
+	for( int i = 1; i < argc; i++ )
+	{
+		string arg = argv[i];
+		if( i + 1 >= argc )
+			cerr << "Ignoring argument " << arg << endl;
+		else if( arg == "--histogram" )
+			histogramFilename = argv[++i];
+		else if( arg == "--benchmark" )
+		{
+			benchmarkFilename = argv[++i];
+			gBenchmarking = true;
+		}
+		else if( arg == "--timeline" )
+		{
+			if( !gBenchmark.loadTimeline( argv[++i] ) )
+				exit( EXIT_FAILURE );
+		}
+		else if( arg == "--frames" )
+			gBenchmark.setFrames( atoi( argv[++i] ) );
+		else if( arg == "--seed" )
+			gBenchmark.setSeed( atoi( argv[++i] ) );
+		else if( arg == "--label" )
+			benchmarkLabel = argv[++i];
+		else if( arg == "--capture" )
+		{
+			gCapturePath = argv[++i];
+			captureFromStart = true;
+		}
+		else if( arg == "--capture-format" )
+		{
+			gCaptureFormat = FrameCapture::formatFromName( argv[++i] );
+			if( gCaptureFormat == FrameCapture::FORMAT_COUNT )	// Recording to the wrong format would go unnoticed.
+			{
+				cerr << "Unknown capture format " << argv[i] << endl;
+				exit( EXIT_FAILURE );
+			}
+		}
+		else if( arg == "--ssao-downsampling" )
+			ssaoDownsampling = atoi( argv[++i] );
+		else if( arg == "--rsm-downsampling" )
+			indirectDownsampling = atoi( argv[++i] );
+		else if( arg == "--rsm-interleave" )
+			indirectInterleave = atoi( argv[++i] );
+		else if( arg == "--temporal" )
+			gRenderer.enableTemporal = atoi( argv[++i] ) != 0;
+		else if( arg == "--rsm-gather" )
+		{
+			Renderer::RSMGather gather = Renderer::rsmGatherFromName( argv[++i] );
+			if( gather == Renderer::GATHER_COUNT )
+				cerr << "Ignoring unknown RSM gathering method " << argv[i] << endl;
+			else
+				gRenderer.rsmGather = gather;
+		}
+		else if( arg == "--rsm-format" )
+		{
+			rsmFormat = Renderer::rsmFormatFromName( argv[++i] );
+			if( rsmFormat == Renderer::RSM_FORMAT_COUNT )
+			{
+				cerr << "Ignoring unknown RSM format " << argv[i] << endl;
+				rsmFormat = Renderer::RSM_FLOAT32;
+			}
+		}
+		else if( arg == "--rsm-resolution" )
+			rsmResolution = atoi( argv[++i] );
+		else if( arg == "--lights" )
+			gRenderer.lightCount = atoi( argv[++i] );
+		else if( arg == "--rsm-cache" )
+			gRenderer.enableRSMCache = atoi( argv[++i] ) != 0;
+		else if( arg == "--render-scale" )
+			renderScale = atof( argv[++i] );
+		else if( arg == "--frame-budget" )
+			frameBudget = atof( argv[++i] );
+		else if( arg == "--min-render-scale" )
+			minRenderScale = atof( argv[++i] );
+		else if( arg == "--rsm-samples" )
+			gRenderer.rsmSampleCount = max( atoi( argv[++i] ), 1 );
+		else if( arg == "--pcss-samples" )
+			gRenderer.pcssSampleCount = max( atoi( argv[++i] ), 1 );
+		else if( arg == "--ssao-samples" )
+			gRenderer.ssaoKernelSize = max( atoi( argv[++i] ), 1 );
+		else if( arg == "--depth-mips" )
+			gRenderer.enableDepthMips = atoi( argv[++i] ) != 0;
+		else if( arg == "--ao" )
+		{
+			Renderer::AOMethod method = Renderer::aoMethodFromName( argv[++i] );
+			if( method == Renderer::AO_METHOD_COUNT )
+				cerr << "Ignoring unknown ambient occlusion method " << argv[i] << endl;
+			else
+				gRenderer.aoMethod = method;
+		}
+		else if( arg == "--ssao-blur" )
+		{
+			Renderer::SSAOBlur blur = Renderer::ssaoBlurFromName( argv[++i] );
+			if( blur == Renderer::SSAO_BLUR_COUNT )
+				cerr << "Ignoring unknown SSAO blur " << argv[i] << endl;
+			else
+				gRenderer.ssaoBlur = blur;
+		}
+		else if( arg == "--ssao-blur-radius" )
+			gRenderer.ssaoBlurRadius = atoi( argv[++i] );
+		else if( arg == "--shadows" )
+		{
+			Renderer::ShadowMode mode = Renderer::shadowModeFromName( argv[++i] );
+			if( mode == Renderer::SHADOW_MODE_COUNT )
+				cerr << "Ignoring unknown shadow mode " << argv[i] << endl;
+			else
+				gRenderer.shadowMode = mode;
+		}
+		else
+			cerr << "Ignoring unknown argument " << arg << endl;
+	}
+
+	gPointOfInterest = Renderer::POINT_OF_INTEREST;		// Camera controls globals.
+	gEye = Renderer::DEFAULT_EYE;
 	gUp = Tx::Y_AXIS;
 	
 	gLocked = false;					// Track if mouse button is pressed down.
 	gRotatingLights = false;			// Start with still lights.
 	gRotatingCamera = false;
 	gUsingArrowKey = false;				// Track pressing action of arrow keys.
-	gEnableSSAO = true;
-	gEnableRSM = false;
+	gShowFrameStats = true;
 	gZoom = 1.0;						// Camera zoom.
 	
 	GLFWwindow* window;
@@ -332,7 +550,7 @@ int main( int argc, const char * argv[] )
 	glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 1 );
 	glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
 	glfwWindowHint( GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE );
-	glfwWindowHint( GLFW_RESIZABLE, false );
+	glfwWindowHint( GLFW_RESIZABLE, !gBenchmarking );			// Benchmarks run at a fixed size.
 	
 	cout << glfwGetVersionString() << endl;
 
@@ -348,14 +566,17 @@ int main( int argc, const char * argv[] )
 	}
 	
 	glfwMakeContextCurrent( window );
-	glfwSwapInterval( 1 );
+	glfwSwapInterval( gBenchmarking? 0 : 1 );					// Benchmarks shouldn't be capped by vertical sync.
 	
-	// Hook up callbacks.
+	// Hook up callbacks.  While benchmarking, user input is ignored so that every run is the same.
 	glfwSetFramebufferSizeCallback( window, resizeCallback );
-	glfwSetKeyCallback( window, keyCallback );
-	glfwSetMouseButtonCallback( window, mouseButtonCallback );
-	glfwSetCursorPosCallback( window, mousePositionCallback );
-	glfwSetScrollCallback( window, mouseScrollCallback );
+	if( !gBenchmarking )
+	{
+		glfwSetKeyCallback( window, keyCallback );
+		glfwSetMouseButtonCallback( window, mouseButtonCallback );
+		glfwSetCursorPosCallback( window, mousePositionCallback );
+		glfwSetScrollCallback( window, mouseScrollCallback );
+	}
 
 	// Initialize projection matrices and viewport.
 	glfwGetFramebufferSize( window, &fbWidth, &fbHeight );
@@ -363,319 +584,75 @@ int main( int argc, const char * argv[] )
 	cout << "Retina pixel ratio: " << gRetinaRatio << endl;
 	resizeCallback( window, fbWidth, fbHeight );
 	
+	if( gCapturePath.empty() )
+		gCapturePath = ( gCaptureFormat == FrameCapture::Y4M )? "capture.y4m" : "capture";
+
 	gArcBall = new BallData;						// Initialize arcball.
 	resetArcBall();
 	
-	///////////////////////////////////// Intialize OpenGL and rendering shaders ///////////////////////////////////////
+	///////////////////////////////////// Intialize OpenGL and rendering pipeline //////////////////////////////////////
 	
 	ogl.init();
-	
-	// Compile shaders for geom/sequence drawing program.
-	cout << "Compiling rendering shaders... ";
-	Shaders shaders;
-	GLuint renderingProgram = shaders.compile( conf::SHADERS_FOLDER + "render.vert", conf::SHADERS_FOLDER + "render.frag" );
-	cout << "Done!" << endl;
-	
-	// Compile shaders program for reflective shadow maps.
-	cout << "Compiling reflective shadow maps generator shaders... ";
-	GLuint generateRSMProgram = shaders.compile( conf::SHADERS_FOLDER + "generateRSM.vert", conf::SHADERS_FOLDER + "generateRSM.frag" );
-	cout << "Done!" << endl;
-
-	// Compile shaders program for G-buffer.
-	cout << "Compiling G-Buffer generator shaders... ";
-	GLuint generateGBufferProgram = shaders.compile( conf::SHADERS_FOLDER + "generateGBuffer.vert", conf::SHADERS_FOLDER + "generateGBuffer.frag" );
-	cout << "Done!" << endl;
-
-	// Compile shaders program to generate the SSAO texture.
-	cout << "Compiling SSAO generator shaders... ";
-	GLuint generateSSAOProgram = shaders.compile( conf::SHADERS_FOLDER + "generateSSAO.vert", conf::SHADERS_FOLDER + "generateSSAO.frag" );
-	cout << "Done!" << endl;
-
-	// Compile shaders program to blur the SSAO texture. Notice we use the same vertex shader than in the generator case.
-	cout << "Compiling SSAO blur shaders... ";
-	GLuint blurSSAOProgram = shaders.compile( conf::SHADERS_FOLDER + "generateSSAO.vert", conf::SHADERS_FOLDER + "blurSSAO.frag" );
-	cout << "Done!" << endl;
-	
-	//////////////////////////////////////////////// Create lights /////////////////////////////////////////////////////
-	
-	float lNearPlane = 0.01f, lFarPlane = 50.0f;								// Setting up the light projection matrix.
-	float lSide = 20.0f;
-	mat44 LightProjection = Tx::ortographic( -lSide, lSide, -lSide, lSide, lNearPlane, lFarPlane );
-
-	const double lRadius = 4.0;
-	const double phi = 0.0;
-	const float lHeight = 5.0;
-	const float lRGB[3] = { 0.85, 0.85, 0.85 };
-	gLight = Light( { lRadius * sin( phi ), lHeight, lRadius * cos( phi ) }, { lRGB[0], lRGB[1], lRGB[2] }, LightProjection );
-	
-	/////////////////////////////////////// Setting up reflective shadow map ///////////////////////////////////////////
-	
-	const auto RSM_SIDE_LENGTH = static_cast<GLuint>( max(fbWidth, fbHeight) );	// Texture size.
-	float whiteColor[] = { 1.0, 1.0, 1.0, 1.0 };								// Depth = 1.0.  So the rendering of the normal scene will produce something larger than this.
-	float blackColor[] = { 0, 0, 0, 0 };										// Position = normal = color = 0.
-
-	glGenFramebuffers( 1, &(gLight.rsmFBO) );									// All information is kept in the Light object.
-	glBindFramebuffer( GL_FRAMEBUFFER, gLight.rsmFBO );
-
-	// Positions color buffer.
-	glGenTextures( 1, &(gLight.rsmPosition) );
-	glBindTexture( GL_TEXTURE_2D, gLight.rsmPosition );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F, RSM_SIDE_LENGTH, RSM_SIDE_LENGTH, 0, GL_RGB, GL_FLOAT, nullptr );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
-	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, blackColor );		// Non comparison sampler beyond borders of light space.
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gLight.rsmPosition, 0 );	// Attached to layout 0.
-
-	// Normals color buffer.
-	glGenTextures( 1, &(gLight.rsmNormal) );
-	glBindTexture( GL_TEXTURE_2D, gLight.rsmNormal );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F, RSM_SIDE_LENGTH, RSM_SIDE_LENGTH, 0, GL_RGB, GL_FLOAT, nullptr );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
-	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, blackColor );		// Non comparison sampler beyond borders of light space.
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gLight.rsmNormal, 0 );		// Attached to layout 1.
-
-	// Flux color buffer.
-	glGenTextures( 1, &(gLight.rsmFlux) );
-	glBindTexture( GL_TEXTURE_2D, gLight.rsmFlux );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F, RSM_SIDE_LENGTH, RSM_SIDE_LENGTH, 0, GL_RGB, GL_FLOAT, nullptr );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
-	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, blackColor );		// Non comparison sampler beyond borders of light space.
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gLight.rsmFlux, 0 );		// Attached to layout 2.
-
-	// Depth buffer.
-	glGenTextures( 1, &(gLight.rsmDepth) );
-	glBindTexture( GL_TEXTURE_2D, gLight.rsmDepth );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, RSM_SIDE_LENGTH, RSM_SIDE_LENGTH, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );	// By doing this, anything farther than the shadow map will appear in light.
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
-	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, whiteColor );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gLight.rsmDepth, 0 );			// There's only at most one depth attachment/buffer.
-
-	// Tell OpenGL which color attachments will be used.
-	GLuint attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-	glDrawBuffers( 3, attachments );
-
-	glBindFramebuffer( GL_FRAMEBUFFER, 0 );										// Unbind.
-
-	// Set uniforms in rendering program.
-	glUseProgram( renderingProgram );
-	glUniform1i( glGetUniformLocation( renderingProgram, "sRSMPosition" ), 0 );	// Reflective shadow map samplers begin at texture unit 0.
-	glUniform1i( glGetUniformLocation( renderingProgram, "sRSMNormal" ), 1 );
-	glUniform1i( glGetUniformLocation( renderingProgram, "sRSMFlux" ), 2 );
-	glUniform1i( glGetUniformLocation( renderingProgram, "sRSMDepth" ), 3 );
-
-	////////////////////////////////// Generating random samples in a unit disk ////////////////////////////////////////
-
-	vector<float> rsmSamples;
-	const auto N_SAMPLES = Tx::loadArrayOfVec2( string( conf::RESOURCES_FOLDER + "random/poisson151.csv" ).c_str(), rsmSamples );
-
-	// Send samples to rendering fragment shader.
-	glUseProgram( renderingProgram );
-	glUniform2fv( glGetUniformLocation( renderingProgram, "RSMSamplePositions" ), static_cast<int>( N_SAMPLES ), rsmSamples.data() );
-
-	////////////////////////////////// Setting up deferred rendering in a G-Buffer /////////////////////////////////////
-
-	GLuint gBuffer;
-	glGenFramebuffers( 1, &gBuffer );
-	glBindFramebuffer( GL_FRAMEBUFFER, gBuffer );
-	GLuint gPosition, gNormal, gAlbedoSpecular;						// Texture IDs for different targets of G-Buffer.
-	GLuint gPosLightSpace;											// This one in particular sends the position in projective light space + use Phong shading flag.
-	GLuint gDepth;													// Depth buffer.
-
-	// World space position color buffer.
-	glGenTextures( 1, &gPosition );
-	glBindTexture( GL_TEXTURE_2D, gPosition );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F, fbWidth, fbHeight, 0, GL_RGB, GL_FLOAT, nullptr );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );								// Don't want to query fragments beyond border.
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0 );		// Attachment 0.
-
-	// World space normal color buffer.
-	glGenTextures( 1, &gNormal );
-	glBindTexture( GL_TEXTURE_2D, gNormal );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F, fbWidth, fbHeight, 0, GL_RGB, GL_FLOAT, nullptr );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0 );			// Attachment 1.
-
-	// RGB diffuse color and specular color buffer.
-	glGenTextures( 1, &gAlbedoSpecular );
-	glBindTexture( GL_TEXTURE_2D, gAlbedoSpecular );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA16F, fbWidth, fbHeight, 0, GL_RGBA, GL_FLOAT, nullptr );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpecular, 0 );	// Attachment 2.
-
-	// Position in Light Space + Using Blinn-Phong flag color buffer.
-	glGenTextures( 1, &gPosLightSpace );
-	glBindTexture( GL_TEXTURE_2D, gPosLightSpace );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F, fbWidth, fbHeight, 0, GL_RGB, GL_FLOAT, nullptr );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, gPosLightSpace, 0 );	// Attachment 3.
-	
-	// Depth buffer.
-	glGenTextures( 1, &gDepth );
-	glBindTexture( GL_TEXTURE_2D, gDepth );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, fbWidth, fbHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );	// By doing this, anything farther than view space will be the farthest.
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
-	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, whiteColor );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0 );			// There's only at most one depth attachment/buffer.
-
-	// Tell OpenGL which color attachments we'll use (of this framebuffer) for rendering.
-	GLuint gAttachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
-	glDrawBuffers( 4, gAttachments );
-
-	// Check that the framebuffer is complete.
-	if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
-		cerr << "[Deferred Rendering] Framebuffer not complete!" << endl;
-	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-
-	// Set uniform samplers in deferred rendering program.
-	glUseProgram( renderingProgram );
-	glUniform1i( glGetUniformLocation( renderingProgram, "sGPosition" ), 4 );							// G-Buffer samplers begin at texture unit 4.
-	glUniform1i( glGetUniformLocation( renderingProgram, "sGNormal" ), 5 );
-	glUniform1i( glGetUniformLocation( renderingProgram, "sGAlbedoSpecular" ), 6 );
-	glUniform1i( glGetUniformLocation( renderingProgram, "sGPosLightSpace" ), 7 );
-	glUniform1i( glGetUniformLocation( renderingProgram, "sGDepth" ), 8 );
-	glUniform1i( glGetUniformLocation( renderingProgram, "sSSAOFactor"), 9 );							// SSAO factor.
-
-	///////////////////////////// Setting up the SSAO generator buffer object textures /////////////////////////////////
-
-	GLuint ssaoFBO;
-	glGenFramebuffers( 1, &ssaoFBO );
-	glBindFramebuffer( GL_FRAMEBUFFER, ssaoFBO );
-	GLuint ssaoFactor;										// The texture that holds the occlusion factor.
-
-	glGenTextures( 1, &ssaoFactor );						// This is the only attachment (output) from SSAO generation stage.
-	glBindTexture( GL_TEXTURE_2D, ssaoFactor );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RED, windowWidth, windowHeight, 0, GL_RGB, GL_FLOAT, nullptr );			// Notice: only one channel.
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoFactor, 0 );		// Unique attachment.
-	if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
-		cerr << "[SSAO] Framebuffer not complete!" << endl;
-
-	// Generate samples to be used in the view-space normal hemisphere of a fragment.
-	std::random_device rd;											// Request random data from OS.
-	std::mt19937 generator( rd() );
-	uniform_real_distribution<float> uniform( 0, 1 );
-	
-	const int SSAO_KERNEL_SIZE = 48;
-	vector<float> ssaoKernel;
-	for( int i = 0; i < SSAO_KERNEL_SIZE; ++i)
-	{
-		vec3 sample = { uniform( generator ) * 2.0 - 1.0, uniform( generator ) * 2.0 - 1.0, uniform( generator ) };
-		sample = normalise( sample );
-		sample *= uniform( generator );
-		float scale = i / static_cast<float>( SSAO_KERNEL_SIZE );
-
-		// Concentrate samples more towards the center of the kernel.
-		scale = 0.1f + scale * scale * ( 1.0f - 0.1f );
-		sample *= scale;
-		ssaoKernel.push_back( sample[0] );
-		ssaoKernel.push_back( sample[1] );
-		ssaoKernel.push_back( sample[2] );
-	}
-
-	// Generate the MxM noise texture from where we'll draw random vectors in generateSSAO.frag shader.
-	const int SSAO_NOISE_SIZE = 4;
-	vector<float> ssaoNoise;
-	for( int i = 0; i < SSAO_NOISE_SIZE * SSAO_NOISE_SIZE; i++ )
-	{
-		vec3 noise = { uniform( generator ) * 2.0 - 1.0, uniform( generator ) * 2.0 - 1.0, 0.0 }; 		// Random unit vector on the x-y plane.
-		noise = normalise( noise );
-		ssaoNoise.push_back( noise[0] );
-		ssaoNoise.push_back( noise[1] );
-		ssaoNoise.push_back( noise[2] );
-	}
-
-	GLuint ssaoNoiseTexture;
-	glGenTextures( 1, &ssaoNoiseTexture );
-	glBindTexture( GL_TEXTURE_2D, ssaoNoiseTexture );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F, SSAO_NOISE_SIZE, SSAO_NOISE_SIZE, 0, GL_RGB, GL_FLOAT, ssaoNoise.data() );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );					// Set it to repeat pattern in rendered quad.
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
-
-	// Set uniforms in SSAO generation program.
-	glUseProgram( generateSSAOProgram );
-	glUniform1i( glGetUniformLocation( generateSSAOProgram, "sGPosition" ), 0 );	// Texture units begin at 0 in this case.
-	glUniform1i( glGetUniformLocation( generateSSAOProgram, "sGNormal" ), 1 );
-	glUniform1i( glGetUniformLocation( generateSSAOProgram, "sSSAONoiseTexture" ), 2 );
-	glUniform1f( glGetUniformLocation( generateSSAOProgram, "frameBufferWidth" ), windowWidth );							// Framebuffer width and height.
-	glUniform1f( glGetUniformLocation( generateSSAOProgram, "frameBufferHeight" ), windowHeight );
-	glUniform3fv( glGetUniformLocation( generateSSAOProgram, "ssaoSamples" ), SSAO_KERNEL_SIZE, ssaoKernel.data() );	// Kernel precomputed samples.
-	// Remains to send view and projection matrices below.
-
-	////////////////////////////// Setting up the SSAO blurring buffer object textures /////////////////////////////////
-
-	GLuint ssaoBlurFBO;
-	glGenFramebuffers( 1, &ssaoBlurFBO );
-	glBindFramebuffer( GL_FRAMEBUFFER, ssaoBlurFBO );
-	GLuint ssaoBlurFactor;									// The texture that holds the occlusion blurred factor.
-
-	glGenTextures( 1, &ssaoBlurFactor );					// This is the only attachment (output) from SSAO blurring stage.
-	glBindTexture( GL_TEXTURE_2D, ssaoBlurFactor );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RED, windowWidth, windowHeight, 0, GL_RGB, GL_FLOAT, nullptr );			// Notice: only one channel.
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoBlurFactor, 0 );	// Unique attachment.
-	if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
-		cerr << "[SSAOBlur] Framebuffer not complete!" << endl;
-
-	// Set uniforms in SSAO blur program.
-	glUseProgram( blurSSAOProgram );
-	glUniform1i( glGetUniformLocation( generateSSAOProgram, "sSSAOFactor" ), 0 );		// Sampler for SSAO factor texture.
+	gFrameGPUTimer.init();
+	gRenderer.setRSMFormat( rsmFormat );
+	gRenderer.setRSMResolution( rsmResolution );
+	gRenderer.init( &ogl, fbWidth, fbHeight, gLights, gBenchmarking? gBenchmark.getSeed() : -1 );	// Shaders, lights, render targets, and scene objects.
+	gRenderer.setSSAODownsampling( ssaoDownsampling );
+	gRenderer.setIndirectDownsampling( indirectDownsampling );
+	gRenderer.setIndirectInterleave( indirectInterleave );
+	if( frameBudget > 0 )
+		gRenderer.setFrameBudget( frameBudget, minRenderScale );
+	else
+		gRenderer.setRenderScale( renderScale );
+	if( captureFromStart )
+		toggleCapture();
 	
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	
-	double currentTime = 0.0;
-	const double timeStep = 0.01;
 	const float textColor[] = { 1.0, 1.0, 1.0, 0.7 };
 	char text[128];
 	
-	glEnable( GL_DEPTH_TEST );
-	glDepthFunc( GL_LEQUAL );
-	glFrontFace( GL_CCW );
-
-	ogl.setUsingUniformScaling( false );
-	ogl.create3DObject( "mercury", "mercury10.obj" );
-	
 	float eyeY = gEye[1];										// Build eye components from its intial value.
 	float eyeXZRadius = sqrt( gEye[0]*gEye[0] + gEye[2]*gEye[2] );
 	float eyeAngle = atan2( gEye[0], gEye[2] );
-	float eyePosition_vector[ELEMENTS_PER_VERTEX];				// Container for eye position sent to shaders.
-	float view_matrix[ELEMENTS_PER_MATRIX];						// Containers for view and projection matrices.
-	float proj_matrix[ELEMENTS_PER_MATRIX];
-
-	// Frame rate variables.
-	long gNewTicks, gOldTicks = duration_cast<milliseconds>( system_clock::now().time_since_epoch() ).count();
-	float transcurredTimePerFrame;
-	string FPS = "FPS: ";
 
 	// Rendering loop.
 	while( !glfwWindowShouldClose( window ) )
 	{
+		if( fbWidth == 0 || fbHeight == 0 )						// Minimized: nothing to render until the window is restored.
+		{
+			glfwWaitEvents();
+			continue;
+		}
+		if( fbWidth != gRenderer.getWidth() || fbHeight != gRenderer.getHeight() )
+		{
+			if( gCapture.isActive() )							// Captured frames keep the size they started with.
+			{
+				gCapture.stop();
+				cout << "[!] Frame capture stopped: the window was resized" << endl;
+			}
+			gRenderer.resize( fbWidth, fbHeight );		// Render targets follow the window lazily.
+		}
+
+		gFrameStats.beginFrame();
+		gFrameGPUTimer.begin( gBenchmark.getFrame() );
+		bool hasGPUTime = gFrameGPUTimer.hasNewResult();
+		if( hasGPUTime )										// GPU times arrive a few frames late.
+			gFrameStats.addGPUTime( gFrameGPUTimer.getMilliseconds() );
+
+		if( gBenchmarking )										// Scripted camera, light, and effect toggles.
+		{
+			const Benchmark::State& state = gBenchmark.beginFrame();
+			gRotatingCamera = state.rotatingCamera;
+			gRotatingLights = state.rotatingLights;
+			gRenderer.enableSSAO = state.enableSSAO;
+			gRenderer.enableRSM = state.enableRSM;
+			gRenderer.setIndirectInterleave( state.interleavedRSM? Renderer::DEFAULT_INTERLEAVE : 1 );
+			gRenderer.shadowMode = state.vsmShadows? Renderer::SHADOW_VSM : Renderer::SHADOW_PCSS;
+			gRenderer.aoMethod = state.gtao? Renderer::AO_GTAO : Renderer::AO_SSAO;
+		}
+
 		glClearColor( 0, 0, 0, 1 );
-		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-		glEnable( GL_CULL_FACE );
 		
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		
@@ -698,107 +675,13 @@ int main( int argc, const char * argv[] )
 		///////////////////////////////////////// Define new lights' positions /////////////////////////////////////////
 		
 		if( gRotatingLights )										// Check if rotating lights is enabled (with key 'L').
-			gLight.rotateBy( static_cast<float>( 0.01 * M_PI ) );
-
-		mat44 LightView = Tx::lookAt( gLight.position, gPointOfInterest, Tx::Y_AXIS );
-		gLight.SpaceMatrix = gLight.Projection * LightView;
-
-		////////////////////////////////// First pass: render scene to RSM textures ////////////////////////////////////
-
-		ogl.useProgram( generateRSMProgram );						// Now, create the reflective shadow map textures.
-		glViewport( 0, 0, RSM_SIDE_LENGTH, RSM_SIDE_LENGTH );
-		glBindFramebuffer( GL_FRAMEBUFFER, gLight.rsmFBO );
-		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-
-		ogl.setLighting( gLight, LightView );
-		renderScene( gLight.Projection, LightView, Model, currentTime );
-		glBindFramebuffer( GL_FRAMEBUFFER, 0 );						// Unbind: return control to normal draw framebuffer.
-
-		/////////////////////////////// Second pass: render scene to G-Buffer textures /////////////////////////////////
-
-		glViewport( 0, 0, fbWidth, fbHeight );
-		glBindFramebuffer( GL_FRAMEBUFFER, gBuffer );
-		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-		ogl.useProgram( generateGBufferProgram );
-		ogl.setLighting( gLight, Camera );							// Send light position and color.
-		renderScene( Proj, Camera, Model, currentTime );
-		glBindFramebuffer( GL_FRAMEBUFFER, 0 );						// Unbind: return control to normal draw framebuffer.
-
-		/////////////////////////////// Third pass: generate the SSAO occlusion factor /////////////////////////////////
+			for( Light& light : gLights )
+				light.rotateBy( static_cast<float>( 0.01 * M_PI ) );
 
-		if( gEnableSSAO )
-		{
-			glViewport( 0, 0, windowWidth, windowHeight );
-			glBindFramebuffer( GL_FRAMEBUFFER, ssaoFBO );
-			glClear( GL_COLOR_BUFFER_BIT );
-			ogl.useProgram( generateSSAOProgram );
-
-			// Enable G-buffer position and normal textures, and the noise texture.
-			glActiveTexture( GL_TEXTURE0 );
-			glBindTexture( GL_TEXTURE_2D, gPosition );				// Positions in world space.
-			glActiveTexture( GL_TEXTURE1 );
-			glBindTexture( GL_TEXTURE_2D, gNormal );				// Normals in world space.
-			glActiveTexture( GL_TEXTURE2 );
-			glBindTexture( GL_TEXTURE_2D, ssaoNoiseTexture );		// Noise texture sampler.
-
-			Tx::toOpenGLMatrix( view_matrix, Camera );				// Send View and Projection matrices.
-			Tx::toOpenGLMatrix( proj_matrix, Proj );
-			glUniformMatrix4fv( glGetUniformLocation( generateSSAOProgram, "View" ), 1, GL_FALSE, view_matrix );
-			glUniformMatrix4fv( glGetUniformLocation( generateSSAOProgram, "Projection" ), 1, GL_FALSE, proj_matrix );
-			ogl.renderNDCQuad();
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-			////////////////////////////// Fourth pass: blur the SSAO occlusion factor /////////////////////////////////
-
-			glBindFramebuffer( GL_FRAMEBUFFER, ssaoBlurFBO );
-			glClear( GL_COLOR_BUFFER_BIT );
-			ogl.useProgram( blurSSAOProgram );
-
-			// Enable SSAO occlusion texture filled at the previous pass.
-			glActiveTexture( GL_TEXTURE0 );
-			glBindTexture( GL_TEXTURE_2D, ssaoFactor );
-			ogl.renderNDCQuad();
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		}
+		///////////////////////////// RSM, G-buffer, SSAO, and lighting passes into the window /////////////////////////
 
-		///////////////////////// Fourth pass: lighting pass using G-buffer and RSM textures ///////////////////////////
-
-		glViewport( 0, 0, fbWidth, fbHeight );
-		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-		ogl.useProgram( renderingProgram );							// Using deferred rendering: shade scene.
-
-		// Enable reflective shadow map texture samplers.
-		glActiveTexture( GL_TEXTURE0 );								// Positions.
-		glBindTexture( GL_TEXTURE_2D, gLight.rsmPosition );
-		glActiveTexture( GL_TEXTURE1 );								// Normals.
-		glBindTexture( GL_TEXTURE_2D, gLight.rsmNormal );
-		glActiveTexture( GL_TEXTURE2 );								// Flux.
-		glBindTexture( GL_TEXTURE_2D, gLight.rsmFlux );
-		glActiveTexture( GL_TEXTURE3 );								// Depth.
-		glBindTexture( GL_TEXTURE_2D, gLight.rsmDepth );
-
-		// Enable G-Buffer textures.
-		glActiveTexture( GL_TEXTURE4 );
-		glBindTexture( GL_TEXTURE_2D, gPosition );					// Positions.
-		glActiveTexture( GL_TEXTURE5 );
-		glBindTexture( GL_TEXTURE_2D, gNormal );					// Normals.
-		glActiveTexture( GL_TEXTURE6 );
-		glBindTexture( GL_TEXTURE_2D, gAlbedoSpecular );			// Albedo + specular shininess.
-		glActiveTexture( GL_TEXTURE7 );
-		glBindTexture( GL_TEXTURE_2D, gPosLightSpace );				// Position in light projective space and flag for using Blinn-Phong reflectance model.
-		glActiveTexture( GL_TEXTURE8 );
-		glBindTexture( GL_TEXTURE_2D, gDepth );						// Depth buffer.
-
-		// Enable SSAO textures.
-		glActiveTexture( GL_TEXTURE9 );
-		glBindTexture( GL_TEXTURE_2D, ssaoBlurFactor );				// SSAO blurred factor texture.
-
-		ogl.setLighting( gLight, Camera, false );					// Send light properties (in world space).
-		Tx::toOpenGLMatrix( eyePosition_vector, gEye );
-		glUniform3fv( glGetUniformLocation( renderingProgram, "eyePosition" ), 1, eyePosition_vector );
-		glUniform1i( glGetUniformLocation( renderingProgram, "enableSSAO" ), gEnableSSAO );								// SSAO enabled?
-		glUniform1i( glGetUniformLocation( renderingProgram, "enableRSM" ), gEnableRSM );								// RSM enabled?
-		ogl.renderNDCQuad();										// Render lit scene into a unit NDC quad.
+		gRenderer.render( Proj, Camera, gEye, Model, gLights );
+		gCapture.capture( 0 );								// Grab the frame before the text overlay (if recording).
 
 		/////////////////////////////////////////////// Rendering text /////////////////////////////////////////////////
 
@@ -808,31 +691,54 @@ int main( int argc, const char * argv[] )
 		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 		glDisable( GL_CULL_FACE );
 
-		gNewTicks = duration_cast<milliseconds>( system_clock::now().time_since_epoch() ).count();
-		transcurredTimePerFrame = (gNewTicks - gOldTicks) / 1000.0f;
-		sprintf( text, "FPS: %.2f", ( ( transcurredTimePerFrame <= 0 )? -1 : calculateFPS( transcurredTimePerFrame ) ) );
-		gOldTicks = gNewTicks;
-
+		sprintf( text, "FPS: %.2f", gFrameStats.getFPS() );
 		ogl.renderText( text, ogl.atlas48, -1 + 10 * gTextScaleX, 1 - 30 * gTextScaleY, static_cast<float>( gTextScaleX * 0.6 ),
 						static_cast<float>( gTextScaleY * 0.6 ), textColor );
+		if( gShowFrameStats )
+			renderFrameStats( textColor );
+		if( gCapture.isActive() )
+		{
+			sprintf( text, "REC %lu frames, %lu dropped", gCapture.getCapturedFrames(), gCapture.getDroppedFrames() );
+			ogl.renderText( text, ogl.atlas48, 1 - 300 * gTextScaleX, 1 - 30 * gTextScaleY, static_cast<float>( gTextScaleX * 0.45 ),
+							static_cast<float>( gTextScaleY * 0.45 ), textColor );
+		}
 
 		glDisable( GL_BLEND );
 
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+		gFrameGPUTimer.end();
+		gFrameStats.endFrame();
+
+		if( gBenchmarking )
+		{
+			gBenchmark.endFrame( gFrameStats, gRenderer, hasGPUTime, gFrameGPUTimer.getMilliseconds(),
+								static_cast<int>( gFrameGPUTimer.getResultFrame() ) );
+			if( gBenchmark.isFinished() )
+				glfwSetWindowShouldClose( window, GL_TRUE );
+		}
 		
 		glfwSwapBuffers( window );
 		glfwPollEvents();
-		
-		currentTime += timeStep;
 	}
 	
+	// Report frame times: to file if requested, otherwise to the console.
+	ofstream histogramFile;
+	if( !histogramFilename.empty() )
+	{
+		histogramFile.open( histogramFilename );
+		if( !histogramFile.is_open() )
+			cerr << "Unable to open file " << histogramFilename << endl;
+	}
+	gFrameStats.dumpHistogram( histogramFile.is_open()? histogramFile : cout );
+	if( gBenchmarking && gBenchmark.writeJSON( benchmarkFilename, benchmarkLabel, fbWidth, fbHeight ) )
+		cout << "Benchmark results written to " << benchmarkFilename << endl;
+	gCapture.stop();
+	gFrameGPUTimer.destroy();
+	gRenderer.destroy();
+
 	glfwDestroyWindow( window );
 	glfwTerminate();
-	
-	// Delete OpenGL programs.
-	glDeleteProgram( renderingProgram );
-	glDeleteProgram( generateGBufferProgram );
-	glDeleteProgram( generateRSMProgram );
 
 	return 0;
 }
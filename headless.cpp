@@ -0,0 +1,417 @@
+/**
+ * Headless renderer: draws a scripted sequence of frames without a window and saves them as PNG files.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <armadillo>
+#include "OpenGLHeaders.h"
+#include <string>
+#include "HeadlessContext.h"
+#include "OpenGL.h"
+#include "Transformations.h"
+#include "Renderer.h"
+#include "FrameCapture.h"
+#include "FrameStats.h"
+#include "GPUTimer.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace arma;
+
+/**
+ * Parse a pair of comma-separated numbers such as "0,360".
+ * @param text Input text.
+ * @param first Receives the first number.
+ * @param second Receives the second number (equal to the first if there's a single number).
+ * @return True if at least one number was parsed, false otherwise.
+ */
+bool parseRange( const string& text, double& first, double& second )
+{
+	istringstream is( text );
+	char comma;
+	if( !( is >> first ) )
+		return false;
+	if( !( is >> comma >> second ) )
+		second = first;
+	return true;
+}
+
+/**
+ * Print usage information.
+ * @param program Executable name.
+ */
+void printUsage( const char* program )
+{
+	cout << "Usage: " << program << " [options]" << endl
+		 << "  --width <px>              Render width (768)" << endl
+		 << "  --height <px>             Render height (768)" << endl
+		 << "  --frames <n>              Number of frames to render (1, or " << Benchmark::DEFAULT_FRAMES << " when benchmarking)" << endl
+		 << "  --camera <from,to>        Camera orbit angle about the y-axis in degrees, interpolated across frames (45)" << endl
+		 << "  --light <from,to>         Light angle about the y-axis in degrees, interpolated across frames (0)" << endl
+		 << "  --lights <n>              Shadow-casting lights sharing the RSM atlas, spread over a quarter turn after the" << endl
+		 << "                            key light (1, up to " << Renderer::MAX_LIGHTS << ")" << endl
+		 << "  --ssao <0|1>              Enable screen space ambient occlusion (1)" << endl
+		 << "  --rsm <0|1>               Enable reflective shadow maps (1)" << endl
+		 << "  --ssao-downsampling <n>   Generate SSAO once per n x n pixels and upsample it (1)" << endl
+		 << "  --ao <name>               Ambient occlusion: hemisphere kernel or horizon-based: ssao or gtao (ssao)" << endl
+		 << "  --ssao-blur <name>        SSAO denoising: 5x5 box filter, or separable depth and normal-aware Gaussian: box" << endl
+		 << "                            or bilateral (bilateral)" << endl
+		 << "  --ssao-blur-radius <n>    Bilateral SSAO blur taps on each side of a pixel (4)" << endl
+		 << "  --depth-mips <0|1>        Read farther AO samples from coarser levels of the linear depth (0)" << endl
+		 << "  --rsm-downsampling <n>    Evaluate RSM indirect lighting once per n x n pixels and upsample it (1)" << endl
+		 << "  --rsm-interleave <n>      Split the RSM samples among the pixels of n x n tiles and blur the result (1: off)" << endl
+		 << "  --temporal <0|1>          Accumulate SSAO and RSM indirect lighting over frames with reprojection (0)" << endl
+		 << "  --rsm-gather <name>       RSM indirect lighting from a disk of samples, a flux-weighted RSM mip chain, or" << endl
+		 << "                            CPU-clustered virtual point lights: disk, hierarchical, or vpl (disk)" << endl
+		 << "  --rsm-format <name>       RSM storage: float32, or compact rgb10a2 or r11g11b10f flux (float32)" << endl
+		 << "  --rsm-resolution <n>      RSM texture side, independent of the render size (0: largest render dimension)" << endl
+		 << "  --shadows <name>          Direct shadows: percentage closer soft shadows, or variance shadow maps: pcss or" << endl
+		 << "                            vsm (pcss)" << endl
+		 << "  --rsm-samples <n>         Poisson disk samples for RSM gathering (151)" << endl
+		 << "  --pcss-samples <n>        Poisson disk samples for the PCSS blocker search and filtering (33)" << endl
+		 << "  --ssao-samples <n>        SSAO hemisphere kernel samples (48)" << endl
+		 << "  --rsm-cache <0|1>         Reuse the RSM from the last frame while neither the lights nor the scene change (1)" << endl
+		 << "  --render-scale <s>        Render at a fraction of the width and height, and upscale the lit scene (1)" << endl
+		 << "  --frame-budget <ms>       Adjust the render scale to hold a GPU time per frame (0: off)" << endl
+		 << "  --min-render-scale <s>    Smallest render scale under a frame budget (" << DynamicResolution::DEFAULT_MIN_SCALE << ")" << endl
+		 << "  --output <path>           Save frames as <path>00000.png, <path>00001.png, ... or as the <path> video (frame," << endl
+		 << "                            or frames.y4m)" << endl
+		 << "  --format <png|y4m>        Save frames as a PNG sequence or a raw Y4M video (png)" << endl
+		 << "  --no-output               Don't save frames (e.g. for timing only)" << endl
+		 << "  --histogram <file>        Dump the frame-time histogram to file" << endl
+		 << "  --benchmark <file>        Run the scripted benchmark (overrides --camera, --light, --ssao, --rsm," << endl
+		 << "                            --rsm-interleave, --shadows, and --ao; saves no frames unless --output is given) and" << endl
+		 << "                            write its results to a JSON file" << endl
+		 << "  --timeline <file>         Benchmark timeline (default: built-in timeline stretched over --frames)" << endl
+		 << "  --seed <n>                Benchmark random seed (" << Benchmark::DEFAULT_SEED << ")" << endl
+		 << "  --label <text>            Benchmark run description stored in the JSON file" << endl;
+}
+
+/**
+ * Headless main function.
+ * @param argc Number of input arguments.
+ * @param argv Input arguments (see printUsage()).
+ * @return Exit code.
+ */
+int main( int argc, const char * argv[] )
+{
+	int width = 768, height = 768;
+	int frames = 0;
+	double cameraFrom = 45, cameraTo = 45;
+	double lightFrom = 0, lightTo = 0;
+	bool enableSSAO = true, enableRSM = true;
+	int ssaoDownsampling = 1;
+	Renderer::AOMethod aoMethod = Renderer::AO_SSAO;
+	Renderer::SSAOBlur ssaoBlur = Renderer::SSAO_BLUR_BILATERAL;
+	int ssaoBlurRadius = 4;
+	int indirectDownsampling = 1;
+	int indirectInterleave = 1;
+	bool enableTemporal = false;
+	Renderer::RSMGather rsmGather = Renderer::GATHER_DISK;
+	Renderer::RSMFormat rsmFormat = Renderer::RSM_FLOAT32;
+	int rsmResolution = 0;
+	int lightCount = 1;
+	bool enableRSMCache = true;
+	bool enableDepthMips = false;
+	int rsmSamples = 151, pcssSamples = 33, ssaoSamples = 48;
+	double renderScale = 1, frameBudget = 0, minRenderScale = DynamicResolution::DEFAULT_MIN_SCALE;
+	Renderer::ShadowMode shadowMode = Renderer::SHADOW_PCSS;
+	string outputPrefix;
+	bool saveFrames = true;
+	FrameCapture::Format format = FrameCapture::PNG_SEQUENCE;
+	string histogramFilename;
+	Benchmark benchmark;
+	string benchmarkFilename, benchmarkLabel;
+
+	for( int i = 1; i < argc; i++ )
+	{
+		string arg = argv[i];
+		bool hasValue = ( i + 1 < argc );
+		bool ok = true;
+		if( arg == "--help" || arg == "-h" )
+		{
+			printUsage( argv[0] );
+			return 0;
+		}
+		else if( arg == "--no-output" )
+			saveFrames = false;
+		else if( !hasValue )
+			ok = false;
+		else if( arg == "--width" )
+			width = atoi( argv[++i] );
+		else if( arg == "--height" )
+			height = atoi( argv[++i] );
+		else if( arg == "--frames" )
+			frames = atoi( argv[++i] );
+		else if( arg == "--camera" )
+			ok = parseRange( argv[++i], cameraFrom, cameraTo );
+		else if( arg == "--light" )
+			ok = parseRange( argv[++i], lightFrom, lightTo );
+		else if( arg == "--lights" )
+			ok = ( lightCount = atoi( argv[++i] ) ) > 0 && lightCount <= Renderer::MAX_LIGHTS;
+		else if( arg == "--ssao" )
+			enableSSAO = atoi( argv[++i] ) != 0;
+		else if( arg == "--rsm" )
+			enableRSM = atoi( argv[++i] ) != 0;
+		else if( arg == "--ssao-downsampling" )
+			ssaoDownsampling = atoi( argv[++i] );
+		else if( arg == "--ao" )
+			ok = ( aoMethod = Renderer::aoMethodFromName( argv[++i] ) ) != Renderer::AO_METHOD_COUNT;
+		else if( arg == "--ssao-blur" )
+			ok = ( ssaoBlur = Renderer::ssaoBlurFromName( argv[++i] ) ) != Renderer::SSAO_BLUR_COUNT;
+		else if( arg == "--ssao-blur-radius" )
+			ssaoBlurRadius = atoi( argv[++i] );
+		else if( arg == "--depth-mips" )
+			enableDepthMips = atoi( argv[++i] ) != 0;
+		else if( arg == "--rsm-downsampling" )
+			indirectDownsampling = atoi( argv[++i] );
+		else if( arg == "--rsm-interleave" )
+			indirectInterleave = atoi( argv[++i] );
+		else if( arg == "--temporal" )
+			enableTemporal = atoi( argv[++i] ) != 0;
+		else if( arg == "--rsm-gather" )
+			ok = ( rsmGather = Renderer::rsmGatherFromName( argv[++i] ) ) != Renderer::GATHER_COUNT;
+		else if( arg == "--rsm-format" )
+			ok = ( rsmFormat = Renderer::rsmFormatFromName( argv[++i] ) ) != Renderer::RSM_FORMAT_COUNT;
+		else if( arg == "--rsm-resolution" )
+			rsmResolution = atoi( argv[++i] );
+		else if( arg == "--rsm-samples" )
+			ok = ( rsmSamples = atoi( argv[++i] ) ) > 0;
+		else if( arg == "--pcss-samples" )
+			ok = ( pcssSamples = atoi( argv[++i] ) ) > 0;
+		else if( arg == "--ssao-samples" )
+			ok = ( ssaoSamples = atoi( argv[++i] ) ) > 0;
+		else if( arg == "--rsm-cache" )
+			enableRSMCache = atoi( argv[++i] ) != 0;
+		else if( arg == "--render-scale" )
+			ok = ( renderScale = atof( argv[++i] ) ) > 0 && renderScale <= 1;
+		else if( arg == "--frame-budget" )
+			ok = ( frameBudget = atof( argv[++i] ) ) >= 0;
+		else if( arg == "--min-render-scale" )
+			ok = ( minRenderScale = atof( argv[++i] ) ) > 0 && minRenderScale <= 1;
+		else if( arg == "--shadows" )
+			ok = ( shadowMode = Renderer::shadowModeFromName( argv[++i] ) ) != Renderer::SHADOW_MODE_COUNT;
+		else if( arg == "--output" )
+			outputPrefix = argv[++i];
+		else if( arg == "--format" )
+			ok = ( format = FrameCapture::formatFromName( argv[++i] ) ) != FrameCapture::FORMAT_COUNT;
+		else if( arg == "--histogram" )
+			histogramFilename = argv[++i];
+		else if( arg == "--benchmark" )
+			benchmarkFilename = argv[++i];
+		else if( arg == "--timeline" )
+			ok = benchmark.loadTimeline( argv[++i] );
+		else if( arg == "--seed" )
+			benchmark.setSeed( atoi( argv[++i] ) );
+		else if( arg == "--label" )
+			benchmarkLabel = argv[++i];
+		else
+			ok = false;
+
+		if( !ok )
+		{
+			cerr << "Invalid argument " << arg << endl;
+			printUsage( argv[0] );
+			return EXIT_FAILURE;
+		}
+	}
+
+	// In benchmark mode, the timeline decides what happens in each frame and, unless given, how many frames there are.
+	const bool benchmarking = !benchmarkFilename.empty();
+	if( benchmarking )
+	{
+		if( frames > 0 )
+			benchmark.setFrames( frames );
+		frames = benchmark.getFrames();
+		saveFrames = saveFrames && !outputPrefix.empty();
+	}
+	else if( frames == 0 )
+		frames = 1;
+	if( outputPrefix.empty() )
+		outputPrefix = ( format == FrameCapture::Y4M )? "frames.y4m" : "frame";
+
+	if( width <= 0 || height <= 0 || frames <= 0 )
+	{
+		cerr << "Width, height, and number of frames must be positive" << endl;
+		return EXIT_FAILURE;
+	}
+
+	HeadlessContext context;
+	if( !context.create( width, height ) )
+		return EXIT_FAILURE;
+
+	///////////////////////////////////// Intialize OpenGL and rendering pipeline //////////////////////////////////////
+
+	int exitCode = 0;
+	{
+		OpenGL ogl;
+		vector<Light> lights;
+		Renderer renderer;
+		FrameStats frameStats;
+		GPUTimer frameGPUTimer;
+		FrameCapture frameCapture;
+
+		ogl.init();
+		frameGPUTimer.init();
+		renderer.setRSMFormat( rsmFormat );
+		renderer.setRSMResolution( rsmResolution );
+		renderer.rsmSampleCount = rsmSamples;
+		renderer.pcssSampleCount = pcssSamples;
+		renderer.ssaoKernelSize = ssaoSamples;
+		renderer.lightCount = lightCount;
+		renderer.init( &ogl, width, height, lights, benchmarking? benchmark.getSeed() : -1 );
+		vector<double> lightOffsets;							// Initial angles of the lights about the y-axis.
+		for( const Light& light : lights )
+			lightOffsets.push_back( atan2( light.position[0], light.position[2] ) );
+		renderer.enableSSAO = enableSSAO;
+		renderer.enableRSM = enableRSM;
+		renderer.setSSAODownsampling( ssaoDownsampling );
+		renderer.aoMethod = aoMethod;
+		renderer.ssaoBlur = ssaoBlur;
+		renderer.ssaoBlurRadius = ssaoBlurRadius;
+		renderer.setIndirectDownsampling( indirectDownsampling );
+		renderer.setIndirectInterleave( indirectInterleave );
+		renderer.enableTemporal = enableTemporal;
+		renderer.rsmGather = rsmGather;
+		renderer.enableRSMCache = enableRSMCache;
+		renderer.enableDepthMips = enableDepthMips;
+		renderer.shadowMode = shadowMode;
+		if( frameBudget > 0 )
+			renderer.setFrameBudget( frameBudget, minRenderScale );
+		else
+			renderer.setRenderScale( renderScale );
+
+		// There's no default framebuffer: the lit scene goes into an 8-bit color texture that we read back.
+		if( !context.createTarget() )
+			exitCode = EXIT_FAILURE;
+
+		// Frames are read back asynchronously and encoded in another thread; offline rendering never drops any, though.
+		if( saveFrames && !frameCapture.start( width, height, format, outputPrefix, 60, false ) )
+			exitCode = EXIT_FAILURE;
+
+		// Same camera setup as the windowed application.
+		mat44 Proj = Tx::perspective( M_PI/3.0, static_cast<double>( width ) / height, 0.01, 100.0 );
+		const vec3 eye0 = Renderer::DEFAULT_EYE;
+		const double eyeY = eye0[1];
+		const double eyeXZRadius = sqrt( eye0[0]*eye0[0] + eye0[2]*eye0[2] );
+		double eyeAngle = atan2( eye0[0], eye0[2] );
+		mat44 Model = eye<mat>( 4, 4 );
+		double rsmMilliseconds[Renderer::PASS_COUNT] = {};		// GPU time of the RSM passes that were timed.
+		int rsmTimedFrames[Renderer::PASS_COUNT] = {};
+
+		for( int f = 0; f < frames && exitCode == 0; f++ )
+		{
+			frameStats.beginFrame();
+			frameGPUTimer.begin( f );
+			bool hasGPUTime = frameGPUTimer.hasNewResult();
+			if( hasGPUTime )
+				frameStats.addGPUTime( frameGPUTimer.getMilliseconds() );
+
+			if( benchmarking )
+			{
+				// Same per-frame increments as the windowed application's benchmark mode.
+				const Benchmark::State& state = benchmark.beginFrame();
+				renderer.enableSSAO = state.enableSSAO;
+				renderer.enableRSM = state.enableRSM;
+				renderer.setIndirectInterleave( state.interleavedRSM? Renderer::DEFAULT_INTERLEAVE : 1 );
+				renderer.shadowMode = state.vsmShadows? Renderer::SHADOW_VSM : Renderer::SHADOW_PCSS;
+				renderer.aoMethod = state.gtao? Renderer::AO_GTAO : Renderer::AO_SSAO;
+				if( state.rotatingCamera )
+					eyeAngle += 0.01 * M_PI;
+				if( state.rotatingLights )
+					for( Light& light : lights )
+						light.rotateBy( static_cast<float>( 0.01 * M_PI ) );
+			}
+			else
+			{
+				// Interpolate the scripted camera and light angles.
+				double t = ( frames > 1 )? static_cast<double>( f ) / ( frames - 1 ) : 0.0;
+				eyeAngle = ( cameraFrom + t * ( cameraTo - cameraFrom ) ) * M_PI / 180.0;
+				const double lightAngle = ( lightFrom + t * ( lightTo - lightFrom ) ) * M_PI / 180.0;
+				for( int l = 0; l < lightCount; l++ )			// The other lights keep their spread about the key light.
+					lights[l].rotateTo( static_cast<float>( lightAngle + lightOffsets[l] ) );
+			}
+			vec3 eyePosition = { eyeXZRadius * sin( eyeAngle ), eyeY, eyeXZRadius * cos( eyeAngle ) };
+			mat44 Camera = Tx::lookAt( eyePosition, Renderer::POINT_OF_INTEREST, Tx::Y_AXIS );
+
+			glClearColor( 0, 0, 0, 1 );
+			renderer.render( Proj, Camera, eyePosition, Model, lights, context.getTargetFBO() );
+
+			frameGPUTimer.end();
+			for( int p = 0; p < Renderer::PASS_COUNT; p++ )
+			{
+				auto pass = static_cast<Renderer::Pass>( p );
+				if( Renderer::isRSMPass( pass ) && renderer.hasNewPassTime( pass ) )
+				{
+					rsmMilliseconds[p] += renderer.getPassMilliseconds( pass );
+					rsmTimedFrames[p]++;
+				}
+			}
+
+			if( saveFrames )
+				frameCapture.capture( context.getTargetFBO() );
+			else
+				glFinish();
+
+			frameStats.endFrame();
+			if( benchmarking )
+				benchmark.endFrame( frameStats, renderer, hasGPUTime, frameGPUTimer.getMilliseconds(),
+								   static_cast<int>( frameGPUTimer.getResultFrame() ) );
+		}
+
+		// Report frame times: to file if requested, otherwise to the console.
+		FrameStats::Summary frame = frameStats.summarize( FrameStats::FRAME );
+		FrameStats::Summary gpu = frameStats.summarize( FrameStats::GPU );
+		printf( "Frames: %lu  Frame p50 %.2f p95 %.2f max %.2f ms  GPU p50 %.2f p95 %.2f max %.2f ms\n",
+				frameStats.getTotalFrames(), frame.p50, frame.p95, frame.max, gpu.p50, gpu.p95, gpu.max );
+		// Timer results arrive a few frames late, so an RSM that is rendered only once or twice may not have been timed.
+		printf( "RSM cache: rendered %lu, reused %lu frames", renderer.getRSMRenderedFrames(), renderer.getRSMReusedFrames() );
+		double rsmAverage = 0;									// Sum of the average times of every pass a reused RSM skips.
+		for( int p = 0; p < Renderer::PASS_COUNT; p++ )
+			if( rsmTimedFrames[p] > 0 )
+				rsmAverage += rsmMilliseconds[p] / rsmTimedFrames[p];
+		if( rsmAverage > 0 )
+		{
+			printf( "; saved about %.2f ms of GPU time (%.2f ms per RSM)", rsmAverage * renderer.getRSMReusedFrames(), rsmAverage );
+			if( renderer.enableRSM && renderer.rsmGather == Renderer::GATHER_VPL )		// Reused frames also skip the VPL rebuild.
+				printf( " and %.2f ms of CPU time", renderer.getVPLMilliseconds() * renderer.getRSMReusedFrames() );
+			printf( "\n" );
+		}
+		else
+			printf( "; run with --rsm-cache 0 to time the RSM passes\n" );
+		if( renderer.getFrameBudget() > 0 )
+			printf( "Dynamic resolution: %.2f ms budget, last frames at %dx%d\n", renderer.getFrameBudget(), renderer.getRenderWidth(),
+					renderer.getRenderHeight() );
+		fflush( stdout );
+		renderer.reportTargetMemory( cout );
+		renderer.reportFrameGraph( cout );
+		if( renderer.enableRSM && renderer.rsmGather == Renderer::GATHER_VPL )
+			printf( "VPL sampling and clustering (last rebuild): %.2f ms\n", renderer.getVPLMilliseconds() );
+		if( !histogramFilename.empty() )
+		{
+			ofstream histogramFile( histogramFilename );
+			if( histogramFile.is_open() )
+				frameStats.dumpHistogram( histogramFile );
+			else
+				cerr << "Unable to open file " << histogramFilename << endl;
+		}
+		if( benchmarking && !benchmark.writeJSON( benchmarkFilename, benchmarkLabel, width, height ) )
+			exitCode = EXIT_FAILURE;
+
+		context.destroyTarget();
+		if( saveFrames )
+		{
+			frameCapture.stop();
+			if( frameCapture.getWrittenFrames() != frameCapture.getCapturedFrames() )
+				exitCode = EXIT_FAILURE;
+		}
+		frameGPUTimer.destroy();
+		renderer.destroy();
+	}															// OpenGL objects must go away before the context does.
+
+	context.destroy();
+	return exitCode;
+}
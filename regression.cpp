@@ -0,0 +1,244 @@
+/**
+ * Golden-image regression test: renders the reference scene headlessly at fixed camera and light poses, and compares
+ * the final color and a few intermediate buffers against stored golden images.
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <sys/stat.h>
+#include <armadillo>
+#include "OpenGLHeaders.h"
+#include <string>
+#include "Configuration.h"
+#include "HeadlessContext.h"
+#include "OpenGL.h"
+#include "Transformations.h"
+#include "Renderer.h"
+#include "ImageIO.h"
+#include "ImageCompare.h"
+
+using namespace std;
+using namespace arma;
+
+const int WIDTH = 256;							// Render size: small, so that software rasterizers are fast enough.
+const int HEIGHT = 256;
+const int SEED = 2019;							// SSAO kernel and noise seed.
+const int EXIT_SKIP = 77;						// Reported when default golden images are missing (CTest's skip convention).
+
+struct Pose
+{
+	double cameraDegrees;						// Camera orbit angle about the y-axis.
+	double lightDegrees;						// Light angle about the y-axis.
+};
+
+const Pose POSES[] = { { 45, 0 }, { 20, 60 }, { 70, -45 } };
+
+/**
+ * Read back a floating point texture and convert it into an 8-bit image: value * scale + offset, clamped to [0, 1].
+ * @param texture Texture ID.
+ * @param format GL_RED or GL_RGB.
+ * @param scale Scale applied to every value.
+ * @param offset Offset added to every scaled value.
+ * @param image Receives the image, top row first.
+ * @param width Receives the texture width.
+ * @param height Receives the texture height.
+ */
+void readTexture( GLuint texture, GLenum format, float scale, float offset, vector<unsigned char>& image, int& width, int& height )
+{
+	const int channels = ( format == GL_RED )? 1 : 3;
+	glBindTexture( GL_TEXTURE_2D, texture );
+	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width );
+	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height );
+
+	const size_t rowSize = static_cast<size_t>( width ) * channels;
+	vector<float> values( rowSize * height );
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+	glGetTexImage( GL_TEXTURE_2D, 0, format, GL_FLOAT, values.data() );
+
+	image.resize( values.size() );
+	for( int row = 0; row < height; row++ )				// Textures are stored bottom row first.
+	{
+		for( size_t i = 0; i < rowSize; i++ )
+		{
+			float v = values[( height - 1 - row ) * rowSize + i] * scale + offset;
+			image[row * rowSize + i] = static_cast<unsigned char>( 255.0f * min( max( v, 0.0f ), 1.0f ) + 0.5f );
+		}
+	}
+}
+
+/**
+ * Print usage information.
+ * @param program Executable name.
+ */
+void printUsage( const char* program )
+{
+	cout << "Usage: " << program << " [options]" << endl
+		 << "  --golden <dir>     Golden images directory (" << conf::RESOURCES_FOLDER << "golden/); missing images in" << endl
+		 << "                     a directory given here fail the test instead of skipping it" << endl
+		 << "  --output <dir>     Where to save the actual images and diff heat maps of failing buffers (.)" << endl
+		 << "  --update           Overwrite the golden images with the current rendering" << endl
+		 << "  --psnr <dB>        Minimum PSNR (35)" << endl
+		 << "  --ssim <value>     Minimum SSIM (0.97)" << endl;
+}
+
+/**
+ * Regression test main function.
+ * @param argc Number of input arguments.
+ * @param argv Input arguments (see printUsage()).
+ * @return 0 if every buffer matches its golden image, EXIT_SKIP if default golden images are missing, EXIT_FAILURE
+ * otherwise.
+ */
+int main( int argc, const char * argv[] )
+{
+	string goldenFolder = conf::RESOURCES_FOLDER + "golden/";
+	string outputFolder = "./";
+	bool update = false;
+	bool explicitGolden = false;								// Missing golden images are an error, not a skip.
+	double minPSNR = 35.0, minSSIM = 0.97;
+
+	for( int i = 1; i < argc; i++ )
+	{
+		string arg = argv[i];
+		if( arg == "--update" )
+			update = true;
+		else if( arg == "--golden" && i + 1 < argc )
+		{
+			goldenFolder = string( argv[++i] ) + "/";
+			explicitGolden = true;
+		}
+		else if( arg == "--output" && i + 1 < argc )
+			outputFolder = string( argv[++i] ) + "/";
+		else if( arg == "--psnr" && i + 1 < argc )
+			minPSNR = atof( argv[++i] );
+		else if( arg == "--ssim" && i + 1 < argc )
+			minSSIM = atof( argv[++i] );
+		else
+		{
+			printUsage( argv[0] );
+			return ( arg == "--help" || arg == "-h" )? 0 : EXIT_FAILURE;
+		}
+	}
+
+	mkdir( ( update? goldenFolder : outputFolder ).c_str(), 0755 );		// Create the destination folder if it doesn't exist.
+
+	HeadlessContext context;
+	if( !context.create( WIDTH, HEIGHT ) || !context.createTarget() )
+		return EXIT_FAILURE;
+
+	int failures = 0, missing = 0;
+	{
+		OpenGL ogl;
+		vector<Light> lights;							// A single light, as the golden images were rendered with.
+		Renderer renderer;
+
+		ogl.init();
+		renderer.init( &ogl, WIDTH, HEIGHT, lights, SEED );
+		renderer.enableSSAO = true;
+		renderer.enableRSM = true;
+
+		// Same camera setup as the windowed application.
+		mat44 Proj = Tx::perspective( M_PI/3.0, static_cast<double>( WIDTH ) / HEIGHT, 0.01, 100.0 );
+		const vec3 eye0 = Renderer::DEFAULT_EYE;
+		const double eyeXZRadius = sqrt( eye0[0]*eye0[0] + eye0[2]*eye0[2] );
+		mat44 Model = eye<mat>( 4, 4 );
+
+		printf( "%-24s %10s %8s  %s\n", "Image", "PSNR (dB)", "SSIM", "Result" );
+		const size_t nPoses = sizeof( POSES ) / sizeof( Pose );
+		for( size_t p = 0; p < nPoses; p++ )
+		{
+			double eyeAngle = POSES[p].cameraDegrees * M_PI / 180.0;
+			vec3 eyePosition = { eyeXZRadius * sin( eyeAngle ), eye0[1], eyeXZRadius * cos( eyeAngle ) };
+			mat44 Camera = Tx::lookAt( eyePosition, Renderer::POINT_OF_INTEREST, Tx::Y_AXIS );
+			lights[0].rotateTo( static_cast<float>( POSES[p].lightDegrees * M_PI / 180.0 ) );
+
+			glClearColor( 0, 0, 0, 1 );
+			renderer.render( Proj, Camera, eyePosition, Model, lights, context.getTargetFBO() );
+
+			// Final color (without alpha), and the intermediate buffers most affected by pipeline optimizations.
+			struct Buffer { string name; vector<unsigned char> pixels; int width, height, channels; };
+			Buffer buffers[4] = { { "color" }, { "gNormal" }, { "ssaoBlurFactor" }, { "rsmFlux" } };
+
+			vector<unsigned char> rgba;
+			context.readTarget( rgba );
+			buffers[0].width = WIDTH;
+			buffers[0].height = HEIGHT;
+			buffers[0].channels = 3;
+			buffers[0].pixels.resize( static_cast<size_t>( WIDTH ) * HEIGHT * 3 );
+			for( int row = 0; row < HEIGHT; row++ )
+				for( int x = 0; x < WIDTH; x++ )
+					for( int c = 0; c < 3; c++ )
+						buffers[0].pixels[( row * WIDTH + x ) * 3 + c] = rgba[( ( HEIGHT - 1 - row ) * WIDTH + x ) * 4 + c];
+
+			readTexture( renderer.getGBufferNormal(), GL_RGB, 1.0f, 0.0f, buffers[1].pixels, buffers[1].width, buffers[1].height );
+			buffers[1].channels = 3;
+			readTexture( renderer.getSSAOBlurFactor(), GL_RED, 1.0f, 0.0f, buffers[2].pixels, buffers[2].width, buffers[2].height );
+			buffers[2].channels = 1;
+			readTexture( renderer.getRSMFlux(), GL_RGB, 1.0f, 0.0f, buffers[3].pixels, buffers[3].width, buffers[3].height );
+			buffers[3].channels = 3;
+
+			for( Buffer& buffer : buffers )
+			{
+				char name[64];
+				snprintf( name, sizeof( name ), "pose%zu_%s", p, buffer.name.c_str() );
+				string goldenFilename = goldenFolder + name + ".png";
+
+				if( update )
+				{
+					if( !ImageIO::writePNG( goldenFilename, buffer.width, buffer.height, buffer.channels, buffer.pixels.data(), false ) )
+						failures++;
+					printf( "%-24s %10s %8s  %s\n", name, "-", "-", "updated" );
+					continue;
+				}
+
+				int goldenWidth, goldenHeight;
+				vector<unsigned char> golden;
+				if( !ImageIO::readPNG( goldenFilename, goldenWidth, goldenHeight, buffer.channels, golden ) )
+				{
+					printf( "%-24s %10s %8s  %s\n", name, "-", "-", "MISSING" );
+					missing++;
+					continue;
+				}
+
+				double psnr = 0, ssim = 0;
+				bool sameSize = ( goldenWidth == buffer.width && goldenHeight == buffer.height );
+				if( sameSize )
+				{
+					psnr = ImageCompare::psnr( buffer.pixels, golden );
+					ssim = ImageCompare::ssim( buffer.pixels, golden, buffer.width, buffer.height, buffer.channels );
+				}
+
+				bool passed = sameSize && psnr >= minPSNR && ssim >= minSSIM;
+				printf( "%-24s %10.2f %8.4f  %s\n", name, psnr, ssim, passed? "ok" : ( sameSize? "FAILED" : "FAILED (size)" ) );
+				if( passed )
+					continue;
+
+				// Keep the evidence: the actual image and, if comparable, where it differs from the golden one.
+				failures++;
+				ImageIO::writePNG( outputFolder + name + "_actual.png", buffer.width, buffer.height, buffer.channels, buffer.pixels.data(), false );
+				if( sameSize )
+				{
+					vector<unsigned char> diff;
+					ImageCompare::heatmap( buffer.pixels, golden, buffer.width, buffer.height, buffer.channels, diff );
+					ImageIO::writePNG( outputFolder + name + "_diff.png", buffer.width, buffer.height, 3, diff.data(), false );
+				}
+			}
+		}
+
+		renderer.destroy();
+	}															// OpenGL objects must go away before the context does.
+
+	context.destroyTarget();
+	context.destroy();
+
+	if( failures > 0 )
+	{
+		cout << failures << " image(s) failed; actual images and diff heat maps are in " << outputFolder << endl;
+		return EXIT_FAILURE;
+	}
+	if( missing > 0 )
+	{
+		cout << missing << " golden image(s) missing in " << goldenFolder << "; run with --update to record them" << endl;
+		return explicitGolden? EXIT_FAILURE : EXIT_SKIP;
+	}
+	return 0;
+}
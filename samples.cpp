@@ -0,0 +1,79 @@
+/**
+ * Sample set library generator: precomputes the disks, hemispheres, and spheres that the renderer reads from
+ * Resources/samples (see SampleSet), so that switching sample counts doesn't regenerate them at startup.
+ */
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "Configuration.h"
+#include "SampleSet.h"
+#include "Sampling.h"
+
+using namespace std;
+
+/**
+ * Print usage information.
+ * @param program Executable name.
+ */
+void printUsage( const char* program )
+{
+	cout << "Usage: " << program << " [options]" << endl
+		 << "  --output <folder>         Library folder (" << conf::SAMPLES_FOLDER << ")" << endl
+		 << "  --seed <n>                Random seed; the renderer only reads sets made with the default (" << Sampling::SEED << ")" << endl;
+}
+
+/**
+ * Sample set library generator main function.
+ * @param argc Number of input arguments.
+ * @param argv Input arguments (see printUsage()).
+ * @return Exit code.
+ */
+int main( int argc, const char * argv[] )
+{
+	// Sizes for RSM gathering, PCSS, and SSAO presets, and sphere sets for future use (e.g. point light sampling).
+	const vector<int> SIZES[SampleSet::KIND_COUNT] = {
+		{ 16, 33, 64, 101, 151, 256, 400 },			// Disks.
+		{ 8, 16, 24, 32, 48, 64, 96 },				// Hemispheres.
+		{ 16, 32, 64, 128, 256 }					// Spheres.
+	};
+
+	string folder = conf::SAMPLES_FOLDER;
+	unsigned seed = Sampling::SEED;
+	for( int i = 1; i < argc; i++ )
+	{
+		string arg = argv[i];
+		if( arg == "--help" || arg == "-h" )
+		{
+			printUsage( argv[0] );
+			return 0;
+		}
+		else if( i + 1 < argc && arg == "--output" )
+			folder = string( argv[++i] ) + "/";
+		else if( i + 1 < argc && arg == "--seed" )
+			seed = static_cast<unsigned>( atol( argv[++i] ) );
+		else
+		{
+			cerr << "Invalid argument " << arg << endl;
+			printUsage( argv[0] );
+			return EXIT_FAILURE;
+		}
+	}
+
+	for( int kind = 0; kind < SampleSet::KIND_COUNT; kind++ )
+	{
+		for( int count : SIZES[kind] )
+		{
+			const auto start = chrono::steady_clock::now();
+			const vector<float> samples = SampleSet::generate( static_cast<SampleSet::Kind>( kind ), count, seed );
+			const double ms = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+
+			const string filename = SampleSet::filename( static_cast<SampleSet::Kind>( kind ), count );
+			if( !SampleSet::save( folder + filename, SampleSet::DIMENSIONS[kind], samples ) )
+				return EXIT_FAILURE;
+			cout << filename << ": " << count << " samples in " << ms << " ms" << endl;
+		}
+	}
+
+	return 0;
+}